@@ -0,0 +1,200 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/block_gc.h"
+
+#include <map>
+#include <set>
+
+#include "common/base/closure.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/master/meta_tree.h"
+#include "rsfs/master/node_manager.h"
+#include "rsfs/proto/proto_helper.h"
+#include "rsfs/snode/snode_client.h"
+#include "rsfs/utils/block_id.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int32(rsfs_master_gc_file_num);
+DECLARE_int32(rsfs_master_gc_node_block_num);
+DECLARE_int32(rsfs_master_gc_thread_num);
+DECLARE_int32(rsfs_master_gc_rpc_timeout_period);
+DECLARE_int64(rsfs_master_gc_dead_node_expire_period);
+DECLARE_int32(rsfs_snode_connect_retry_period);
+
+namespace rsfs {
+namespace master {
+
+BlockGc::BlockGc(MetaTree* meta_tree, NodeManager* node_manager)
+    : m_meta_tree(meta_tree), m_node_manager(node_manager),
+      m_round_thread(new ThreadPool(1, 1)),
+      m_thread_pool(new ThreadPool(1, FLAGS_rsfs_master_gc_thread_num)),
+      m_is_running(false) {}
+
+BlockGc::~BlockGc() {
+    m_round_thread.reset();
+    m_thread_pool.reset();
+}
+
+void BlockGc::Schedule() {
+    {
+        MutexLocker lock(m_mutex);
+        if (m_is_running) {
+            VLOG(5) << "last gc round is still running, skip";
+            return;
+        }
+        m_is_running = true;
+    }
+    m_round_thread->AddTask(NewClosure(this, &BlockGc::RunRound));
+}
+
+void BlockGc::RunRound() {
+    std::vector<GcRecord> records;
+    std::string next_key;
+    int64_t now = utils::GetWallMillis();
+    m_meta_tree->ScanGarbage(m_next_key, FLAGS_rsfs_master_gc_file_num,
+                             now, &records, &next_key);
+    m_next_key = next_key;
+    int64_t expire_period = FLAGS_rsfs_master_gc_dead_node_expire_period;
+    // blocks to drop from pending of each record, acked or given up
+    std::vector<std::set<uint32_t> > deleted(records.size());
+    uint32_t expired_block_num = 0;
+
+    // group pending blocks by snode, bounded per snode to avoid io storm
+    uint32_t node_block_num = FLAGS_rsfs_master_gc_node_block_num;
+    std::map<std::string, NodeTask> node_tasks;
+    for (uint32_t r = 0; r < records.size(); ++r) {
+        GcRecord& record = records[r];
+        m_node_manager->FillNodeStatus(record.mutable_chunks());
+        for (int32_t i = 0; i < record.pending_size(); ++i) {
+            uint32_t chunk_no = record.pending(i);
+            if (chunk_no >= static_cast<uint32_t>(record.chunks_size())) {
+                continue;
+            }
+            const SNodeInfo& node = record.chunks(chunk_no);
+            // keep blocks of a failed node until it comes back, but give
+            // them up once the node stays dead for too long, otherwise
+            // the record of a decommissioned node is never finished
+            if (node.status() == kSNodeIsDead) {
+                if (expire_period > 0
+                    && now - record.not_before() > expire_period) {
+                    deleted[r].insert(chunk_no);
+                    ++expired_block_num;
+                }
+                continue;
+            }
+            if (node.status() == kSNodeIsSuspect) {
+                continue;
+            }
+            NodeTask& task = node_tasks[node.addr()];
+            if (task.block_ids.size() >= node_block_num) {
+                continue;
+            }
+            task.addr = node.addr();
+            task.block_ids.push_back(utils::BlockFileName(record.fid(), chunk_no));
+            task.refs.push_back(std::make_pair(r, chunk_no));
+        }
+    }
+
+    if (!node_tasks.empty()) {
+        Mutex mutex;
+        AutoResetEvent done_event;
+        uint32_t finish_num = 0;
+        std::map<std::string, NodeTask>::iterator it = node_tasks.begin();
+        for (; it != node_tasks.end(); ++it) {
+            m_thread_pool->AddTask(NewClosure(this, &BlockGc::DeleteOnNode,
+                                              &it->second, &mutex,
+                                              &finish_num, &done_event));
+        }
+        while (true) {
+            {
+                MutexLocker lock(mutex);
+                if (finish_num == node_tasks.size()) {
+                    break;
+                }
+            }
+            done_event.Wait();
+        }
+    }
+
+    // drop the acked blocks from pending and persist the progress
+    std::map<std::string, NodeTask>::iterator it = node_tasks.begin();
+    for (; it != node_tasks.end(); ++it) {
+        if (!it->second.is_ok) {
+            continue;
+        }
+        const std::vector<std::pair<uint32_t, uint32_t> >& refs =
+            it->second.refs;
+        for (uint32_t i = 0; i < refs.size(); ++i) {
+            deleted[refs[i].first].insert(refs[i].second);
+        }
+    }
+    uint32_t finish_file_num = 0;
+    for (uint32_t r = 0; r < records.size(); ++r) {
+        GcRecord& record = records[r];
+        if (record.pending_size() > 0 && deleted[r].empty()) {
+            continue;
+        }
+        std::vector<uint32_t> pending;
+        for (int32_t i = 0; i < record.pending_size(); ++i) {
+            if (deleted[r].find(record.pending(i)) == deleted[r].end()) {
+                pending.push_back(record.pending(i));
+            }
+        }
+        record.clear_pending();
+        for (uint32_t i = 0; i < pending.size(); ++i) {
+            record.add_pending(pending[i]);
+        }
+        if (m_meta_tree->UpdateGarbage(record) && pending.empty()) {
+            ++finish_file_num;
+        }
+    }
+    if (!records.empty()) {
+        LOG(INFO) << "gc round done, files: " << records.size()
+            << ", nodes: " << node_tasks.size()
+            << ", finished files: " << finish_file_num
+            << ", expired blocks: " << expired_block_num;
+    }
+
+    MutexLocker lock(m_mutex);
+    m_is_running = false;
+}
+
+void BlockGc::DeleteOnNode(NodeTask* task, Mutex* mutex,
+                           uint32_t* finish_num, AutoResetEvent* done_event) {
+    // no retry inside a round, the blocks are kept pending for next one
+    snode::SNodeClient client(FLAGS_rsfs_snode_connect_retry_period,
+                              FLAGS_rsfs_master_gc_rpc_timeout_period, 1);
+    client.ResetSNodeClient(task->addr);
+    DeleteDataRequest request;
+    DeleteDataResponse response;
+    request.set_sequence_id(0);
+    request.set_timeout_ms(FLAGS_rsfs_master_gc_rpc_timeout_period);
+    for (uint32_t i = 0; i < task->block_ids.size(); ++i) {
+        request.add_block_ids(task->block_ids[i]);
+    }
+    if (!client.DeleteData(&request, &response)
+        || response.status() != kSNodeOk) {
+        LOG(WARNING) << "fail to delete " << task->block_ids.size()
+            << " blocks on snode: " << task->addr
+            << ", status: " << StatusCodeToString(response.status());
+    } else {
+        VLOG(5) << "delete " << task->block_ids.size()
+            << " blocks on snode: " << task->addr;
+        task->is_ok = true;
+    }
+
+    {
+        MutexLocker lock(*mutex);
+        ++(*finish_num);
+    }
+    done_event->Set();
+}
+
+} // namespace master
+} // namespace rsfs
@@ -0,0 +1,69 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_BLOCK_GC_H
+#define RSFS_MASTER_BLOCK_GC_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/base/scoped_ptr.h"
+#include "common/lock/event.h"
+#include "common/lock/mutex.h"
+#include "common/thread/thread_pool.h"
+
+namespace rsfs {
+namespace master {
+
+class MetaTree;
+class NodeManager;
+
+// deletes the blocks of removed files from snodes in background.
+// each round scans a bounded number of gc records, groups their
+// blocks by snode and sends at most one bounded delete per snode.
+// a record is dropped once every block of it is acked, so blocks
+// on unreachable snodes are retried in later rounds, until the node
+// is dead longer than rsfs_master_gc_dead_node_expire_period.
+class BlockGc {
+public:
+    BlockGc(MetaTree* meta_tree, NodeManager* node_manager);
+    ~BlockGc();
+
+    // start a round in background, skipped if last one is running
+    void Schedule();
+
+private:
+    struct NodeTask {
+        std::string addr;
+        std::vector<uint64_t> block_ids;
+        // (record index, chunk index) of each block
+        std::vector<std::pair<uint32_t, uint32_t> > refs;
+        bool is_ok;
+
+        NodeTask() : is_ok(false) {}
+    };
+
+    void RunRound();
+    void DeleteOnNode(NodeTask* task, Mutex* mutex,
+                      uint32_t* finish_num, AutoResetEvent* done_event);
+
+private:
+    MetaTree* m_meta_tree;
+    NodeManager* m_node_manager;
+    scoped_ptr<ThreadPool> m_round_thread;
+    scoped_ptr<ThreadPool> m_thread_pool;
+
+    mutable Mutex m_mutex;
+    bool m_is_running;
+    // gc record key where the next round resumes
+    std::string m_next_key;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_BLOCK_GC_H
@@ -0,0 +1,103 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/fid_allocator.h"
+
+#include "common/base/string_number.h"
+#include "leveldb/write_batch.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+DECLARE_int32(rsfs_master_fid_lease_range);
+
+namespace rsfs {
+namespace master {
+
+// reserved key, sorts before any path so never shows up in listing
+const std::string kFidHighWaterKey = std::string("\x01") + "fid_high_water";
+
+FidAllocator::FidAllocator(leveldb::DB* db)
+    : m_db(db), m_next_fid(1), m_limit_fid(1) {
+    CHECK_GT(FLAGS_rsfs_master_fid_lease_range, 0) << ", invalid fid lease range";
+    // the mark is always synced, whatever the meta sync policy, or the
+    // ids handed out before a crash may be handed out again. it is
+    // written once per range, so it costs little
+    m_write_options.sync = true;
+}
+
+FidAllocator::~FidAllocator() {}
+
+bool FidAllocator::Load(bool* is_found) {
+    MutexLocker lock(m_mutex);
+    *is_found = false;
+    std::string value;
+    leveldb::Status status = m_db->Get(leveldb::ReadOptions(),
+                                       kFidHighWaterKey, &value);
+    if (status.IsNotFound()) {
+        LOG(INFO) << "no fid high-water mark";
+        return true;
+    } else if (!status.ok()) {
+        LOG(ERROR) << "fail to load fid high-water mark, status: "
+            << status.ToString();
+        return false;
+    }
+    uint64_t high_water = 0;
+    if (!StringToNumber(value, &high_water)) {
+        LOG(ERROR) << "invalid fid high-water mark: " << value;
+        return false;
+    }
+    // ids below the mark may have been handed out before restart
+    m_next_fid = high_water;
+    m_limit_fid = high_water;
+    *is_found = true;
+    LOG(INFO) << "load fid high-water mark: " << high_water;
+    return true;
+}
+
+bool FidAllocator::Reset(uint64_t max_fid) {
+    MutexLocker lock(m_mutex);
+    if (!PersistMark(max_fid + 1)) {
+        return false;
+    }
+    m_next_fid = max_fid + 1;
+    m_limit_fid = max_fid + 1;
+    LOG(INFO) << "reset fid high-water mark after fid: " << max_fid;
+    return true;
+}
+
+bool FidAllocator::Alloc(uint64_t* fid) {
+    MutexLocker lock(m_mutex);
+    if (m_next_fid >= m_limit_fid && !LeaseRange()) {
+        return false;
+    }
+    *fid = m_next_fid++;
+    return true;
+}
+
+bool FidAllocator::PersistMark(uint64_t high_water) {
+    leveldb::WriteBatch batch;
+    batch.Put(kFidHighWaterKey, NumberToString(high_water));
+    leveldb::Status status = m_db->Write(m_write_options, &batch);
+    if (!status.ok()) {
+        LOG(ERROR) << "fail to persist fid high-water mark: " << high_water
+            << ", status: " << status.ToString();
+        return false;
+    }
+    return true;
+}
+
+bool FidAllocator::LeaseRange() {
+    uint64_t new_limit = m_limit_fid + FLAGS_rsfs_master_fid_lease_range;
+    if (!PersistMark(new_limit)) {
+        return false;
+    }
+    VLOG(5) << "lease fid range: [" << m_limit_fid << ", " << new_limit << ")";
+    m_limit_fid = new_limit;
+    return true;
+}
+
+} // namespace master
+} // namespace rsfs
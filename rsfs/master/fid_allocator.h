@@ -0,0 +1,50 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_FID_ALLOCATOR_H
+#define RSFS_MASTER_FID_ALLOCATOR_H
+
+#include <string>
+
+#include "common/lock/mutex.h"
+#include "leveldb/db.h"
+
+namespace rsfs {
+namespace master {
+
+// hands out unique file ids across master restarts.
+// ids are leased from storage by range, only the high-water mark of the
+// leased range is persisted, so one durable write covers a whole range and
+// a restart resumes from the mark without scanning any file meta.
+class FidAllocator {
+public:
+    FidAllocator(leveldb::DB* db);
+    ~FidAllocator();
+
+    // is_found is false if no mark is persisted yet
+    bool Load(bool* is_found);
+    // start after max_fid, the largest id in use, and persist it as the
+    // mark. it is for the meta written before any mark
+    bool Reset(uint64_t max_fid);
+    bool Alloc(uint64_t* fid);
+
+private:
+    bool PersistMark(uint64_t high_water);
+    bool LeaseRange();
+
+private:
+    leveldb::DB* m_db;
+    leveldb::WriteOptions m_write_options;
+
+    Mutex m_mutex;
+    uint64_t m_next_fid;
+    uint64_t m_limit_fid;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_FID_ALLOCATOR_H
@@ -0,0 +1,61 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/lease_table.h"
+
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace master {
+
+LeaseTable::LeaseTable(int64_t lease_period_ms)
+    : m_lease_period_ms(lease_period_ms) {}
+
+LeaseTable::~LeaseTable() {}
+
+int64_t LeaseTable::GrantRead(const std::string& path) {
+    if (m_lease_period_ms <= 0) {
+        return 0;
+    }
+    int64_t expire_time = utils::GetMillis() + m_lease_period_ms;
+    MutexLocker lock(m_mutex);
+    int64_t& cur_expire_time = m_read_leases[path];
+    if (cur_expire_time < expire_time) {
+        cur_expire_time = expire_time;
+    }
+    return m_lease_period_ms;
+}
+
+int64_t LeaseTable::GetReadExpireTime(const std::string& path) const {
+    MutexLocker lock(m_mutex);
+    std::map<std::string, int64_t>::const_iterator it = m_read_leases.find(path);
+    if (it == m_read_leases.end()) {
+        return 0;
+    }
+    return it->second;
+}
+
+void LeaseTable::Purge() {
+    int64_t now = utils::GetMillis();
+    uint32_t purge_num = 0;
+    MutexLocker lock(m_mutex);
+    std::map<std::string, int64_t>::iterator it = m_read_leases.begin();
+    while (it != m_read_leases.end()) {
+        if (it->second <= now) {
+            m_read_leases.erase(it++);
+            ++purge_num;
+        } else {
+            ++it;
+        }
+    }
+    VLOG(5) << "purge " << purge_num << " expired read leases, remain: "
+        << m_read_leases.size();
+}
+
+} // namespace master
+} // namespace rsfs
@@ -0,0 +1,48 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_LEASE_TABLE_H
+#define RSFS_MASTER_LEASE_TABLE_H
+
+#include <map>
+#include <string>
+
+#include "common/lock/mutex.h"
+
+namespace rsfs {
+namespace master {
+
+// tracks the read leases granted on file meta.
+// a client may serve the meta from its cache until the lease expires,
+// so the blocks of a removed file are not deleted before the expire
+// time. the only other change to a closed meta is the crash stats
+// reported by readers, which are advisory and may be missed by the
+// cached ones.
+class LeaseTable {
+public:
+    LeaseTable(int64_t lease_period_ms);
+    ~LeaseTable();
+
+    // return the granted period (in ms), 0 if lease is disabled
+    int64_t GrantRead(const std::string& path);
+
+    // the time (in ms) after which no reader holds the lease, 0 if none
+    int64_t GetReadExpireTime(const std::string& path) const;
+
+    // drop the expired leases
+    void Purge();
+
+private:
+    const int64_t m_lease_period_ms;
+
+    mutable Mutex m_mutex;
+    std::map<std::string, int64_t> m_read_leases;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_LEASE_TABLE_H
@@ -54,6 +54,38 @@ bool MasterClient::ListFile(const ListFileRequest* request,
                                 "ListFile");
 }
 
+bool MasterClient::SplitRange(const SplitRangeRequest* request,
+                              SplitRangeResponse* response) {
+    return SendMessageWithRetry(&MasterServer::Stub::SplitRange,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "SplitRange");
+}
+
+bool MasterClient::StatFile(const StatFileRequest* request,
+                            StatFileResponse* response) {
+    return SendMessageWithRetry(&MasterServer::Stub::StatFile,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "StatFile");
+}
+
+bool MasterClient::RemoveFile(const RemoveFileRequest* request,
+                              RemoveFileResponse* response) {
+    return SendMessageWithRetry(&MasterServer::Stub::RemoveFile,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "RemoveFile");
+}
+
+bool MasterClient::RenewLease(const RenewLeaseRequest* request,
+                              RenewLeaseResponse* response) {
+    return SendMessageWithRetry(&MasterServer::Stub::RenewLease,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "RenewLease");
+}
+
 bool MasterClient::Register(const RegisterRequest* request,
                             RegisterResponse* response) {
     return SendMessageWithRetry(&MasterServer::Stub::Register,
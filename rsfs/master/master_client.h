@@ -32,6 +32,18 @@ public:
     virtual bool ListFile(const ListFileRequest* request,
                           ListFileResponse* response);
 
+    virtual bool SplitRange(const SplitRangeRequest* request,
+                            SplitRangeResponse* response);
+
+    virtual bool StatFile(const StatFileRequest* request,
+                          StatFileResponse* response);
+
+    virtual bool RemoveFile(const RemoveFileRequest* request,
+                            RemoveFileResponse* response);
+
+    virtual bool RenewLease(const RenewLeaseRequest* request,
+                            RenewLeaseResponse* response);
+
     virtual bool Register(const RegisterRequest* request,
                           RegisterResponse* response);
 
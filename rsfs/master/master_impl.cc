@@ -7,25 +7,109 @@
 
 #include "rsfs/master/master_impl.h"
 
+#include <algorithm>
+
+#include "common/base/closure.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/master/block_gc.h"
+#include "rsfs/master/lease_table.h"
 #include "rsfs/master/node_manager.h"
 #include "rsfs/master/meta_tree.h"
+#include "rsfs/master/open_file_table.h"
+#include "rsfs/master/write_recovery.h"
 #include "rsfs/proto/proto_helper.h"
+#include "rsfs/types.h"
+#include "rsfs/utils/block_id.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int64(rsfs_heartbeat_period);
+DECLARE_int64(rsfs_master_read_lease_period);
+DECLARE_int64(rsfs_master_gc_period);
+DECLARE_int64(rsfs_master_write_lease_period);
 
 namespace rsfs {
 namespace master {
 
 
 MasterImpl::MasterImpl()
-    : m_node_manager(new NodeManager()),
-      m_meta_tree(new MetaTree(m_node_manager.get())) {}
+    : m_liveness_timer_id(kInvalidTimerId),
+      m_lease_timer_id(kInvalidTimerId),
+      m_gc_timer_id(kInvalidTimerId),
+      m_recovery_timer_id(kInvalidTimerId),
+      m_node_manager(new NodeManager()),
+      m_meta_tree(new MetaTree(m_node_manager.get())),
+      m_lease_table(new LeaseTable(FLAGS_rsfs_master_read_lease_period)),
+      m_block_gc(new BlockGc(m_meta_tree.get(), m_node_manager.get())),
+      m_open_file_table(new OpenFileTable(FLAGS_rsfs_master_write_lease_period)),
+      m_write_recovery(new WriteRecovery(m_meta_tree.get(), m_node_manager.get(),
+                                         m_open_file_table.get())) {}
 
-MasterImpl::~MasterImpl() {}
+MasterImpl::~MasterImpl() {
+    if (m_liveness_timer_id != kInvalidTimerId) {
+        m_timer_manager.RemoveTimer(m_liveness_timer_id);
+    }
+    if (m_lease_timer_id != kInvalidTimerId) {
+        m_timer_manager.RemoveTimer(m_lease_timer_id);
+    }
+    if (m_gc_timer_id != kInvalidTimerId) {
+        m_timer_manager.RemoveTimer(m_gc_timer_id);
+    }
+    if (m_recovery_timer_id != kInvalidTimerId) {
+        m_timer_manager.RemoveTimer(m_recovery_timer_id);
+    }
+    // stop background rounds before the meta tree they work on
+    m_write_recovery.reset();
+    m_block_gc.reset();
+}
 
 bool MasterImpl::Init() {
     m_status = kIsRunning;
+    m_liveness_timer_id = m_timer_manager.AddPeriodTimer(
+        FLAGS_rsfs_heartbeat_period,
+        NewPermanentClosure(this, &MasterImpl::CheckNodeLiveness));
+    if (FLAGS_rsfs_master_read_lease_period > 0) {
+        m_lease_timer_id = m_timer_manager.AddPeriodTimer(
+            FLAGS_rsfs_master_read_lease_period,
+            NewPermanentClosure(this, &MasterImpl::PurgeLease));
+    }
+    if (FLAGS_rsfs_master_gc_period > 0) {
+        m_gc_timer_id = m_timer_manager.AddPeriodTimer(
+            FLAGS_rsfs_master_gc_period,
+            NewPermanentClosure(this, &MasterImpl::CollectGarbage));
+    }
+    if (FLAGS_rsfs_master_write_lease_period > 0) {
+        // writers of files left open got a fresh lease after restart
+        std::vector<std::pair<std::string, uint64_t> > open_files;
+        m_meta_tree->LoadOpenFiles(&open_files);
+        for (uint32_t i = 0; i < open_files.size(); ++i) {
+            m_open_file_table->Add(open_files[i].first, open_files[i].second);
+        }
+        LOG(INFO) << "load " << open_files.size() << " files open for write";
+        m_recovery_timer_id = m_timer_manager.AddPeriodTimer(
+            FLAGS_rsfs_heartbeat_period,
+            NewPermanentClosure(this, &MasterImpl::RecoverOpenFile));
+    }
     return true;
 }
 
+void MasterImpl::CheckNodeLiveness(uint64_t timer_id) {
+    m_node_manager->CheckLiveness();
+}
+
+void MasterImpl::PurgeLease(uint64_t timer_id) {
+    m_lease_table->Purge();
+}
+
+void MasterImpl::CollectGarbage(uint64_t timer_id) {
+    m_block_gc->Schedule();
+}
+
+void MasterImpl::RecoverOpenFile(uint64_t timer_id) {
+    m_write_recovery->Schedule();
+}
+
 bool MasterImpl::OpenFile(const OpenFileRequest* request,
                           OpenFileResponse* response) {
     LOG(INFO) << "open file: " << request->ShortDebugString();
@@ -51,11 +135,13 @@ bool MasterImpl::CloseFile(const CloseFileRequest* request,
     tree_node.set_crash_num(request->crash_num());
 
     StatusCode status = kMasterOk;
-    if (!m_meta_tree->CloseFile(&tree_node, &status)) {
+    // a writer is fenced once recovery sealed or removed its file
+    if (!m_meta_tree->CloseFile(&tree_node, &status, request->fid())) {
         LOG(ERROR) << "fail to close meta tree";
         response->set_status(status);
         return false;
     }
+    m_open_file_table->Remove(request->file_name());
     response->set_status(status);
     return true;
 }
@@ -68,7 +154,9 @@ bool MasterImpl::ListFile(const ListFileRequest* request,
     StatusCode status = kMasterOk;
     std::string last_one;
     if (!m_meta_tree->ListFile(request->path_start(), request->path_end(),
-                               request->limit(), response->mutable_metas(),
+                               request->limit(), request->projection(),
+                               response->mutable_metas(),
+                               response->mutable_names(),
                                &last_one, &status)) {
         LOG(ERROR) << "fail to list file";
         response->set_status(status);
@@ -76,7 +164,103 @@ bool MasterImpl::ListFile(const ListFileRequest* request,
     }
     response->set_last_one(last_one);
     response->set_status(status);
-    return false;
+    return true;
+}
+
+bool MasterImpl::StatFile(const StatFileRequest* request,
+                          StatFileResponse* response) {
+    VLOG(5) << "stat file: " << request->file_names_size() << " files";
+    response->set_sequence_id(request->sequence_id());
+
+    std::vector<std::string> paths(request->file_names().begin(),
+                                   request->file_names().end());
+    std::vector<TreeNode> metas;
+    std::vector<StatusCode> codes;
+    m_meta_tree->StatFile(paths, &metas, &codes);
+    for (uint32_t i = 0; i < paths.size(); ++i) {
+        FileStat* stat = response->add_stats();
+        stat->set_file_name(paths[i]);
+        stat->set_status(codes[i]);
+        if (codes[i] != kMasterOk) {
+            continue;
+        }
+        const TreeNode& meta = metas[i];
+        stat->set_fid(meta.fid());
+        stat->set_file_size(meta.file_size());
+        stat->set_tail_slice(meta.tail_slice());
+        stat->set_tail_num(meta.tail_num());
+        stat->set_tail_copy_num(meta.tail_copy_num());
+        stat->set_crash_slice(meta.crash_slice());
+        stat->set_crash_num(meta.crash_num());
+        if (request->with_nodes()) {
+            stat->mutable_nodes()->CopyFrom(meta.chunks());
+            m_node_manager->FillNodeStatus(stat->mutable_nodes());
+            if (meta.status() == kMetaReady) {
+                stat->set_lease_period(m_lease_table->GrantRead(meta.name()));
+            }
+        }
+    }
+    response->set_status(kMasterOk);
+    return true;
+}
+
+bool MasterImpl::RemoveFile(const RemoveFileRequest* request,
+                            RemoveFileResponse* response) {
+    LOG(INFO) << "remove file: " << request->ShortDebugString();
+    response->set_sequence_id(request->sequence_id());
+
+    // blocks are still readable by whoever holds a read lease on meta.
+    // the lease is of the monotonic clock, the gc record keeps wall time
+    int64_t lease_remain_ms =
+        m_lease_table->GetReadExpireTime(request->file_name()) - utils::GetMillis();
+    int64_t not_before = utils::GetWallMillis()
+        + std::max(lease_remain_ms, static_cast<int64_t>(0));
+    StatusCode status = kMasterOk;
+    if (!m_meta_tree->RemoveFile(request->file_name(), not_before, false,
+                                 &status)) {
+        LOG(ERROR) << "fail to remove file: " << request->file_name()
+            << ", status: " << StatusCodeToString(status);
+        response->set_status(status);
+        return false;
+    }
+    response->set_status(status);
+    return true;
+}
+
+bool MasterImpl::RenewLease(const RenewLeaseRequest* request,
+                            RenewLeaseResponse* response) {
+    VLOG(5) << "renew lease: " << request->fids_size() << " files";
+    response->set_sequence_id(request->sequence_id());
+    for (int32_t i = 0; i < request->fids_size(); ++i) {
+        // the table is not loaded when recovery is disabled
+        if (!m_open_file_table->Renew(request->fids(i))
+            && FLAGS_rsfs_master_write_lease_period > 0) {
+            LOG(WARNING) << "write lease lost, fid: " << request->fids(i);
+            response->add_lost_fids(request->fids(i));
+        }
+    }
+    response->set_status(kMasterOk);
+    return true;
+}
+
+bool MasterImpl::SplitRange(const SplitRangeRequest* request,
+                            SplitRangeResponse* response) {
+    LOG(INFO) << "split range: " << request->ShortDebugString();
+    response->set_sequence_id(request->sequence_id());
+
+    StatusCode status = kMasterOk;
+    std::vector<std::string> split_keys;
+    if (!m_meta_tree->SplitRange(request->path_start(), request->path_end(),
+                                 request->split_num(), &split_keys, &status)) {
+        LOG(ERROR) << "fail to split range";
+        response->set_status(status);
+        return false;
+    }
+    for (uint32_t i = 0; i < split_keys.size(); ++i) {
+        response->add_split_keys(split_keys[i]);
+    }
+    response->set_status(status);
+    return true;
 }
 
 bool MasterImpl::Report(const ReportRequest* request,
@@ -84,6 +268,9 @@ bool MasterImpl::Report(const ReportRequest* request,
     LOG(INFO) << "report: " << request->ShortDebugString();
     response->set_sequence_id(request->sequence_id());
     m_node_manager->Report(request, response);
+    for (int32_t i = 0; i < request->writing_blocks_size(); ++i) {
+        m_open_file_table->Renew(utils::BlockFileId(request->writing_blocks(i)));
+    }
     return true;
 }
 
@@ -111,10 +298,17 @@ bool MasterImpl::OpenFileForRead(const OpenFileRequest* request,
     response->set_fid(tree_node.fid());
     response->set_file_size(tree_node.file_size());
     response->mutable_nodes()->CopyFrom(tree_node.chunks());
+    // let reader skip the nodes known as failed
+    m_node_manager->FillNodeStatus(response->mutable_nodes());
     response->set_tail_slice(tree_node.tail_slice());
     response->set_tail_num(tree_node.tail_num());
+    response->set_tail_copy_num(tree_node.tail_copy_num());
     response->set_crash_slice(tree_node.crash_slice());
     response->set_crash_num(tree_node.crash_num());
+    // meta of a closed file is immutable until removed, let reader cache it
+    if (tree_node.status() == kMetaReady) {
+        response->set_lease_period(m_lease_table->GrantRead(tree_node.name()));
+    }
     response->set_status(status);
     LOG(INFO) << "response: " << response->ShortDebugString();
     return true;
@@ -126,6 +320,9 @@ bool MasterImpl::OpenFileForWrite(const OpenFileRequest* request,
     tree_node.set_name(request->file_name());
     tree_node.set_status(kMetaWriteOpen);
     tree_node.set_chunk_num(request->node_num());
+    tree_node.set_rscode_m(request->rscode_m());
+    tree_node.set_rscode_k(request->rscode_k());
+    tree_node.set_block_size(request->block_size());
 
     StatusCode status = kMasterOk;
     if (!m_meta_tree->OpenFile(&tree_node, true, &status)) {
@@ -133,6 +330,7 @@ bool MasterImpl::OpenFileForWrite(const OpenFileRequest* request,
         response->set_status(status);
         return false;
     }
+    m_open_file_table->Add(tree_node.name(), tree_node.fid());
     response->set_fid(tree_node.fid());
     response->mutable_nodes()->CopyFrom(tree_node.chunks());
     response->set_status(status);
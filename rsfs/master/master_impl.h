@@ -9,7 +9,6 @@
 
 #include "common/base/scoped_ptr.h"
 #include "common/lock/mutex.h"
-#include "common/lock/rwlock.h"
 #include "common/timer/timer_manager.h"
 
 #include "rsfs/proto/master_rpc.pb.h"
@@ -17,8 +16,12 @@
 namespace rsfs {
 namespace master {
 
+class BlockGc;
+class LeaseTable;
 class NodeManager;
 class MetaTree;
+class OpenFileTable;
+class WriteRecovery;
 
 class MasterImpl {
 public:
@@ -44,6 +47,18 @@ public:
     bool ListFile(const ListFileRequest* request,
                   ListFileResponse* response);
 
+    bool SplitRange(const SplitRangeRequest* request,
+                    SplitRangeResponse* response);
+
+    bool StatFile(const StatFileRequest* request,
+                  StatFileResponse* response);
+
+    bool RemoveFile(const RemoveFileRequest* request,
+                    RemoveFileResponse* response);
+
+    bool RenewLease(const RenewLeaseRequest* request,
+                    RenewLeaseResponse* response);
+
     bool Report(const ReportRequest* request,
                 ReportResponse* response);
 
@@ -56,15 +71,27 @@ private:
     bool OpenFileForWrite(const OpenFileRequest* request,
                           OpenFileResponse* response);
 
+    void CheckNodeLiveness(uint64_t timer_id);
+    void PurgeLease(uint64_t timer_id);
+    void CollectGarbage(uint64_t timer_id);
+    void RecoverOpenFile(uint64_t timer_id);
+
 private:
     mutable Mutex m_status_mutex;
     MasterStatus m_status;
 
-    mutable RWLock m_rwlock;
     TimerManager m_timer_manager;
+    uint64_t m_liveness_timer_id;
+    uint64_t m_lease_timer_id;
+    uint64_t m_gc_timer_id;
+    uint64_t m_recovery_timer_id;
 
     scoped_ptr<NodeManager> m_node_manager;
     scoped_ptr<MetaTree> m_meta_tree;
+    scoped_ptr<LeaseTable> m_lease_table;
+    scoped_ptr<BlockGc> m_block_gc;
+    scoped_ptr<OpenFileTable> m_open_file_table;
+    scoped_ptr<WriteRecovery> m_write_recovery;
 };
 
 
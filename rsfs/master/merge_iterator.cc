@@ -0,0 +1,63 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/merge_iterator.h"
+
+#include "thirdparty/glog/logging.h"
+
+namespace rsfs {
+namespace master {
+
+MergeIterator::MergeIterator(const std::vector<leveldb::Iterator*>& children)
+    : m_children(children), m_current(NULL) {}
+
+MergeIterator::~MergeIterator() {
+    for (uint32_t i = 0; i < m_children.size(); ++i) {
+        delete m_children[i];
+    }
+}
+
+void MergeIterator::Seek(const leveldb::Slice& target) {
+    for (uint32_t i = 0; i < m_children.size(); ++i) {
+        m_children[i]->Seek(target);
+    }
+    FindSmallest();
+}
+
+void MergeIterator::Next() {
+    CHECK(Valid());
+    m_current->Next();
+    FindSmallest();
+}
+
+bool MergeIterator::Valid() const {
+    return m_current != NULL;
+}
+
+leveldb::Slice MergeIterator::key() const {
+    return m_current->key();
+}
+
+leveldb::Slice MergeIterator::value() const {
+    return m_current->value();
+}
+
+void MergeIterator::FindSmallest() {
+    // shard num is small, a linear pick is cheaper than a heap
+    m_current = NULL;
+    for (uint32_t i = 0; i < m_children.size(); ++i) {
+        leveldb::Iterator* child = m_children[i];
+        if (!child->Valid()) {
+            continue;
+        }
+        if (m_current == NULL || child->key().compare(m_current->key()) < 0) {
+            m_current = child;
+        }
+    }
+}
+
+} // namespace master
+} // namespace rsfs
@@ -0,0 +1,42 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_MERGE_ITERATOR_H
+#define RSFS_MASTER_MERGE_ITERATOR_H
+
+#include <vector>
+
+#include "leveldb/iterator.h"
+#include "leveldb/slice.h"
+
+namespace rsfs {
+namespace master {
+
+// forward-only iterator yielding the union of several sorted
+// db iterators in key order. takes ownership of the children.
+class MergeIterator {
+public:
+    MergeIterator(const std::vector<leveldb::Iterator*>& children);
+    ~MergeIterator();
+
+    void Seek(const leveldb::Slice& target);
+    void Next();
+    bool Valid() const;
+    leveldb::Slice key() const;
+    leveldb::Slice value() const;
+
+private:
+    void FindSmallest();
+
+private:
+    std::vector<leveldb::Iterator*> m_children;
+    leveldb::Iterator* m_current;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_MERGE_ITERATOR_H
@@ -0,0 +1,62 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/meta_cache.h"
+
+#include "thirdparty/glog/logging.h"
+
+namespace rsfs {
+namespace master {
+
+MetaCache::MetaCache(uint64_t capacity)
+    : m_cache(NULL) {
+    if (capacity > 0) {
+        m_cache = leveldb::NewLRUCache(capacity);
+    }
+    LOG(INFO) << "meta cache capacity: " << capacity << " bytes";
+}
+
+MetaCache::~MetaCache() {
+    delete m_cache;
+}
+
+bool MetaCache::Lookup(const std::string& path, TreeNode* meta) {
+    if (m_cache == NULL) {
+        return false;
+    }
+    leveldb::Cache::Handle* handle = m_cache->Lookup(path);
+    if (handle == NULL) {
+        return false;
+    }
+    meta->CopyFrom(*reinterpret_cast<TreeNode*>(m_cache->Value(handle)));
+    m_cache->Release(handle);
+    return true;
+}
+
+void MetaCache::Insert(const TreeNode& meta) {
+    if (m_cache == NULL) {
+        return;
+    }
+    TreeNode* node = new TreeNode(meta);
+    size_t charge = node->SpaceUsed() + node->name().size();
+    leveldb::Cache::Handle* handle =
+        m_cache->Insert(node->name(), node, charge, &MetaCache::DeleteEntry);
+    m_cache->Release(handle);
+}
+
+void MetaCache::Erase(const std::string& path) {
+    if (m_cache == NULL) {
+        return;
+    }
+    m_cache->Erase(path);
+}
+
+void MetaCache::DeleteEntry(const leveldb::Slice& key, void* value) {
+    delete reinterpret_cast<TreeNode*>(value);
+}
+
+} // namespace master
+} // namespace rsfs
@@ -0,0 +1,41 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_META_CACHE_H
+#define RSFS_MASTER_META_CACHE_H
+
+#include <string>
+
+#include "leveldb/cache.h"
+
+#include "rsfs/proto/meta_tree.pb.h"
+
+namespace rsfs {
+namespace master {
+
+// write-through cache of decoded tree nodes, keyed by full path.
+// it is backed by leveldb's sharded LRU cache and charged by the
+// memory each decoded node occupies.
+class MetaCache {
+public:
+    MetaCache(uint64_t capacity);
+    ~MetaCache();
+
+    bool Lookup(const std::string& path, TreeNode* meta);
+    void Insert(const TreeNode& meta);
+    void Erase(const std::string& path);
+
+private:
+    static void DeleteEntry(const leveldb::Slice& key, void* value);
+
+private:
+    leveldb::Cache* m_cache;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_META_CACHE_H
@@ -6,44 +6,162 @@
 
 #include "rsfs/master/meta_tree.h"
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+
 #include "common/base/string_ext.h"
+#include "common/base/string_number.h"
+#include "leveldb/write_batch.h"
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 
+#include "rsfs/master/fid_allocator.h"
+#include "rsfs/master/meta_cache.h"
+#include "rsfs/master/merge_iterator.h"
 #include "rsfs/master/node_manager.h"
+#include "rsfs/master/path_lock.h"
 #include "rsfs/proto/proto_helper.h"
-#include "rsfs/utils/atomic.h"
+#include "rsfs/utils/hash.h"
 
 DECLARE_string(rsfs_master_db_path);
 DECLARE_string(rsfs_master_dirmeta_path);
 DECLARE_string(rsfs_master_filemeta_path);
+DECLARE_int32(rsfs_master_meta_cache_size);
+DECLARE_int32(rsfs_master_filemeta_shard_num);
+DECLARE_int32(rsfs_master_path_lock_stripe_num);
+DECLARE_bool(rsfs_master_meta_sync_enabled);
 
 namespace rsfs {
 namespace master {
 
+const std::string kFileShardNumKey = std::string("\x01") + "file_meta_shard_num";
+const std::string kGcKeyPrefix = std::string("\x01") + "gc/";
+
+const std::string kOpenKeyPrefix = std::string("\x01") + "open/";
+
+static std::string GcKey(uint64_t fid) {
+    return kGcKeyPrefix + NumberToString(fid);
+}
+
+static std::string OpenKey(uint64_t fid) {
+    return kOpenKeyPrefix + NumberToString(fid);
+}
+
+// a key between low and high (low < high), by averaging the 8 bytes
+// following their common prefix as big-endian integers.
+// return low if no such key can be found.
+static std::string GetMiddleKey(const std::string& low, const std::string& high) {
+    size_t prefix_len = 0;
+    while (prefix_len < low.size() && prefix_len < high.size()
+           && low[prefix_len] == high[prefix_len]) {
+        ++prefix_len;
+    }
+    uint64_t low_num = 0;
+    uint64_t high_num = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        size_t pos = prefix_len + i;
+        low_num = (low_num << 8)
+            | (pos < low.size() ? static_cast<uint8_t>(low[pos]) : 0);
+        high_num = (high_num << 8)
+            | (pos < high.size() ? static_cast<uint8_t>(high[pos]) : 0);
+    }
+    if (high_num <= low_num + 1) {
+        return low;
+    }
+    uint64_t mid_num = low_num + (high_num - low_num) / 2;
+    std::string mid_key = high.substr(0, prefix_len);
+    for (int32_t i = sizeof(uint64_t) - 1; i >= 0; --i) {
+        mid_key.push_back(static_cast<char>((mid_num >> (i * 8)) & 0xff));
+    }
+    while (mid_key.size() > prefix_len + 1 && mid_key[mid_key.size() - 1] == '\0') {
+        mid_key.erase(mid_key.size() - 1);
+    }
+    return mid_key;
+}
+
 MetaTree::MetaTree(NodeManager* node_manager)
-    : m_file_id(1), m_dir_meta(NULL), m_file_meta(NULL),
+    : m_dir_shard(NULL),
       m_dir_meta_path(FLAGS_rsfs_master_db_path + "/" +
-                        FLAGS_rsfs_master_dirmeta_path),
+                      FLAGS_rsfs_master_dirmeta_path),
       m_file_meta_path(FLAGS_rsfs_master_db_path + "/" +
                        FLAGS_rsfs_master_filemeta_path),
-      m_node_manager(node_manager) {
-    LoadDatabase(m_dir_meta_path, &m_dir_meta);
-    LoadDatabase(m_file_meta_path, &m_file_meta);
+      m_node_manager(node_manager),
+      m_meta_cache(new MetaCache(FLAGS_rsfs_master_meta_cache_size * 1024ULL * 1024)),
+      m_path_locks(new PathLockTable(FLAGS_rsfs_master_path_lock_stripe_num)) {
+    // the concurrent writes are grouped into one log write by leveldb
+    m_write_options.sync = FLAGS_rsfs_master_meta_sync_enabled;
+    LoadDatabase(m_dir_meta_path, &m_dir_shard);
+    bool has_shard_num = CheckShardNum();
+
+    // keep the legacy single file meta layout when not sharded
+    int32_t shard_num = FLAGS_rsfs_master_filemeta_shard_num;
+    m_file_shards.resize(shard_num);
+    for (int32_t i = 0; i < shard_num; ++i) {
+        std::string shard_path = m_file_meta_path;
+        if (shard_num > 1) {
+            shard_path += "_" + NumberToString(i);
+        }
+        LoadDatabase(shard_path, &m_file_shards[i]);
+    }
+    if (!has_shard_num) {
+        RecordShardNum();
+    }
+
+    m_fid_allocator.reset(new FidAllocator(m_dir_shard));
+    bool has_mark = false;
+    CHECK(m_fid_allocator->Load(&has_mark)) << ", fail to load fid allocator";
+    if (!has_mark) {
+        // the db of an older master, whose ids are still used by blocks
+        // on snode, must not hand them out again
+        CHECK(m_fid_allocator->Reset(ScanMaxFid()))
+            << ", fail to reset fid allocator";
+    }
 }
 
-MetaTree::~MetaTree() {}
+MetaTree::~MetaTree() {
+    for (uint32_t i = 0; i < m_file_shards.size(); ++i) {
+        delete m_file_shards[i];
+    }
+    m_fid_allocator.reset();
+    delete m_dir_shard;
+}
 
 bool MetaTree::OpenFile(TreeNode* meta,
                         bool create_if_miss, StatusCode* code) {
-    leveldb::DB* access_db = PickDatabse(meta->name(), code);
-    if (access_db == NULL) {
+    leveldb::DB* shard = PickShard(meta->name(), code);
+    if (shard == NULL) {
         return false;
     }
 
+    // creation is a check-then-write, serialize it on the path.
+    // read opens hitting cache go without lock
+    scoped_ptr<PathLocker> locker;
+    if (meta->status() != kMetaReadOpen) {
+        locker.reset(new PathLocker(m_path_locks.get(), meta->name()));
+    }
+
+    TreeNode cached_meta;
+    if (m_meta_cache->Lookup(meta->name(), &cached_meta)) {
+        if (meta->status() == kMetaReadOpen) {
+            VLOG(5) << "meta cache hit (path: " << meta->name() << ")";
+            meta->Swap(&cached_meta);
+            return true;
+        }
+        LOG(INFO) << "meta has been exist (path: " << meta->name() << ")";
+        *code = kIOError;
+        return false;
+    }
+    if (locker.get() == NULL) {
+        // the meta read is put into cache, which must not race with a
+        // remove, or the removed meta comes back to cache
+        locker.reset(new PathLocker(m_path_locks.get(), meta->name()));
+    }
+
     std::string value;
-    leveldb::Status status = access_db->Get(leveldb::ReadOptions(),
-                                            meta->name(), &value);
+    leveldb::Status status = shard->Get(leveldb::ReadOptions(),
+                                        meta->name(), &value);
     if (status.ok() && meta->status() == kMetaReadOpen) {
         LOG(INFO) << "meta found (path: " << meta->name() << ")";
         if (value.empty() || !StringToTreeNodePB(value, meta)) {
@@ -51,7 +169,12 @@ bool MetaTree::OpenFile(TreeNode* meta,
             *code = kIOError;
             return false;
         }
+        m_meta_cache->Insert(*meta);
         return true;
+    } else if (!status.ok() && meta->status() == kMetaReadOpen) {
+        LOG(INFO) << "meta not exist (path: " << meta->name() << ")";
+        *code = status.IsNotFound() ? kKeyNotExist : kIOError;
+        return false;
     } else if (status.ok() && meta->status() == kMetaWriteOpen) {
         LOG(INFO) << "meta has been exist (path: " << meta->name() << ")";
         *code = kIOError;
@@ -68,7 +191,13 @@ bool MetaTree::OpenFile(TreeNode* meta,
         *code = kMasterNotAlloc;
         return false;
     }
-    meta->set_fid(atomic_inc_ret_old64(&m_file_id));
+    uint64_t fid = 0;
+    if (!m_fid_allocator->Alloc(&fid)) {
+        LOG(ERROR) << "fail to allocate file id (path: " << meta->name() << ")";
+        *code = kIOError;
+        return false;
+    }
+    meta->set_fid(fid);
     meta->set_file_size(0);
 //     meta->set_crash_slice(-1);
 //     meta->set_crash_num(0);
@@ -79,31 +208,49 @@ bool MetaTree::OpenFile(TreeNode* meta,
         *code = kIOError;
         return false;
     }
-    status = access_db->Put(leveldb::WriteOptions(), meta->name(), value);
+    // record the open file with meta, so it can be recovered
+    // even if master restarts before the writer closes it
+    leveldb::WriteBatch batch;
+    batch.Put(meta->name(), value);
+    if (meta->status() == kMetaWriteOpen) {
+        batch.Put(OpenKey(fid), meta->name());
+    }
+    status = shard->Write(m_write_options, &batch);
     if (!status.ok()) {
         LOG(ERROR) << "fail to put meta node to storage (path: " << meta->name() << ")";
         *code = kIOError;
         return false;
     }
+    m_meta_cache->Insert(*meta);
     return true;
 }
 
-bool MetaTree::CloseFile(TreeNode* meta, StatusCode* code) {
-    leveldb::DB* access_db = PickDatabse(meta->name(), code);
-    if (access_db == NULL) {
+bool MetaTree::CloseFile(TreeNode* meta, StatusCode* code, uint64_t open_fid) {
+    leveldb::DB* shard = PickShard(meta->name(), code);
+    if (shard == NULL) {
         return false;
     }
+    PathLocker locker(m_path_locks.get(), meta->name());
 
     std::string value;
-    leveldb::Status status = access_db->Get(leveldb::ReadOptions(),
-                                            meta->name(), &value);
-    if (!status.ok() || value.empty()) {
-        LOG(ERROR) << "dirty meta info (path: " << meta->name() << ")";
-        return false;
-    }
+    leveldb::Status status;
     TreeNode org_meta;
-    if (!StringToTreeNodePB(value, &org_meta)) {
-        LOG(ERROR) << "fail to parse tree meta (path: " << meta->name() << ")";
+    if (!m_meta_cache->Lookup(meta->name(), &org_meta)) {
+        status = shard->Get(leveldb::ReadOptions(), meta->name(), &value);
+        if (!status.ok() || value.empty()) {
+            LOG(ERROR) << "dirty meta info (path: " << meta->name() << ")";
+            return false;
+        }
+        if (!StringToTreeNodePB(value, &org_meta)) {
+            LOG(ERROR) << "fail to parse tree meta (path: " << meta->name() << ")";
+            return false;
+        }
+    }
+    if (open_fid != 0
+        && (org_meta.fid() != open_fid || org_meta.status() != kMetaWriteOpen)) {
+        LOG(INFO) << "file #" << open_fid << " not open any more (path: "
+            << meta->name() << ")";
+        *code = kKeyNotExist;
         return false;
     }
     if (org_meta.status() == kMetaWriteOpen) {
@@ -111,6 +258,7 @@ bool MetaTree::CloseFile(TreeNode* meta, StatusCode* code) {
         if (meta->tail_slice() >= 0) {
             org_meta.set_tail_slice(meta->tail_slice());
             org_meta.set_tail_num(meta->tail_num());
+            org_meta.set_tail_copy_num(meta->tail_copy_num());
         }
     } else if (org_meta.crash_slice() != meta->crash_slice()
                || org_meta.crash_num() != meta->crash_num()) {
@@ -119,6 +267,7 @@ bool MetaTree::CloseFile(TreeNode* meta, StatusCode* code) {
     }
     LOG(INFO) << "updated meta: " << org_meta.ShortDebugString();
 
+    bool is_write_open = (org_meta.status() == kMetaWriteOpen);
     org_meta.set_status(kMetaReady);
     value = "";
     if (!TreeNodePBToString(org_meta, &value)) {
@@ -126,42 +275,326 @@ bool MetaTree::CloseFile(TreeNode* meta, StatusCode* code) {
         *code = kIOError;
         return false;
     }
-    status = access_db->Put(leveldb::WriteOptions(), org_meta.name(), value);
+    leveldb::WriteBatch batch;
+    batch.Put(org_meta.name(), value);
+    if (is_write_open) {
+        batch.Delete(OpenKey(org_meta.fid()));
+    }
+    status = shard->Write(m_write_options, &batch);
     if (!status.ok()) {
         LOG(ERROR) << "fail to put meta node to storage (path: " << org_meta.name() << ")";
         *code = kIOError;
         return false;
     }
-
+    m_meta_cache->Insert(org_meta);
     return true;
 }
 
 bool MetaTree::ListFile(const std::string& path_start,
                         const std::string& path_end, uint64_t size_limit,
-                        TreeNodeList* meta_list, std::string* last_key,
-                        StatusCode* code) {
-    leveldb::DB* access_db = PickDatabse(path_start, code);
-    if (access_db == NULL) {
+                        ListFileRequest::Projection projection,
+                        TreeNodeList* meta_list, NameList* name_list,
+                        std::string* last_key, StatusCode* code) {
+    leveldb::DB* shard = PickShard(path_start, code);
+    if (shard == NULL) {
         return false;
     }
 
+    std::vector<leveldb::DB*> shard_list;
+    GetShardList(shard, &shard_list);
+    std::vector<leveldb::Iterator*> children;
+    for (uint32_t i = 0; i < shard_list.size(); ++i) {
+        children.push_back(shard_list[i]->NewIterator(leveldb::ReadOptions()));
+    }
+
     uint64_t size = 0;
-    leveldb::Iterator* it = access_db->NewIterator(leveldb::ReadOptions());
-    for (it->Seek(path_start); it->Valid() && it->key().ToString() < path_end
-         && size <= size_limit; it->Next()) {
-        TreeNode meta;
-        if (!StringToTreeNodePB(it->value().ToString(), &meta)) {
+    leveldb::Slice end_key(path_end);
+    last_key->clear();
+    MergeIterator* it = new MergeIterator(children);
+    for (it->Seek(path_start); it->Valid() && it->key().compare(end_key) < 0;
+         it->Next()) {
+        leveldb::Slice key = it->key();
+        // always return something to make sure the caller moves forward
+        if (size > 0 && size >= size_limit) {
+            last_key->assign(key.data(), key.size());
+            break;
+        }
+        if (projection == ListFileRequest::NAME) {
+            name_list->Add()->assign(key.data(), key.size());
+            size += key.size();
+            continue;
+        }
+        leveldb::Slice value = it->value();
+        TreeNode* meta = meta_list->Add();
+        bool parsed = (projection == ListFileRequest::SUMMARY)
+            ? ArrayToTreeNodeSummaryPB(value.data(), value.size(), meta)
+            : ArrayToTreeNodePB(value.data(), value.size(), meta);
+        if (!parsed) {
             LOG(WARNING) << "fail to parse tree meta (path: "
-                << it->key().ToString() << "), skip";
+                << key.ToString() << "), skip";
+            meta_list->RemoveLast();
             continue;
         }
-        meta_list->Add()->CopyFrom(meta);
-        size += meta.ByteSize();
+        size += value.size();
     }
     delete it;
     return true;
 }
 
+void MetaTree::StatFile(const std::vector<std::string>& paths,
+                        std::vector<TreeNode>* metas,
+                        std::vector<StatusCode>* codes) {
+    typedef std::vector<std::pair<std::string, uint32_t> > PathList;
+    std::map<leveldb::DB*, PathList> shard_paths;
+    metas->resize(paths.size());
+    codes->assign(paths.size(), kKeyNotExist);
+    for (uint32_t i = 0; i < paths.size(); ++i) {
+        if (m_meta_cache->Lookup(paths[i], &(*metas)[i])) {
+            (*codes)[i] = kMasterOk;
+            continue;
+        }
+        leveldb::DB* shard = PickShard(paths[i], &(*codes)[i]);
+        if (shard != NULL) {
+            shard_paths[shard].push_back(std::make_pair(paths[i], i));
+        }
+    }
+
+    std::map<leveldb::DB*, PathList>::iterator shard_it = shard_paths.begin();
+    for (; shard_it != shard_paths.end(); ++shard_it) {
+        PathList& path_list = shard_it->second;
+        // in key order, so the reads of a batch share the table blocks
+        std::sort(path_list.begin(), path_list.end());
+        leveldb::DB* db = shard_it->first;
+        for (uint32_t i = 0; i < path_list.size(); ++i) {
+            const std::string& path = path_list[i].first;
+            uint32_t index = path_list[i].second;
+            // read and cache under the path lock, so a remove between
+            // them cannot leave the removed meta in cache
+            PathLocker locker(m_path_locks.get(), path);
+            std::string value;
+            leveldb::Status status = db->Get(leveldb::ReadOptions(), path, &value);
+            if (status.IsNotFound()) {
+                continue;
+            }
+            if (!status.ok()
+                || !ArrayToTreeNodePB(value.data(), value.size(), &(*metas)[index])) {
+                LOG(ERROR) << "fail to load tree meta (path: " << path << ")";
+                (*codes)[index] = kIOError;
+                continue;
+            }
+            (*codes)[index] = kMasterOk;
+            m_meta_cache->Insert((*metas)[index]);
+        }
+    }
+}
+
+bool MetaTree::SplitRange(const std::string& path_start,
+                          const std::string& path_end, uint32_t split_num,
+                          std::vector<std::string>* split_keys,
+                          StatusCode* code) {
+    const uint32_t kMaxSplitNum = 1024;
+    const int32_t kMaxBisectNum = 32;
+    leveldb::DB* shard = PickShard(path_start, code);
+    if (shard == NULL) {
+        return false;
+    }
+    if (path_start >= path_end || split_num <= 1) {
+        return true;
+    }
+    if (split_num > kMaxSplitNum) {
+        split_num = kMaxSplitNum;
+    }
+
+    std::vector<leveldb::DB*> shard_list;
+    GetShardList(shard, &shard_list);
+    uint64_t total_size = GetApproximateSize(shard_list, path_start, path_end);
+    if (total_size == 0) {
+        // nothing flushed to table yet, not worth to split
+        return true;
+    }
+
+    std::string lower = path_start;
+    for (uint32_t i = 1; i < split_num; ++i) {
+        uint64_t target_size = total_size / split_num * i;
+        std::string low_key = lower;
+        std::string high_key = path_end;
+        for (int32_t n = 0; n < kMaxBisectNum; ++n) {
+            std::string mid_key = GetMiddleKey(low_key, high_key);
+            if (mid_key <= low_key || mid_key >= high_key) {
+                break;
+            }
+            if (GetApproximateSize(shard_list, path_start, mid_key) < target_size) {
+                low_key = mid_key;
+            } else {
+                high_key = mid_key;
+            }
+        }
+        if (high_key > lower && high_key < path_end) {
+            split_keys->push_back(high_key);
+            lower = high_key;
+        }
+    }
+    VLOG(5) << "split [" << path_start << ", " << path_end << ") into "
+        << split_keys->size() + 1 << " ranges, approximate size: " << total_size;
+    return true;
+}
+
+bool MetaTree::RemoveFile(const std::string& path, int64_t not_before,
+                          bool abort_write, StatusCode* code, uint64_t open_fid) {
+    leveldb::DB* shard = PickShard(path, code);
+    if (shard == NULL) {
+        return false;
+    }
+    PathLocker locker(m_path_locks.get(), path);
+
+    TreeNode meta;
+    if (!m_meta_cache->Lookup(path, &meta)) {
+        std::string value;
+        leveldb::Status status = shard->Get(leveldb::ReadOptions(),
+                                            path, &value);
+        if (status.IsNotFound()) {
+            LOG(INFO) << "meta not exist (path: " << path << ")";
+            *code = kKeyNotExist;
+            return false;
+        }
+        if (!status.ok() || !StringToTreeNodePB(value, &meta)) {
+            LOG(ERROR) << "fail to load tree meta (path: " << path << ")";
+            *code = kIOError;
+            return false;
+        }
+    }
+    bool is_write_open = (meta.status() == kMetaWriteOpen);
+    if (open_fid != 0 && (meta.fid() != open_fid || !is_write_open)) {
+        LOG(INFO) << "file #" << open_fid << " not open any more (path: "
+            << path << ")";
+        *code = kKeyNotExist;
+        return false;
+    }
+    if (is_write_open && !abort_write) {
+        LOG(WARNING) << "meta is being written (path: " << path << ")";
+        *code = kMetaWriteOpen;
+        return false;
+    }
+
+    GcRecord record;
+    record.set_fid(meta.fid());
+    record.set_name(path);
+    record.mutable_chunks()->Swap(meta.mutable_chunks());
+    for (int32_t i = 0; i < record.chunks_size(); ++i) {
+        record.add_pending(i);
+    }
+    record.set_not_before(not_before);
+    std::string record_str;
+    if (!record.SerializeToString(&record_str)) {
+        LOG(ERROR) << "fail to serialize gc record (path: " << path << ")";
+        *code = kIOError;
+        return false;
+    }
+
+    // the record lives in the shard of the path, so that both keys
+    // are committed atomically
+    leveldb::WriteBatch batch;
+    batch.Delete(path);
+    if (is_write_open) {
+        batch.Delete(OpenKey(record.fid()));
+    }
+    batch.Put(GcKey(record.fid()), record_str);
+    leveldb::Status status = shard->Write(m_write_options, &batch);
+    m_meta_cache->Erase(path);
+    if (!status.ok()) {
+        LOG(ERROR) << "fail to remove meta (path: " << path
+            << "), status: " << status.ToString();
+        *code = kIOError;
+        return false;
+    }
+    LOG(INFO) << "meta removed (path: " << path << ", fid: " << record.fid()
+        << ", blocks: " << record.pending_size() << ")";
+    return true;
+}
+
+void MetaTree::ScanGarbage(const std::string& start_key, uint32_t limit,
+                           int64_t now, std::vector<GcRecord>* records,
+                           std::string* next_key) {
+    std::vector<leveldb::Iterator*> children;
+    children.push_back(m_dir_shard->NewIterator(leveldb::ReadOptions()));
+    for (uint32_t i = 0; i < m_file_shards.size(); ++i) {
+        children.push_back(m_file_shards[i]->NewIterator(leveldb::ReadOptions()));
+    }
+
+    leveldb::Slice prefix(kGcKeyPrefix);
+    uint32_t scan_num = 0;
+    next_key->clear();
+    MergeIterator* it = new MergeIterator(children);
+    it->Seek(start_key < kGcKeyPrefix ? kGcKeyPrefix : start_key);
+    for (; it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        if (scan_num >= limit) {
+            next_key->assign(it->key().data(), it->key().size());
+            break;
+        }
+        ++scan_num;
+        GcRecord record;
+        leveldb::Slice value = it->value();
+        if (!record.ParseFromArray(value.data(), value.size())) {
+            LOG(ERROR) << "fail to parse gc record: " << it->key().ToString();
+            continue;
+        }
+        if (record.not_before() <= now) {
+            records->push_back(record);
+        }
+    }
+    delete it;
+}
+
+void MetaTree::LoadOpenFiles(std::vector<std::pair<std::string, uint64_t> >* files) {
+    std::vector<leveldb::Iterator*> children;
+    children.push_back(m_dir_shard->NewIterator(leveldb::ReadOptions()));
+    for (uint32_t i = 0; i < m_file_shards.size(); ++i) {
+        children.push_back(m_file_shards[i]->NewIterator(leveldb::ReadOptions()));
+    }
+
+    leveldb::Slice prefix(kOpenKeyPrefix);
+    MergeIterator* it = new MergeIterator(children);
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+         it->Next()) {
+        std::string fid_str(it->key().data() + prefix.size(),
+                            it->key().size() - prefix.size());
+        uint64_t fid = 0;
+        if (!StringToNumber(fid_str, &fid)) {
+            LOG(ERROR) << "invalid open file key: " << it->key().ToString();
+            continue;
+        }
+        files->push_back(std::make_pair(it->value().ToString(), fid));
+    }
+    delete it;
+}
+
+bool MetaTree::UpdateGarbage(const GcRecord& record) {
+    StatusCode code = kMasterOk;
+    leveldb::DB* shard = PickShard(record.name(), &code);
+    if (shard == NULL) {
+        return false;
+    }
+    leveldb::WriteBatch batch;
+    if (record.pending_size() == 0) {
+        batch.Delete(GcKey(record.fid()));
+    } else {
+        std::string record_str;
+        if (!record.SerializeToString(&record_str)) {
+            LOG(ERROR) << "fail to serialize gc record (fid: "
+                << record.fid() << ")";
+            return false;
+        }
+        batch.Put(GcKey(record.fid()), record_str);
+    }
+    leveldb::Status status = shard->Write(m_write_options, &batch);
+    if (!status.ok()) {
+        LOG(ERROR) << "fail to update gc record (fid: " << record.fid()
+            << "), status: " << status.ToString();
+        return false;
+    }
+    return true;
+}
+
 bool MetaTree::LoadDatabase(const std::string& db_path, leveldb::DB** db_handler) {
     leveldb::Options options;
     options.create_if_missing = true;
@@ -171,9 +604,157 @@ bool MetaTree::LoadDatabase(const std::string& db_path, leveldb::DB** db_handler
     return true;
 }
 
-leveldb::DB* MetaTree::PickDatabse(const std::string& full_path,
-                                   StatusCode* code) {
-    LOG(INFO) << "pick database by path: " << full_path;
+bool MetaTree::CheckShardNum() {
+    // rehashing is not supported, refuse to start on a changed shard num
+    CHECK_GT(FLAGS_rsfs_master_filemeta_shard_num, 0);
+    std::string shard_num_str = NumberToString(FLAGS_rsfs_master_filemeta_shard_num);
+    std::string value;
+    leveldb::Status status = m_dir_shard->Get(leveldb::ReadOptions(),
+                                              kFileShardNumKey, &value);
+    if (status.ok()) {
+        CHECK_EQ(value, shard_num_str) << ", file meta shard num mismatch";
+        return true;
+    }
+    CHECK(status.IsNotFound()) << ", fail to load shard num: "
+        << status.ToString();
+    return false;
+}
+
+void MetaTree::RecordShardNum() {
+    if (m_file_shards.size() > 1) {
+        MigrateLegacyShard();
+    }
+    // recorded after the migration, which is done again if it breaks
+    std::string shard_num_str = NumberToString(m_file_shards.size());
+    leveldb::Status status = PutMeta(m_dir_shard, kFileShardNumKey, shard_num_str);
+    CHECK(status.ok()) << ", fail to persist shard num: " << status.ToString();
+}
+
+static void WriteBatches(std::map<leveldb::DB*, leveldb::WriteBatch>* batches) {
+    leveldb::WriteOptions write_options;
+    write_options.sync = true;
+    std::map<leveldb::DB*, leveldb::WriteBatch>::iterator it = batches->begin();
+    for (; it != batches->end(); ++it) {
+        leveldb::Status status = it->first->Write(write_options, &it->second);
+        CHECK(status.ok()) << ", fail to migrate file meta: " << status.ToString();
+    }
+    batches->clear();
+}
+
+void MetaTree::MigrateLegacyShard() {
+    const uint32_t kMigrateBatchNum = 1024;
+    struct stat st;
+    if (stat((m_file_meta_path + "/CURRENT").c_str(), &st) != 0) {
+        return;
+    }
+    leveldb::DB* legacy_db = NULL;
+    LoadDatabase(m_file_meta_path, &legacy_db);
+    LOG(WARNING) << "migrate unsharded file meta into " << m_file_shards.size()
+        << " shards: " << m_file_meta_path;
+
+    leveldb::Slice gc_prefix(kGcKeyPrefix);
+    leveldb::Slice open_prefix(kOpenKeyPrefix);
+    std::map<leveldb::DB*, leveldb::WriteBatch> batches;
+    uint64_t key_num = 0;
+    leveldb::Iterator* it = legacy_db->NewIterator(leveldb::ReadOptions());
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        // the open and gc records go with the meta of their file
+        std::string path = it->key().ToString();
+        if (it->key().starts_with(open_prefix)) {
+            path = it->value().ToString();
+        } else if (it->key().starts_with(gc_prefix)) {
+            GcRecord record;
+            CHECK(record.ParseFromArray(it->value().data(), it->value().size()))
+                << ", invalid gc record: " << it->key().ToString();
+            path = record.name();
+        }
+        StatusCode code = kMasterOk;
+        leveldb::DB* shard = PickShard(path, &code);
+        CHECK(shard != NULL && shard != m_dir_shard)
+            << ", invalid file meta key: " << it->key().ToString();
+        batches[shard].Put(it->key(), it->value());
+        if (++key_num % kMigrateBatchNum == 0) {
+            WriteBatches(&batches);
+        }
+    }
+    CHECK(it->status().ok()) << ", fail to read unsharded file meta: "
+        << it->status().ToString();
+    delete it;
+    WriteBatches(&batches);
+    delete legacy_db;
+    LOG(WARNING) << "migrate " << key_num << " keys of file meta, the unsharded "
+        << "db is not used any more: " << m_file_meta_path;
+}
+
+uint64_t MetaTree::ScanMaxFid() {
+    std::vector<leveldb::Iterator*> children;
+    children.push_back(m_dir_shard->NewIterator(leveldb::ReadOptions()));
+    for (uint32_t i = 0; i < m_file_shards.size(); ++i) {
+        children.push_back(m_file_shards[i]->NewIterator(leveldb::ReadOptions()));
+    }
+
+    leveldb::Slice gc_prefix(kGcKeyPrefix);
+    leveldb::Slice open_prefix(kOpenKeyPrefix);
+    uint64_t max_fid = 0;
+    uint64_t meta_num = 0;
+    MergeIterator* it = new MergeIterator(children);
+    for (it->Seek(leveldb::Slice()); it->Valid(); it->Next()) {
+        leveldb::Slice key = it->key();
+        uint64_t fid = 0;
+        if (key.starts_with(gc_prefix) || key.starts_with(open_prefix)) {
+            size_t prefix_size = key.starts_with(gc_prefix) ?
+                gc_prefix.size() : open_prefix.size();
+            std::string fid_str(key.data() + prefix_size, key.size() - prefix_size);
+            if (!StringToNumber(fid_str, &fid)) {
+                LOG(ERROR) << "invalid fid key: " << key.ToString();
+                continue;
+            }
+        } else if (!key.empty() && key[0] == '\x01') {
+            // the other reserved keys
+            continue;
+        } else {
+            TreeNode meta;
+            if (!StringToTreeNodePB(it->value().ToString(), &meta)) {
+                LOG(ERROR) << "fail to parse tree meta: " << key.ToString();
+                continue;
+            }
+            fid = meta.fid();
+            meta_num++;
+        }
+        max_fid = std::max(max_fid, fid);
+    }
+    delete it;
+    LOG(INFO) << "scan " << meta_num << " metas, max fid: " << max_fid;
+    return max_fid;
+}
+
+void MetaTree::GetShardList(leveldb::DB* shard,
+                            std::vector<leveldb::DB*>* shard_list) {
+    if (shard == m_dir_shard) {
+        shard_list->push_back(shard);
+        return;
+    }
+    for (uint32_t i = 0; i < m_file_shards.size(); ++i) {
+        shard_list->push_back(m_file_shards[i]);
+    }
+}
+
+uint64_t MetaTree::GetApproximateSize(const std::vector<leveldb::DB*>& shard_list,
+                                      const std::string& start,
+                                      const std::string& end) {
+    leveldb::Range range(start, end);
+    uint64_t total_size = 0;
+    for (uint32_t i = 0; i < shard_list.size(); ++i) {
+        uint64_t size = 0;
+        shard_list[i]->GetApproximateSizes(&range, 1, &size);
+        total_size += size;
+    }
+    return total_size;
+}
+
+leveldb::DB* MetaTree::PickShard(const std::string& full_path,
+                                 StatusCode* code) {
+    VLOG(5) << "pick shard by path: " << full_path;
     std::string dir_path;
     std::string file_path;
     if (!SplitTablePath(full_path, &dir_path, &file_path)) {
@@ -182,11 +763,21 @@ leveldb::DB* MetaTree::PickDatabse(const std::string& full_path,
         return NULL;
     }
 
-    leveldb::DB* access_db = m_file_meta;
     if (file_path.empty()) {
-        access_db = m_dir_meta;
+        return m_dir_shard;
+    }
+    if (m_file_shards.size() == 1) {
+        return m_file_shards[0];
     }
-    return access_db;
+    uint64_t hash = utils::Fnv64Hash(full_path);
+    return m_file_shards[hash % m_file_shards.size()];
+}
+
+leveldb::Status MetaTree::PutMeta(leveldb::DB* shard, const std::string& key,
+                                  const std::string& value) {
+    leveldb::WriteBatch batch;
+    batch.Put(key, value);
+    return shard->Write(m_write_options, &batch);
 }
 
 bool MetaTree::SplitTablePath(const std::string& full_path,
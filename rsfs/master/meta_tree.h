@@ -8,7 +8,10 @@
 #define RSFS_MASTER_META_TREE_H
 
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "common/base/scoped_ptr.h"
 #include "leveldb/db.h"
 
 #include "rsfs/proto/master_rpc.pb.h"
@@ -19,7 +22,10 @@
 namespace rsfs {
 namespace master {
 
+class FidAllocator;
+class MetaCache;
 class NodeManager;
+class PathLockTable;
 
 class MetaTree {
 public:
@@ -28,28 +34,87 @@ public:
 
     bool OpenFile(TreeNode* meta,
                   bool create_if_miss, StatusCode* code);
-    bool CloseFile(TreeNode* meta, StatusCode* code);
+    // with open_fid, the meta must still be open for write as that
+    // file, or it fails with kKeyNotExist and nothing is changed
+    bool CloseFile(TreeNode* meta, StatusCode* code, uint64_t open_fid = 0);
 
+    // list metas in [path_start, path_end) of about size_limit bytes,
+    // last_key is set to the key to resume from, or empty at the end
     bool ListFile(const std::string& path_start,
                   const std::string& path_end, uint64_t size_limit,
-                  TreeNodeList* meta_list, std::string* last_key,
-                  StatusCode* code);
+                  ListFileRequest::Projection projection,
+                  TreeNodeList* meta_list, NameList* name_list,
+                  std::string* last_key, StatusCode* code);
+
+    // look up many metas in one pass, paths are sorted per shard so
+    // that one iterator serves all of them with forward seeks.
+    // codes[i] is kMasterOk, kKeyNotExist or an error for paths[i]
+    void StatFile(const std::vector<std::string>& paths,
+                  std::vector<TreeNode>* metas,
+                  std::vector<StatusCode>* codes);
+
+    // cut [path_start, path_end) into about split_num ranges of
+    // similar meta size, by bisection on approximate db size
+    bool SplitRange(const std::string& path_start,
+                    const std::string& path_end, uint32_t split_num,
+                    std::vector<std::string>* split_keys,
+                    StatusCode* code);
+
+    // drop the meta and queue its blocks for gc in one commit,
+    // the blocks are kept until not_before (in ms)
+    // files open for write are refused unless abort_write is set.
+    // with open_fid, the meta is removed only if still open for write
+    // as that file, otherwise it fails with kKeyNotExist
+    bool RemoveFile(const std::string& path, int64_t not_before,
+                    bool abort_write, StatusCode* code, uint64_t open_fid = 0);
+
+    // (path, fid) of the files left open for write
+    void LoadOpenFiles(std::vector<std::pair<std::string, uint64_t> >* files);
+
+    // scan at most limit gc records from start_key, which are due
+    // before now (in ms). next_key is where the next scan resumes,
+    // empty if all records are scanned
+    void ScanGarbage(const std::string& start_key, uint32_t limit,
+                     int64_t now, std::vector<GcRecord>* records,
+                     std::string* next_key);
+
+    // persist the progress of record, drop it if nothing is pending
+    bool UpdateGarbage(const GcRecord& record);
 
 private:
     bool LoadDatabase(const std::string& db_path, leveldb::DB** db_handler);
+    // false if no shard num is recorded, on the first start
+    bool CheckShardNum();
+    // record the shard num, moving the metas of an unsharded db left
+    // by an older master into the shards first
+    void RecordShardNum();
+    void MigrateLegacyShard();
+    // the largest fid in metas, open records and gc records, by a full
+    // scan. only for the db without fid high-water mark
+    uint64_t ScanMaxFid();
+    void GetShardList(leveldb::DB* shard, std::vector<leveldb::DB*>* shard_list);
+    uint64_t GetApproximateSize(const std::vector<leveldb::DB*>& shard_list,
+                                const std::string& start,
+                                const std::string& end);
     bool SplitTablePath(const std::string& full_path,
                         std::string* dir, std::string* file);
-    leveldb::DB* PickDatabse(const std::string& full_path,
-                             StatusCode* code);
+    leveldb::DB* PickShard(const std::string& full_path,
+                           StatusCode* code);
+    leveldb::Status PutMeta(leveldb::DB* shard, const std::string& key,
+                            const std::string& value);
 
 private:
-    uint64_t m_file_id;
-    leveldb::DB* m_dir_meta;
-    leveldb::DB* m_file_meta;
+    leveldb::DB* m_dir_shard;
+    std::vector<leveldb::DB*> m_file_shards;
     std::string m_dir_meta_path;
     std::string m_file_meta_path;
+    leveldb::WriteOptions m_write_options;
+    scoped_ptr<FidAllocator> m_fid_allocator;
 
     NodeManager* m_node_manager;
+    scoped_ptr<MetaCache> m_meta_cache;
+    // serializes the mutations on one path
+    scoped_ptr<PathLockTable> m_path_locks;
 };
 
 } // namespace master
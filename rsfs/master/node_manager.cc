@@ -6,13 +6,26 @@
 
 #include "rsfs/master/node_manager.h"
 
+#include <algorithm>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "thirdparty/gflags/gflags.h"
+
 #include "rsfs/master/node_state.h"
+#include "rsfs/utils/atomic.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int64(rsfs_heartbeat_period);
+DECLARE_int64(rsfs_heartbeat_suspect_period_factor);
+DECLARE_int64(rsfs_heartbeat_timeout_period_factor);
+DECLARE_int32(rsfs_master_placement_max_level);
 
 namespace rsfs {
 namespace master {
 
 
-NodeManager::NodeManager() {}
+NodeManager::NodeManager() : m_degraded_num(0) {}
 
 NodeManager::~NodeManager() {}
 
@@ -24,12 +37,14 @@ bool NodeManager::Register(const RegisterRequest* request,
     if (it != m_node_list.end()) {
         LOG(INFO) << "node: " << request->snode_info().addr()
             << " has registered";
+        it->second->Update(request->snode_info());
     } else {
         LOG(INFO) << "new register node: "
             << request->snode_info().addr();
 
-        m_node_list[request->snode_info().addr()]
-            = new NodeState(request->snode_info());
+        NodeState* node_state = new NodeState(request->snode_info());
+        m_node_list[request->snode_info().addr()] = node_state;
+        m_node_vec.push_back(node_state);
     }
     response->set_status(kMasterOk);
     return true;
@@ -48,8 +63,8 @@ bool NodeManager::Report(const ReportRequest* request,
             response->set_status(kSNodeNotExist);
             return false;
         } else if (it->second->GetStatus() != kSNodeIsRunning) {
-            LOG(ERROR) << "node is not running, current status: "
-                << StatusCodeToString(it->second->GetStatus());
+            LOG(WARNING) << "report from node: " << it->first
+                << " in status: " << StatusCodeToString(it->second->GetStatus());
             response->set_status(kMasterOk);
         }
         node_state = it->second;
@@ -59,26 +74,148 @@ bool NodeManager::Report(const ReportRequest* request,
 }
 
 bool NodeManager::AllocNode(uint32_t num, SNodeInfoList* node_list) {
-    RWLock::WriterLocker locker(&m_rwlock);
-    std::map<std::string, NodeState*>::iterator it =
-        m_node_list.begin();
-    uint32_t try_count = 0;
+    RWLock::ReaderLocker locker(m_rwlock);
+    uint32_t seed = static_cast<uint32_t>(utils::GetMicros())
+        ^ static_cast<uint32_t>(pthread_self());
+    int32_t max_level = std::min(std::max(FLAGS_rsfs_master_placement_max_level,
+                                          static_cast<int32_t>(kDistinctRack)),
+                                 static_cast<int32_t>(kAnyNode));
+    std::vector<NodeState*> picked_nodes;
+    picked_nodes.reserve(num);
+    uint32_t degraded_num = 0;
+    int32_t worst_level = kDistinctRack;
     for (uint32_t i = 0; i < num; ++i) {
-        SNodeInfo* node_info = node_list->Add();
-        while (true) {
-            it++;
-            if (it == m_node_list.end()) {
-                it = m_node_list.begin();
-                if (try_count == m_node_list.size()) {
-                    return false;
-                }
-                try_count = 0;
-            }
-            if (it->second->GetStatus() == kSNodeIsRunning) {
-                node_info->CopyFrom(it->second->GetSNodeInfo());
+        // relax the failure domain constraint only when cluster is too small
+        NodeState* node = NULL;
+        int32_t level = kDistinctRack;
+        for (; level <= max_level; ++level) {
+            node = PickNode(static_cast<PlacementLevel>(level),
+                            picked_nodes, &seed);
+            if (node != NULL) {
                 break;
             }
-            try_count++;
+        }
+        if (node == NULL) {
+            LOG(ERROR) << "no running node to place chunk: " << i
+                << " within placement level: " << max_level;
+            return false;
+        }
+        if (level > kDistinctRack) {
+            ++degraded_num;
+            worst_level = std::max(worst_level, level);
+        }
+        picked_nodes.push_back(node);
+        SNodeInfo* node_info = node_list->Add();
+        node_info->set_addr(node->GetAddr());
+        node_info->set_status(kSNodeIsRunning);
+    }
+    if (degraded_num > 0) {
+        uint64_t total_num =
+            atomic_add_ret_old64(&m_degraded_num, static_cast<uint64_t>(degraded_num))
+            + degraded_num;
+        LOG(WARNING) << degraded_num << " of " << num << " chunks placed at level "
+            << worst_level << " (0: distinct rack, 1: distinct node, 2: any node)"
+            << ", degraded chunks in total: " << total_num;
+    }
+    return true;
+}
+
+
+void NodeManager::CheckLiveness() {
+    int64_t now_ms = utils::GetMillis();
+    int64_t suspect_ms =
+        FLAGS_rsfs_heartbeat_period * FLAGS_rsfs_heartbeat_suspect_period_factor;
+    int64_t dead_ms =
+        FLAGS_rsfs_heartbeat_period * FLAGS_rsfs_heartbeat_timeout_period_factor;
+    uint32_t running_num = 0;
+    uint32_t suspect_num = 0;
+    uint32_t dead_num = 0;
+    RWLock::ReaderLocker locker(m_rwlock);
+    for (uint32_t i = 0; i < m_node_vec.size(); ++i) {
+        StatusCode status = m_node_vec[i]->CheckTimeout(now_ms, suspect_ms, dead_ms);
+        if (status == kSNodeIsRunning) {
+            ++running_num;
+        } else if (status == kSNodeIsSuspect) {
+            ++suspect_num;
+        } else if (status == kSNodeIsDead) {
+            ++dead_num;
+        }
+    }
+    VLOG(5) << "node liveness: running " << running_num
+        << ", suspect " << suspect_num << ", dead " << dead_num
+        << ", degraded chunks " << m_degraded_num;
+}
+
+void NodeManager::FillNodeStatus(SNodeInfoList* node_list) const {
+    RWLock::ReaderLocker locker(m_rwlock);
+    for (int32_t i = 0; i < node_list->size(); ++i) {
+        SNodeInfo* node_info = node_list->Mutable(i);
+        std::map<std::string, NodeState*>::const_iterator it =
+            m_node_list.find(node_info->addr());
+        if (it != m_node_list.end()) {
+            node_info->set_status(it->second->GetStatus());
+        }
+    }
+}
+
+NodeState* NodeManager::PickNode(PlacementLevel level,
+                                 const std::vector<NodeState*>& picked_nodes,
+                                 uint32_t* seed) const {
+    // power of two choices: sample two eligible nodes, keep the better one
+    const uint32_t kChoiceNum = 2;
+    const uint32_t kMaxProbeNum = 8;
+    uint32_t node_num = m_node_vec.size();
+    if (node_num == 0) {
+        return NULL;
+    }
+    NodeState* choices[kChoiceNum];
+    uint32_t choice_num = 0;
+    for (uint32_t probe = 0; probe < kMaxProbeNum && choice_num < kChoiceNum;
+         ++probe) {
+        NodeState* node = m_node_vec[rand_r(seed) % node_num];
+        if (IsEligible(node, level, picked_nodes)
+            && (choice_num == 0 || choices[0] != node)) {
+            choices[choice_num++] = node;
+        }
+    }
+    if (choice_num == 0) {
+        // random probes missed, fall back to a scan from random offset
+        uint32_t offset = rand_r(seed) % node_num;
+        for (uint32_t i = 0; i < node_num && choice_num < kChoiceNum; ++i) {
+            NodeState* node = m_node_vec[(offset + i) % node_num];
+            if (IsEligible(node, level, picked_nodes)) {
+                choices[choice_num++] = node;
+            }
+        }
+    }
+    if (choice_num == 0) {
+        return NULL;
+    }
+    if (choice_num == 1
+        || choices[0]->GetPlacementScore() >= choices[1]->GetPlacementScore()) {
+        return choices[0];
+    }
+    return choices[1];
+}
+
+bool NodeManager::IsEligible(NodeState* node, PlacementLevel level,
+                             const std::vector<NodeState*>& picked_nodes) const {
+    if (node->GetStatus() != kSNodeIsRunning) {
+        return false;
+    }
+    if (level == kAnyNode) {
+        return true;
+    }
+    std::string rack;
+    if (level == kDistinctRack) {
+        rack = node->GetRack();
+    }
+    for (uint32_t i = 0; i < picked_nodes.size(); ++i) {
+        if (picked_nodes[i] == node) {
+            return false;
+        }
+        if (level == kDistinctRack && picked_nodes[i]->GetRack() == rack) {
+            return false;
         }
     }
     return true;
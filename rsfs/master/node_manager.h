@@ -10,6 +10,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/lock/rwlock.h"
 
@@ -32,11 +33,37 @@ public:
     bool Report(const ReportRequest* request,
                 ReportResponse* response);
 
+    // the failure domain is relaxed only when the cluster is too small,
+    // down to rsfs_master_placement_max_level, and each chunk placed
+    // so is counted
     bool AllocNode(uint32_t num, SNodeInfoList* node_list);
 
+    // expire nodes without heartbeat, driven by master timer
+    void CheckLiveness();
+
+    // overwrite the status of nodes with the latest known one
+    void FillNodeStatus(SNodeInfoList* node_list) const;
+
+private:
+    enum PlacementLevel {
+        kDistinctRack = 0,
+        kDistinctNode = 1,
+        kAnyNode = 2
+    };
+
+    NodeState* PickNode(PlacementLevel level,
+                        const std::vector<NodeState*>& picked_nodes,
+                        uint32_t* seed) const;
+    bool IsEligible(NodeState* node, PlacementLevel level,
+                    const std::vector<NodeState*>& picked_nodes) const;
+
 private:
     mutable RWLock m_rwlock;
     std::map<std::string, NodeState*> m_node_list;
+    // same nodes as m_node_list, for O(1) random sampling
+    std::vector<NodeState*> m_node_vec;
+    // the chunks placed without distinct racks so far
+    volatile uint64_t m_degraded_num;
 };
 
 } // namespace master
@@ -6,29 +6,135 @@
 
 #include "rsfs/master/node_state.h"
 
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/proto/proto_helper.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_double(rsfs_master_load_ewma_alpha);
+
 namespace rsfs {
 namespace master {
 
 
 NodeState::NodeState(const SNodeInfo& node_info)
-    : m_snode_info(node_info) {}
+    : m_addr(node_info.addr()), m_snode_info(node_info),
+      m_load_inited(false), m_last_report_ms(utils::GetMillis()) {
+    if (node_info.has_load()) {
+        UpdateSmoothedLoad(node_info.load());
+    }
+}
 
 NodeState::~NodeState() {}
 
 SNodeInfo NodeState::GetSNodeInfo() const {
+    MutexLocker lock(m_mutex);
     return m_snode_info;
 }
 
 StatusCode NodeState::GetStatus() const {
+    MutexLocker lock(m_mutex);
     return m_snode_info.status();
 }
 
+const std::string& NodeState::GetAddr() const {
+    return m_addr;
+}
+
+std::string NodeState::GetRack() const {
+    MutexLocker lock(m_mutex);
+    if (m_snode_info.has_rack() && !m_snode_info.rack().empty()) {
+        return m_snode_info.rack();
+    }
+    return m_addr;
+}
+
+SmoothedLoad NodeState::GetSmoothedLoad() const {
+    MutexLocker lock(m_mutex);
+    return m_smoothed_load;
+}
+
+double NodeState::GetPlacementScore() const {
+    MutexLocker lock(m_mutex);
+    const SNodeLoad& load = m_snode_info.load();
+    // no space reported yet, treat as an empty node
+    double free_ratio = 1.0;
+    if (load.capacity() > 0) {
+        if (load.used() >= load.capacity()) {
+            return 0.0;
+        }
+        free_ratio = static_cast<double>(load.capacity() - load.used())
+            / load.capacity();
+    }
+    // penalize nodes with a backlog of io requests
+    return free_ratio / (1.0 + m_smoothed_load.queue_depth);
+}
+
 bool NodeState::Report(const ReportRequest* request,
                        ReportResponse* response) {
-    m_snode_info.CopyFrom(request->snode_info());
+    Update(request->snode_info());
     response->set_status(kMasterOk);
     return true;
 }
 
+void NodeState::Update(const SNodeInfo& node_info) {
+    MutexLocker lock(m_mutex);
+    StatusCode old_status = m_snode_info.status();
+    m_snode_info.CopyFrom(node_info);
+    if (m_snode_info.has_load()) {
+        UpdateSmoothedLoad(m_snode_info.load());
+    }
+    m_last_report_ms = utils::GetMillis();
+    if (old_status == kSNodeIsSuspect || old_status == kSNodeIsDead) {
+        LOG(INFO) << "node: " << m_addr << " revived from "
+            << StatusCodeToString(old_status) << " to "
+            << StatusCodeToString(m_snode_info.status());
+    }
+}
+
+StatusCode NodeState::CheckTimeout(int64_t now_ms, int64_t suspect_ms,
+                                   int64_t dead_ms) {
+    MutexLocker lock(m_mutex);
+    StatusCode status = m_snode_info.status();
+    int64_t silent_ms = now_ms - m_last_report_ms;
+    if (status == kSNodeIsDead) {
+        return status;
+    }
+    if (silent_ms >= dead_ms) {
+        LOG(WARNING) << "node: " << m_addr << " is dead, no heartbeat for "
+            << silent_ms << " ms";
+        m_snode_info.set_status(kSNodeIsDead);
+    } else if (silent_ms >= suspect_ms && status != kSNodeIsSuspect) {
+        LOG(WARNING) << "node: " << m_addr << " is suspect, no heartbeat for "
+            << silent_ms << " ms";
+        m_snode_info.set_status(kSNodeIsSuspect);
+    }
+    return m_snode_info.status();
+}
+
+void NodeState::UpdateSmoothedLoad(const SNodeLoad& load) {
+    if (!m_load_inited) {
+        m_smoothed_load.read_throughput = load.read_throughput();
+        m_smoothed_load.write_throughput = load.write_throughput();
+        m_smoothed_load.read_iops = load.read_iops();
+        m_smoothed_load.write_iops = load.write_iops();
+        m_smoothed_load.latency_p50 = load.latency_p50();
+        m_smoothed_load.latency_p99 = load.latency_p99();
+        m_smoothed_load.queue_depth = load.queue_depth();
+        m_load_inited = true;
+        return;
+    }
+    double alpha = FLAGS_rsfs_master_load_ewma_alpha;
+    SmoothedLoad* s = &m_smoothed_load;
+    s->read_throughput += alpha * (load.read_throughput() - s->read_throughput);
+    s->write_throughput += alpha * (load.write_throughput() - s->write_throughput);
+    s->read_iops += alpha * (load.read_iops() - s->read_iops);
+    s->write_iops += alpha * (load.write_iops() - s->write_iops);
+    s->latency_p50 += alpha * (load.latency_p50() - s->latency_p50);
+    s->latency_p99 += alpha * (load.latency_p99() - s->latency_p99);
+    s->queue_depth += alpha * (load.queue_depth() - s->queue_depth);
+}
+
 } // namespace master
 } // namespace rsfs
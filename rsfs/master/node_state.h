@@ -8,6 +8,10 @@
 #ifndef RSFS_MASTER_NODE_STATE_H
 #define RSFS_MASTER_NODE_STATE_H
 
+#include <string>
+
+#include "common/lock/mutex.h"
+
 #include "rsfs/proto/master_rpc.pb.h"
 #include "rsfs/proto/snode_info.pb.h"
 #include "rsfs/proto/status_code.pb.h"
@@ -15,6 +19,21 @@
 namespace rsfs {
 namespace master {
 
+// ewma smoothed view of the load reported by heartbeats
+struct SmoothedLoad {
+    double read_throughput;
+    double write_throughput;
+    double read_iops;
+    double write_iops;
+    double latency_p50;
+    double latency_p99;
+    double queue_depth;
+
+    SmoothedLoad()
+        : read_throughput(0), write_throughput(0), read_iops(0),
+          write_iops(0), latency_p50(0), latency_p99(0), queue_depth(0) {}
+};
+
 class NodeState {
 public:
     NodeState(const SNodeInfo& node_info);
@@ -23,11 +42,36 @@ public:
     bool Report(const ReportRequest* request,
                 ReportResponse* response);
 
+    // refresh by register or report, also revive a suspect or dead node
+    void Update(const SNodeInfo& node_info);
+
+    // move to suspect or dead if heartbeat is lost too long,
+    // return the status after check
+    StatusCode CheckTimeout(int64_t now_ms, int64_t suspect_ms,
+                            int64_t dead_ms);
+
     SNodeInfo GetSNodeInfo() const;
     StatusCode GetStatus() const;
+    const std::string& GetAddr() const;
+
+    // failure domain of node, the node itself if no rack is labeled
+    std::string GetRack() const;
+
+    SmoothedLoad GetSmoothedLoad() const;
+
+    // higher is better for new placement
+    double GetPlacementScore() const;
+
+private:
+    void UpdateSmoothedLoad(const SNodeLoad& load);
 
 private:
+    mutable Mutex m_mutex;
+    const std::string m_addr;
     SNodeInfo m_snode_info;
+    SmoothedLoad m_smoothed_load;
+    bool m_load_inited;
+    int64_t m_last_report_ms;
 };
 
 } // namespace master
@@ -0,0 +1,88 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/open_file_table.h"
+
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace master {
+
+OpenFileTable::OpenFileTable(int64_t lease_period_ms)
+    : m_lease_period_ms(lease_period_ms) {}
+
+OpenFileTable::~OpenFileTable() {}
+
+void OpenFileTable::Add(const std::string& path, uint64_t fid) {
+    int64_t expire_time = utils::GetMillis() + m_lease_period_ms;
+    MutexLocker lock(m_mutex);
+    LeaseInfo& lease = m_leases[fid];
+    lease.path = path;
+    lease.expire_time = expire_time;
+    lease.is_recovering = false;
+    m_path_fids[path] = fid;
+}
+
+void OpenFileTable::Remove(const std::string& path) {
+    MutexLocker lock(m_mutex);
+    std::map<std::string, uint64_t>::iterator it = m_path_fids.find(path);
+    if (it == m_path_fids.end()) {
+        return;
+    }
+    m_leases.erase(it->second);
+    m_path_fids.erase(it);
+}
+
+bool OpenFileTable::Renew(uint64_t fid) {
+    int64_t expire_time = utils::GetMillis() + m_lease_period_ms;
+    MutexLocker lock(m_mutex);
+    std::map<uint64_t, LeaseInfo>::iterator it = m_leases.find(fid);
+    if (it == m_leases.end()) {
+        return false;
+    }
+    if (it->second.expire_time < expire_time) {
+        it->second.expire_time = expire_time;
+    }
+    return true;
+}
+
+void OpenFileTable::GetExpired(uint32_t limit, std::vector<OpenFile>* files) {
+    int64_t now = utils::GetMillis();
+    MutexLocker lock(m_mutex);
+    std::map<uint64_t, LeaseInfo>::iterator it = m_leases.begin();
+    for (; it != m_leases.end() && files->size() < limit; ++it) {
+        LeaseInfo& lease = it->second;
+        if (lease.is_recovering || lease.expire_time > now) {
+            continue;
+        }
+        lease.is_recovering = true;
+        OpenFile file;
+        file.path = lease.path;
+        file.fid = it->first;
+        files->push_back(file);
+    }
+}
+
+void OpenFileTable::FinishRecovery(uint64_t fid, bool is_recovered) {
+    int64_t expire_time = utils::GetMillis() + m_lease_period_ms;
+    MutexLocker lock(m_mutex);
+    std::map<uint64_t, LeaseInfo>::iterator it = m_leases.find(fid);
+    if (it == m_leases.end()) {
+        return;
+    }
+    if (is_recovered) {
+        m_path_fids.erase(it->second.path);
+        m_leases.erase(it);
+        return;
+    }
+    it->second.expire_time = expire_time;
+    it->second.is_recovering = false;
+}
+
+} // namespace master
+} // namespace rsfs
@@ -0,0 +1,61 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_OPEN_FILE_TABLE_H
+#define RSFS_MASTER_OPEN_FILE_TABLE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/lock/mutex.h"
+
+namespace rsfs {
+namespace master {
+
+// tracks the files open for write and the lease of their writers.
+// the lease is renewed by the writers periodically, and by snodes
+// reporting the blocks being appended.
+class OpenFileTable {
+public:
+    struct OpenFile {
+        std::string path;
+        uint64_t fid;
+    };
+
+    OpenFileTable(int64_t lease_period_ms);
+    ~OpenFileTable();
+
+    void Add(const std::string& path, uint64_t fid);
+    void Remove(const std::string& path);
+    // return false if fid is not open for write any more
+    bool Renew(uint64_t fid);
+
+    // take out at most limit files whose lease is expired, they are
+    // not returned again until FinishRecovery
+    void GetExpired(uint32_t limit, std::vector<OpenFile>* files);
+
+    // drop the file if recovered, or grant a new lease to retry later
+    void FinishRecovery(uint64_t fid, bool is_recovered);
+
+private:
+    struct LeaseInfo {
+        std::string path;
+        int64_t expire_time;
+        bool is_recovering;
+    };
+
+    const int64_t m_lease_period_ms;
+
+    mutable Mutex m_mutex;
+    std::map<uint64_t, LeaseInfo> m_leases;
+    std::map<std::string, uint64_t> m_path_fids;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_OPEN_FILE_TABLE_H
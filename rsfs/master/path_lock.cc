@@ -0,0 +1,36 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/path_lock.h"
+
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/hash.h"
+
+namespace rsfs {
+namespace master {
+
+PathLockTable::PathLockTable(uint32_t stripe_num) {
+    CHECK_GT(stripe_num, 0U);
+    m_stripes.resize(stripe_num);
+    for (uint32_t i = 0; i < stripe_num; ++i) {
+        m_stripes[i] = new Mutex;
+    }
+}
+
+PathLockTable::~PathLockTable() {
+    for (uint32_t i = 0; i < m_stripes.size(); ++i) {
+        delete m_stripes[i];
+    }
+}
+
+Mutex* PathLockTable::GetLock(const std::string& path) {
+    uint64_t hash = utils::Fnv64Hash(path);
+    return m_stripes[hash % m_stripes.size()];
+}
+
+} // namespace master
+} // namespace rsfs
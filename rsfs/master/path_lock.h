@@ -0,0 +1,49 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_PATH_LOCK_H
+#define RSFS_MASTER_PATH_LOCK_H
+
+#include <string>
+#include <vector>
+
+#include "common/lock/mutex.h"
+
+namespace rsfs {
+namespace master {
+
+// a fixed set of mutexes striped by path hash. operations on the same
+// path are serialized, while the ones on different paths only contend
+// if they fall into the same stripe.
+class PathLockTable {
+public:
+    PathLockTable(uint32_t stripe_num);
+    ~PathLockTable();
+
+    Mutex* GetLock(const std::string& path);
+
+private:
+    std::vector<Mutex*> m_stripes;
+};
+
+class PathLocker {
+public:
+    PathLocker(PathLockTable* table, const std::string& path)
+        : m_mutex(table->GetLock(path)) {
+        m_mutex->Lock();
+    }
+    ~PathLocker() {
+        m_mutex->Unlock();
+    }
+
+private:
+    Mutex* m_mutex;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_PATH_LOCK_H
@@ -55,6 +55,46 @@ void RemoteMaster::ListFile(google::protobuf::RpcController* controller,
     m_thread_pool->AddTask(callback);
 }
 
+void RemoteMaster::SplitRange(google::protobuf::RpcController* controller,
+                              const SplitRangeRequest* request,
+                              SplitRangeResponse* response,
+                              google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteMaster::DoSplitRange, controller,
+                   request, response, done);
+    m_thread_pool->AddTask(callback);
+}
+
+void RemoteMaster::StatFile(google::protobuf::RpcController* controller,
+                            const StatFileRequest* request,
+                            StatFileResponse* response,
+                            google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteMaster::DoStatFile, controller,
+                   request, response, done);
+    m_thread_pool->AddTask(callback);
+}
+
+void RemoteMaster::RemoveFile(google::protobuf::RpcController* controller,
+                              const RemoveFileRequest* request,
+                              RemoveFileResponse* response,
+                              google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteMaster::DoRemoveFile, controller,
+                   request, response, done);
+    m_thread_pool->AddTask(callback);
+}
+
+void RemoteMaster::RenewLease(google::protobuf::RpcController* controller,
+                              const RenewLeaseRequest* request,
+                              RenewLeaseResponse* response,
+                              google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteMaster::DoRenewLease, controller,
+                   request, response, done);
+    m_thread_pool->AddTask(callback);
+}
+
 void RemoteMaster::Register(google::protobuf::RpcController* controller,
                             const RegisterRequest* request,
                             RegisterResponse* response,
@@ -110,6 +150,50 @@ void RemoteMaster::DoListFile(google::protobuf::RpcController* controller,
     done->Run();
 }
 
+void RemoteMaster::DoSplitRange(google::protobuf::RpcController* controller,
+                                const SplitRangeRequest* request,
+                                SplitRangeResponse* response,
+                                google::protobuf::Closure* done) {
+    LOG(INFO) << "accept RPC (SplitRange)";
+    m_master_impl->SplitRange(request, response);
+    LOG(INFO) << "finish RPC (SplitRange)";
+
+    done->Run();
+}
+
+void RemoteMaster::DoStatFile(google::protobuf::RpcController* controller,
+                              const StatFileRequest* request,
+                              StatFileResponse* response,
+                              google::protobuf::Closure* done) {
+    LOG(INFO) << "accept RPC (StatFile)";
+    m_master_impl->StatFile(request, response);
+    LOG(INFO) << "finish RPC (StatFile)";
+
+    done->Run();
+}
+
+void RemoteMaster::DoRemoveFile(google::protobuf::RpcController* controller,
+                                const RemoveFileRequest* request,
+                                RemoveFileResponse* response,
+                                google::protobuf::Closure* done) {
+    LOG(INFO) << "accept RPC (RemoveFile)";
+    m_master_impl->RemoveFile(request, response);
+    LOG(INFO) << "finish RPC (RemoveFile)";
+
+    done->Run();
+}
+
+void RemoteMaster::DoRenewLease(google::protobuf::RpcController* controller,
+                                const RenewLeaseRequest* request,
+                                RenewLeaseResponse* response,
+                                google::protobuf::Closure* done) {
+    VLOG(5) << "accept RPC (RenewLease)";
+    m_master_impl->RenewLease(request, response);
+    VLOG(5) << "finish RPC (RenewLease)";
+
+    done->Run();
+}
+
 void RemoteMaster::DoRegister(google::protobuf::RpcController* controller,
                               const RegisterRequest* request,
                               RegisterResponse* response,
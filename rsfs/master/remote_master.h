@@ -37,6 +37,26 @@ public:
                    ListFileResponse* response,
                    google::protobuf::Closure* done);
 
+    void SplitRange(google::protobuf::RpcController* controller,
+                    const SplitRangeRequest* request,
+                    SplitRangeResponse* response,
+                    google::protobuf::Closure* done);
+
+    void StatFile(google::protobuf::RpcController* controller,
+                  const StatFileRequest* request,
+                  StatFileResponse* response,
+                  google::protobuf::Closure* done);
+
+    void RemoveFile(google::protobuf::RpcController* controller,
+                    const RemoveFileRequest* request,
+                    RemoveFileResponse* response,
+                    google::protobuf::Closure* done);
+
+    void RenewLease(google::protobuf::RpcController* controller,
+                    const RenewLeaseRequest* request,
+                    RenewLeaseResponse* response,
+                    google::protobuf::Closure* done);
+
     void Register(google::protobuf::RpcController* controller,
                   const RegisterRequest* request,
                   RegisterResponse* response,
@@ -63,6 +83,26 @@ private:
                      ListFileResponse* response,
                      google::protobuf::Closure* done);
 
+    void DoSplitRange(google::protobuf::RpcController* controller,
+                      const SplitRangeRequest* request,
+                      SplitRangeResponse* response,
+                      google::protobuf::Closure* done);
+
+    void DoStatFile(google::protobuf::RpcController* controller,
+                    const StatFileRequest* request,
+                    StatFileResponse* response,
+                    google::protobuf::Closure* done);
+
+    void DoRemoveFile(google::protobuf::RpcController* controller,
+                      const RemoveFileRequest* request,
+                      RemoveFileResponse* response,
+                      google::protobuf::Closure* done);
+
+    void DoRenewLease(google::protobuf::RpcController* controller,
+                      const RenewLeaseRequest* request,
+                      RenewLeaseResponse* response,
+                      google::protobuf::Closure* done);
+
     void DoRegister(google::protobuf::RpcController* controller,
                     const RegisterRequest* request,
                     RegisterResponse* response,
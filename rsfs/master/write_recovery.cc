@@ -0,0 +1,209 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/master/write_recovery.h"
+
+#include <vector>
+
+#include "common/base/closure.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/master/meta_tree.h"
+#include "rsfs/master/node_manager.h"
+#include "rsfs/proto/proto_helper.h"
+#include "rsfs/snode/snode_client.h"
+#include "rsfs/utils/block_id.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int32(rsfs_master_recovery_file_num);
+DECLARE_int32(rsfs_master_gc_rpc_timeout_period);
+DECLARE_int32(rsfs_snode_connect_retry_period);
+
+namespace rsfs {
+namespace master {
+
+WriteRecovery::WriteRecovery(MetaTree* meta_tree, NodeManager* node_manager,
+                             OpenFileTable* open_file_table)
+    : m_meta_tree(meta_tree), m_node_manager(node_manager),
+      m_open_file_table(open_file_table),
+      m_round_thread(new ThreadPool(1, 1)),
+      m_is_running(false) {}
+
+WriteRecovery::~WriteRecovery() {
+    m_round_thread.reset();
+}
+
+void WriteRecovery::Schedule() {
+    {
+        MutexLocker lock(m_mutex);
+        if (m_is_running) {
+            VLOG(5) << "last recovery round is still running, skip";
+            return;
+        }
+        m_is_running = true;
+    }
+    m_round_thread->AddTask(NewClosure(this, &WriteRecovery::RunRound));
+}
+
+void WriteRecovery::RunRound() {
+    std::vector<OpenFileTable::OpenFile> files;
+    m_open_file_table->GetExpired(FLAGS_rsfs_master_recovery_file_num, &files);
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        LOG(INFO) << "write lease expired, recover file: " << files[i].path
+            << " (fid: " << files[i].fid << ")";
+        bool is_recovered = Recover(files[i]);
+        m_open_file_table->FinishRecovery(files[i].fid, is_recovered);
+    }
+
+    MutexLocker lock(m_mutex);
+    m_is_running = false;
+}
+
+bool WriteRecovery::Recover(const OpenFileTable::OpenFile& file) {
+    std::vector<std::string> paths(1, file.path);
+    std::vector<TreeNode> metas;
+    std::vector<StatusCode> codes;
+    m_meta_tree->StatFile(paths, &metas, &codes);
+    if (codes[0] == kKeyNotExist) {
+        return true;
+    } else if (codes[0] != kMasterOk) {
+        LOG(WARNING) << "fail to load meta: " << file.path;
+        return false;
+    }
+    TreeNode& meta = metas[0];
+    if (meta.fid() != file.fid || meta.status() != kMetaWriteOpen) {
+        // closed by writer, or replaced meanwhile
+        return true;
+    }
+    uint32_t node_num = meta.chunks_size();
+    uint32_t slice_block_num = meta.rscode_m() + meta.rscode_k();
+    if (meta.block_size() == 0 || meta.rscode_m() == 0 || node_num == 0) {
+        LOG(WARNING) << "unknown rscode layout, abort file: " << file.path;
+        return AbortFile(meta);
+    }
+
+    std::vector<int64_t> block_nums;
+    uint32_t dead_num = 0;
+    uint32_t fail_num = 0;
+    StatBlocks(meta, &block_nums, &dead_num, &fail_num);
+    if (fail_num > 0) {
+        LOG(WARNING) << fail_num << " nodes not reply, retry file: " << file.path;
+        return false;
+    }
+    if (dead_num > meta.rscode_k()) {
+        LOG(WARNING) << dead_num << " nodes are dead, abort file: " << file.path;
+        return AbortFile(meta);
+    }
+
+    // blocks are appended round-robin over nodes, the first block
+    // missing on node i is i + block_num * node_num. the ones before
+    // all of them are complete, except on dead nodes which rscode fixes
+    uint64_t complete_num = 0;
+    bool is_first = true;
+    for (uint32_t i = 0; i < node_num; ++i) {
+        if (block_nums[i] < 0) {
+            continue;
+        }
+        uint64_t missing_no = i + block_nums[i] * node_num;
+        if (is_first || missing_no < complete_num) {
+            complete_num = missing_no;
+            is_first = false;
+        }
+    }
+    uint64_t slice_num = complete_num / slice_block_num;
+
+    // the complete data blocks of the next slice have no parity yet,
+    // they are kept as the tail, read from where they were written.
+    // the ones on dead nodes and after are lost
+    uint32_t tail_num = 0;
+    uint64_t tail_start = slice_num * slice_block_num;
+    while (tail_num < meta.rscode_m() && tail_start + tail_num < complete_num
+           && block_nums[(tail_start + tail_num) % node_num] >= 0) {
+        ++tail_num;
+    }
+    if (slice_num == 0 && tail_num == 0) {
+        LOG(INFO) << "no complete block, abort file: " << file.path;
+        return AbortFile(meta);
+    }
+    return SealFile(meta, slice_num, tail_num);
+}
+
+bool WriteRecovery::SealFile(const TreeNode& meta, uint64_t slice_num,
+                             uint32_t tail_num) {
+    uint64_t file_size =
+        (slice_num * meta.rscode_m() + tail_num) * meta.block_size();
+    TreeNode tree_node;
+    tree_node.set_name(meta.name());
+    tree_node.set_file_size(file_size);
+    tree_node.set_tail_slice(slice_num);
+    tree_node.set_tail_num(tail_num);
+    // the blocks written after the tail in the slice are not its copies
+    tree_node.set_tail_copy_num(1);
+    StatusCode status = kMasterOk;
+    // the writer may have closed it, or a new file taken the path,
+    // during the block stats
+    if (!m_meta_tree->CloseFile(&tree_node, &status, meta.fid())) {
+        if (status == kKeyNotExist) {
+            return true;
+        }
+        LOG(ERROR) << "fail to seal file: " << meta.name()
+            << ", status: " << StatusCodeToString(status);
+        return false;
+    }
+    LOG(INFO) << "file sealed: " << meta.name() << ", size: " << file_size
+        << ", tail blocks: " << tail_num;
+    return true;
+}
+
+bool WriteRecovery::AbortFile(const TreeNode& meta) {
+    StatusCode status = kMasterOk;
+    // as SealFile, only the file being recovered is dropped
+    if (!m_meta_tree->RemoveFile(meta.name(), utils::GetWallMillis(), true,
+                                 &status, meta.fid())
+        && status != kKeyNotExist) {
+        LOG(ERROR) << "fail to abort file: " << meta.name()
+            << ", status: " << StatusCodeToString(status);
+        return false;
+    }
+    LOG(INFO) << "file aborted: " << meta.name();
+    return true;
+}
+
+void WriteRecovery::StatBlocks(const TreeNode& meta,
+                               std::vector<int64_t>* block_nums,
+                               uint32_t* dead_num, uint32_t* fail_num) {
+    SNodeInfoList nodes(meta.chunks());
+    m_node_manager->FillNodeStatus(&nodes);
+    block_nums->assign(nodes.size(), -1);
+    for (int32_t i = 0; i < nodes.size(); ++i) {
+        if (nodes.Get(i).status() == kSNodeIsDead) {
+            ++(*dead_num);
+            continue;
+        }
+        snode::SNodeClient client(FLAGS_rsfs_snode_connect_retry_period,
+                                  FLAGS_rsfs_master_gc_rpc_timeout_period, 1);
+        client.ResetSNodeClient(nodes.Get(i).addr());
+        StatDataRequest request;
+        StatDataResponse response;
+        request.set_sequence_id(0);
+        request.set_timeout_ms(FLAGS_rsfs_master_gc_rpc_timeout_period);
+        request.add_block_ids(utils::BlockFileName(meta.fid(), i));
+        if (!client.StatData(&request, &response)
+            || response.status() != kSNodeOk
+            || response.block_sizes_size() != 1) {
+            LOG(WARNING) << "fail to stat block #" << i << " of fid "
+                << meta.fid() << " on snode: " << nodes.Get(i).addr();
+            ++(*fail_num);
+            continue;
+        }
+        int64_t size = response.block_sizes(0);
+        (*block_nums)[i] = (size > 0) ? size / meta.block_size() : 0;
+    }
+}
+
+} // namespace master
+} // namespace rsfs
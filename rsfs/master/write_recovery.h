@@ -0,0 +1,67 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_MASTER_WRITE_RECOVERY_H
+#define RSFS_MASTER_WRITE_RECOVERY_H
+
+#include <vector>
+
+#include "common/base/scoped_ptr.h"
+#include "common/lock/mutex.h"
+#include "common/thread/thread_pool.h"
+
+#include "rsfs/master/open_file_table.h"
+#include "rsfs/proto/meta_tree.pb.h"
+
+namespace rsfs {
+namespace master {
+
+class MetaTree;
+class NodeManager;
+
+// closes the files whose writer lease is expired on behalf of the
+// writer. the complete rscode slices found on snodes, followed by the
+// complete data blocks of the next slice as an unreplicated tail, are
+// sealed as the file content. a partly written block is lost, and a
+// file without any complete block is removed so that its blocks are
+// reclaimed by gc. the writer is fenced: its lease renewal and close
+// fail afterwards.
+class WriteRecovery {
+public:
+    WriteRecovery(MetaTree* meta_tree, NodeManager* node_manager,
+                  OpenFileTable* open_file_table);
+    ~WriteRecovery();
+
+    // start a round in background, skipped if last one is running
+    void Schedule();
+
+private:
+    void RunRound();
+
+    // return false if it should be retried later
+    bool Recover(const OpenFileTable::OpenFile& file);
+    bool SealFile(const TreeNode& meta, uint64_t slice_num, uint32_t tail_num);
+    bool AbortFile(const TreeNode& meta);
+
+    // the number of blocks (of block_size) stored on each chunk node,
+    // -1 for dead node. fail_num counts the nodes failed to reply
+    void StatBlocks(const TreeNode& meta, std::vector<int64_t>* block_nums,
+                    uint32_t* dead_num, uint32_t* fail_num);
+
+private:
+    MetaTree* m_meta_tree;
+    NodeManager* m_node_manager;
+    OpenFileTable* m_open_file_table;
+    scoped_ptr<ThreadPool> m_round_thread;
+
+    mutable Mutex m_mutex;
+    bool m_is_running;
+};
+
+} // namespace master
+} // namespace rsfs
+
+#endif // RSFS_MASTER_WRITE_RECOVERY_H
@@ -6,6 +6,10 @@
 
 #include <stdio.h>
 
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
 #include "rsfs/proto/status_code.pb.h"
 #include "rsfs/proto/proto_helper.h"
 
@@ -40,12 +44,18 @@ std::string StatusCodeToString(int32_t status) {
         return "kSNodeIsIniting";
     case kSNodeIsReadonly:
         return "kSNodeIsReadonly";
+    case kSNodeIsSuspect:
+        return "kSNodeIsSuspect";
+    case kSNodeIsDead:
+        return "kSNodeIsDead";
     case kSNodeIsRunning:
         return "kSNodeIsRunning";
     case kSNodeNotStream:
         return "kSNodeNotStream";
     case kSNodeErrStream:
         return "kSNodeErrStream";
+    case kSNodeNotScan:
+        return "kSNodeNotScan";
 
     // ACL & system
     case kIllegalAccess:
@@ -85,6 +95,8 @@ std::string StatusCodeToString(int32_t status) {
         return "kConnectError";
     case kRPCTimeout:
         return "kRPCTimeout";
+    case kDeadlineExceeded:
+        return "kDeadlineExceeded";
 
     case kMetaNotInited:
         return "kMetaNotInited";
@@ -126,4 +138,35 @@ bool StringToTreeNodePB(const std::string& str, TreeNode* message) {
     return true;
 }
 
+bool ArrayToTreeNodePB(const char* data, int32_t size, TreeNode* message) {
+    if (!message->ParseFromArray(data, size)) {
+        LOG(WARNING) << "missing required fields: "
+            << message->InitializationErrorString();
+        return false;
+    }
+    return true;
+}
+
+bool ArrayToTreeNodeSummaryPB(const char* data, int32_t size, TreeNode* message) {
+    using google::protobuf::internal::WireFormatLite;
+    google::protobuf::io::CodedInputStream input(
+        reinterpret_cast<const uint8_t*>(data), size);
+    std::string scalars;
+    {
+        google::protobuf::io::StringOutputStream output_stream(&scalars);
+        google::protobuf::io::CodedOutputStream output(&output_stream);
+        uint32_t tag = 0;
+        while ((tag = input.ReadTag()) != 0) {
+            bool is_chunk = WireFormatLite::GetTagFieldNumber(tag)
+                == TreeNode::kChunksFieldNumber;
+            if (!(is_chunk ? WireFormatLite::SkipField(&input, tag)
+                  : WireFormatLite::SkipField(&input, tag, &output))) {
+                LOG(WARNING) << "corrupted tree node, tag: " << tag;
+                return false;
+            }
+        }
+    }
+    return ArrayToTreeNodePB(scalars.data(), scalars.size(), message);
+}
+
 } // namespace tera
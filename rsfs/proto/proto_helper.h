@@ -16,11 +16,16 @@ namespace rsfs {
 
 typedef ::google::protobuf::RepeatedPtrField< SNodeInfo> SNodeInfoList;
 typedef ::google::protobuf::RepeatedPtrField< TreeNode> TreeNodeList;
+typedef ::google::protobuf::RepeatedPtrField< std::string> NameList;
 
 std::string StatusCodeToString(int32_t status);
 
 bool TreeNodePBToString(const TreeNode& message, std::string* output);
 bool StringToTreeNodePB(const std::string& str, TreeNode* message);
+bool ArrayToTreeNodePB(const char* data, int32_t size, TreeNode* message);
+
+// parse scalar fields only, the chunk list is skipped without decoding
+bool ArrayToTreeNodeSummaryPB(const char* data, int32_t size, TreeNode* message);
 
 
 } // namespace rsfs
@@ -0,0 +1,193 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/rpc_channel_pool.h"
+
+#include <algorithm>
+
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/atomic.h"
+#include "rsfs/utils/hash.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int32(rsfs_rpc_connection_num);
+
+namespace rsfs {
+
+const int64_t kConnRetryBasePeriod = 100;
+const int64_t kConnRetryMaxPeriod = 10000;
+const uint32_t kEndpointShardNum = 16;
+
+RpcEndpoint::RpcEndpoint(const std::string& addr,
+                         const std::vector<sofa::pbrpc::RpcClient*>& clients,
+                         const sofa::pbrpc::RpcChannelOptions& options)
+    : m_addr(addr), m_conns(new Connection[clients.size()]),
+      m_conn_num(clients.size()), m_next_conn(0) {
+    for (uint32_t i = 0; i < m_conn_num; ++i) {
+        m_conns[i].channel = new sofa::pbrpc::RpcChannel(clients[i], addr,
+                                                          options);
+        m_conns[i].inflight = 0;
+        m_conns[i].fail_num = 0;
+        m_conns[i].retry_time = 0;
+    }
+}
+
+RpcEndpoint::~RpcEndpoint() {
+    for (uint32_t i = 0; i < m_conn_num; ++i) {
+        delete m_conns[i].channel;
+    }
+    delete[] m_conns;
+}
+
+const std::string& RpcEndpoint::GetAddr() const {
+    return m_addr;
+}
+
+uint32_t RpcEndpoint::Acquire() {
+    uint32_t start = static_cast<uint32_t>(atomic_inc_ret_old(&m_next_conn));
+    int64_t now = 0;
+    int32_t best_conn = -1;
+    int32_t any_conn = -1;
+    for (uint32_t i = 0; i < m_conn_num; ++i) {
+        uint32_t conn_no = (start + i) % m_conn_num;
+        Connection& conn = m_conns[conn_no];
+        if (any_conn < 0 || conn.inflight < m_conns[any_conn].inflight) {
+            any_conn = conn_no;
+        }
+        if (!IsHealthy(conn, &now)) {
+            continue;
+        }
+        if (best_conn < 0 || conn.inflight < m_conns[best_conn].inflight) {
+            best_conn = conn_no;
+        }
+    }
+    // all are failing, let the call surface the error to caller
+    if (best_conn < 0) {
+        best_conn = any_conn;
+    }
+    atomic_inc(&m_conns[best_conn].inflight);
+    return best_conn;
+}
+
+void RpcEndpoint::Release(uint32_t conn_no, bool failed, int error) {
+    Connection& conn = m_conns[conn_no];
+    atomic_dec(&conn.inflight);
+    bool conn_failed = failed
+        && (error == sofa::pbrpc::RPC_ERROR_CONNECTION_CLOSED
+            || error == sofa::pbrpc::RPC_ERROR_SERVER_SHUTDOWN
+            || error == sofa::pbrpc::RPC_ERROR_SERVER_UNREACHABLE
+            || error == sofa::pbrpc::RPC_ERROR_SERVER_UNAVAILABLE);
+    if (!conn_failed) {
+        if (conn.fail_num > 0) {
+            conn.fail_num = 0;
+        }
+        return;
+    }
+    int32_t fail_num = atomic_inc_ret_old(&conn.fail_num) + 1;
+    int64_t backoff = kConnRetryMaxPeriod;
+    if (fail_num < 16) {
+        backoff = std::min(kConnRetryBasePeriod << fail_num, kConnRetryMaxPeriod);
+    }
+    conn.retry_time = utils::GetMillis() + backoff;
+    VLOG(5) << "connection #" << conn_no << " to " << m_addr
+        << " failed " << fail_num << " times, back off " << backoff << " ms";
+}
+
+sofa::pbrpc::RpcChannel* RpcEndpoint::GetChannel(uint32_t conn_no) {
+    return m_conns[conn_no].channel;
+}
+
+bool RpcEndpoint::IsHealthy(const Connection& conn, int64_t* now) const {
+    if (conn.fail_num == 0) {
+        return true;
+    }
+    // only look at the clock when some connection is failing
+    if (*now == 0) {
+        *now = utils::GetMillis();
+    }
+    return conn.retry_time <= *now;
+}
+
+RpcChannelPool::RpcChannelPool() {
+    for (uint32_t i = 0; i < kEndpointShardNum; ++i) {
+        m_shards.push_back(new EndpointShard);
+    }
+}
+
+RpcChannelPool::~RpcChannelPool() {
+    for (uint32_t i = 0; i < m_shards.size(); ++i) {
+        EndpointMap::iterator it = m_shards[i]->endpoints.begin();
+        for (; it != m_shards[i]->endpoints.end(); ++it) {
+            delete it->second;
+        }
+        delete m_shards[i];
+    }
+    for (uint32_t i = 0; i < m_clients.size(); ++i) {
+        delete m_clients[i];
+    }
+}
+
+RpcEndpoint* RpcChannelPool::GetEndpoint(const std::string& addr) {
+    EndpointShard* shard = m_shards[utils::Fnv64Hash(addr) % m_shards.size()];
+    {
+        RWLock::ReaderLocker locker(shard->rwlock);
+        EndpointMap::const_iterator it = shard->endpoints.find(addr);
+        if (it != shard->endpoints.end()) {
+            return it->second;
+        }
+    }
+
+    RWLock::WriterLocker locker(&shard->rwlock);
+    // may be added by others before we got the lock
+    EndpointMap::const_iterator it = shard->endpoints.find(addr);
+    if (it != shard->endpoints.end()) {
+        return it->second;
+    }
+    RpcEndpoint* endpoint = NULL;
+    {
+        MutexLocker lock(m_mutex);
+        InitClients();
+        endpoint = new RpcEndpoint(addr, m_clients, m_channel_options);
+    }
+    shard->endpoints[addr] = endpoint;
+    return endpoint;
+}
+
+void RpcChannelPool::ResetOptions(const sofa::pbrpc::RpcClientOptions& options) {
+    MutexLocker lock(m_mutex);
+    m_options = options;
+    InitClients();
+    // keep the total work threads as configured, whatever the connections
+    sofa::pbrpc::RpcClientOptions client_options = options;
+    client_options.work_thread_num =
+        std::max<int32_t>(1, options.work_thread_num / m_clients.size());
+    for (uint32_t i = 0; i < m_clients.size(); ++i) {
+        m_clients[i]->ResetOptions(client_options);
+    }
+}
+
+sofa::pbrpc::RpcClientOptions RpcChannelPool::GetOptions() {
+    MutexLocker lock(m_mutex);
+    InitClients();
+    return m_clients[0]->GetOptions();
+}
+
+void RpcChannelPool::InitClients() {
+    if (!m_clients.empty()) {
+        return;
+    }
+    int32_t conn_num = std::max(1, FLAGS_rsfs_rpc_connection_num);
+    sofa::pbrpc::RpcClientOptions client_options = m_options;
+    client_options.work_thread_num =
+        std::max<int32_t>(1, m_options.work_thread_num / conn_num);
+    for (int32_t i = 0; i < conn_num; ++i) {
+        m_clients.push_back(new sofa::pbrpc::RpcClient(client_options));
+    }
+}
+
+} // namespace rsfs
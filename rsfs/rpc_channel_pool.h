@@ -0,0 +1,95 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_RPC_CHANNEL_POOL_H
+#define RSFS_RPC_CHANNEL_POOL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/lock/mutex.h"
+#include "common/lock/rwlock.h"
+#include "thirdparty/sofa/pbrpc/pbrpc.h"
+
+namespace rsfs {
+
+// the connections to one server address. each connection is a channel
+// of a distinct rpc client, so they do not share one tcp stream.
+class RpcEndpoint {
+public:
+    RpcEndpoint(const std::string& addr,
+                const std::vector<sofa::pbrpc::RpcClient*>& clients,
+                const sofa::pbrpc::RpcChannelOptions& options);
+    ~RpcEndpoint();
+
+    const std::string& GetAddr() const;
+
+    // pick the healthy connection with the least inflight calls,
+    // must be paired with Release when the call is done
+    uint32_t Acquire();
+    void Release(uint32_t conn_no, bool failed, int error);
+
+    sofa::pbrpc::RpcChannel* GetChannel(uint32_t conn_no);
+
+private:
+    struct Connection {
+        sofa::pbrpc::RpcChannel* channel;
+        volatile int32_t inflight;
+        volatile int32_t fail_num;
+        // not picked before this time (in ms) after failures
+        volatile int64_t retry_time;
+    };
+
+    bool IsHealthy(const Connection& conn, int64_t* now) const;
+
+private:
+    std::string m_addr;
+    Connection* m_conns;
+    uint32_t m_conn_num;
+    // rotate the start of search, so ties are spread
+    volatile int32_t m_next_conn;
+};
+
+// process wide rpc clients and the endpoints on top of them
+class RpcChannelPool {
+public:
+    RpcChannelPool();
+    ~RpcChannelPool();
+
+    // never released, the endpoint lives as long as the pool. a known
+    // address is resolved under the read lock of its shard, only a new
+    // one takes the write lock
+    RpcEndpoint* GetEndpoint(const std::string& addr);
+
+    void ResetOptions(const sofa::pbrpc::RpcClientOptions& options);
+    sofa::pbrpc::RpcClientOptions GetOptions();
+
+private:
+    typedef std::map<std::string, RpcEndpoint*> EndpointMap;
+
+    // the endpoints striped by address hash, so the lookups of
+    // different addresses seldom share a lock
+    struct EndpointShard {
+        RWLock rwlock;
+        EndpointMap endpoints;
+    };
+
+    void InitClients();
+
+private:
+    // guards the clients and options
+    Mutex m_mutex;
+    std::vector<sofa::pbrpc::RpcClient*> m_clients;
+    sofa::pbrpc::RpcClientOptions m_options;
+    sofa::pbrpc::RpcChannelOptions m_channel_options;
+
+    std::vector<EndpointShard*> m_shards;
+};
+
+} // namespace rsfs
+
+#endif // RSFS_RPC_CHANNEL_POOL_H
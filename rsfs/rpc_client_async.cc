@@ -6,12 +6,21 @@
 
 #include "rsfs/rpc_client_async.h"
 
+#include "rsfs/utils/atomic.h"
+
 namespace rsfs {
 
-sofa::pbrpc::RpcChannelOptions RpcClientAsyncBase::m_channel_options;
-std::map<std::string, sofa::pbrpc::RpcChannel*> RpcClientAsyncBase::m_rpc_channel_list;
 sofa::pbrpc::RpcClientOptions RpcClientAsyncBase::m_rpc_client_options;
-sofa::pbrpc::RpcClient RpcClientAsyncBase::m_rpc_client;
-Mutex RpcClientAsyncBase::m_mutex;
+RpcChannelPool RpcClientAsyncBase::m_channel_pool;
+
+static volatile int32_t s_rpc_inflight_num = 0;
+
+void AddRpcInflight(int32_t delta) {
+    atomic_add(&s_rpc_inflight_num, delta);
+}
+
+int32_t GetRpcInflightNum() {
+    return s_rpc_inflight_num;
+}
 
 } // namespace rsfs
@@ -13,6 +13,7 @@
 #include "bobby/bobby_client.h"
 #include "bobby/rpccontroller.h"
 #include "common/base/scoped_ptr.h"
+#include "common/lock/mutex.h"
 #include "common/net/ip_address.h"
 #include "common/thread/this_thread.h"
 #include "common/thread/thread_pool.h"
@@ -20,23 +21,118 @@
 
 #include "rsfs/proto/status_code.pb.h"
 #include "rsfs/proto/proto_helper.h"
+#include "rsfs/rpc_channel_pool.h"
+#include "rsfs/utils/object_pool.h"
 
 namespace rsfs {
 
+const uint32_t kRpcCallbackPoolSize = 1024;
+// the params are taken on the sending threads and put back on the rpc
+// threads, each keeps a few without lock and moves them in batches
+const uint32_t kRpcCallbackLocalNum = 64;
+
+// shared by the calls of one operation to give them up together, e.g.
+// the block reads of a slice once enough blocks are loaded. a call is
+// failed without being sent once its token is cancelled; the one in
+// flight is bounded by its timeout, and the owner takes the mutex to
+// drop the late replies consistently with Cancel.
+class RpcCancelToken {
+public:
+    RpcCancelToken() : m_is_cancelled(false) {}
+
+    void Cancel() {
+        MutexLocker lock(m_mutex);
+        m_is_cancelled = true;
+    }
+    bool IsCancelled() const {
+        return m_is_cancelled;
+    }
+    Mutex* GetMutex() {
+        return &m_mutex;
+    }
+
+private:
+    Mutex m_mutex;
+    volatile bool m_is_cancelled;
+};
+
+// the async calls sent and not called back yet in the process, so that
+// the owner of the callback pool can wait them before it is gone
+void AddRpcInflight(int32_t delta);
+int32_t GetRpcInflightNum();
+
+// the controller and the done closure of one async call in a single
+// object, recycled through a pool when the call is finished
 template <class Request, class Response, class Callback>
-struct RpcCallbackParam {
-    sofa::pbrpc::RpcController* rpc_controller;
+struct RpcCallbackParam : public google::protobuf::Closure {
+    sofa::pbrpc::RpcController rpc_controller;
     const Request* request;
     Response* response;
     Callback* closure;
     std::string tips;
     ThreadPool* thread_pool;
+    RpcEndpoint* endpoint;
+    uint32_t conn_no;
+
+    RpcCallbackParam()
+        : request(NULL), response(NULL), closure(NULL),
+          thread_pool(NULL), endpoint(NULL), conn_no(0) {}
+
+    static RpcCallbackParam* New() {
+        return GetPool()->Get();
+    }
+
+    void Clear() {
+        rpc_controller.Reset();
+        request = NULL;
+        response = NULL;
+        closure = NULL;
+        tips.clear();
+        thread_pool = NULL;
+        endpoint = NULL;
+        conn_no = 0;
+    }
+
+    virtual void Run() {
+        bool failed = rpc_controller.Failed();
+        int error = rpc_controller.ErrorCode();
+        endpoint->Release(conn_no, failed, error);
+        const Request* req = request;
+        Response* resp = response;
+        Callback* done = closure;
+        ThreadPool* tpool = thread_pool;
+        GetPool()->Put(this);
+        Dispatch(tpool, req, resp, done, failed, error);
+    }
+
+    // the user callbacks may encode, copy or retry, keep them off the
+    // network threads of rpc. run inline only if no pool is given
+    static void Dispatch(ThreadPool* thread_pool, const Request* request,
+                         Response* response, Callback* closure,
+                         bool failed, int error) {
+        if (thread_pool == NULL) {
+            UserCallback(request, response, closure, failed, error);
+            return;
+        }
+        // the base closure hides the name of the common one here
+        ::Closure<void>* task = NewClosure(&RpcCallbackParam::UserCallback,
+                                          request, response, closure,
+                                          failed, error);
+        thread_pool->AddTask(task);
+    }
+
+    static void UserCallback(const Request* request, Response* response,
+                             Callback* closure, bool failed, int error) {
+        closure->Run((Request*)request, response, failed, error);
+        AddRpcInflight(-1);
+    }
 
-    RpcCallbackParam(sofa::pbrpc::RpcController* ctrler, const Request* req,
-                     Response* resp, Callback* cb, const std::string& str,
-                     ThreadPool* tpool)
-        : rpc_controller(ctrler), request(req), response(resp),
-          closure(cb), tips(str), thread_pool(tpool) {}
+private:
+    static utils::ObjectPool<RpcCallbackParam>* GetPool() {
+        static utils::ObjectPool<RpcCallbackParam> pool(kRpcCallbackPoolSize,
+                                                        kRpcCallbackLocalNum);
+        return &pool;
+    }
 };
 
 class RpcClientAsyncBase {
@@ -55,43 +151,41 @@ public:
         if (-1 != thread_num) {
             m_rpc_client_options.work_thread_num = thread_num;
         }
-        m_rpc_client.ResetOptions(m_rpc_client_options);
+        m_channel_pool.ResetOptions(m_rpc_client_options);
 
-        sofa::pbrpc::RpcClientOptions new_options = m_rpc_client.GetOptions();
+        sofa::pbrpc::RpcClientOptions new_options = m_channel_pool.GetOptions();
         LOG(INFO) << "set rpc option: ("
             << "max_inflow: " << new_options.max_throughput_in
             << " MB/s, max_outflow: " << new_options.max_throughput_out
             << " MB/s, max_pending_buffer_size: " << new_options.max_pending_buffer_size
             << " MB, work_thread_num: " << new_options.work_thread_num
-            << ")";
+            << " per connection)";
+    }
+
+    // resolve once and keep the endpoint to save the lookup per call
+    static RpcEndpoint* GetEndpoint(const std::string& addr) {
+        return m_channel_pool.GetEndpoint(addr);
     }
 
-    RpcClientAsyncBase() : m_rpc_channel(NULL) {}
+    RpcClientAsyncBase() : m_endpoint(NULL), m_cancel_token(NULL) {}
     virtual ~RpcClientAsyncBase() {}
 
+    // the token must outlive the calls sent by this client
+    void SetCancelToken(RpcCancelToken* token) {
+        m_cancel_token = token;
+    }
+
 protected:
     virtual void ResetClient(const std::string& server_addr) {
-        std::map<std::string, sofa::pbrpc::RpcChannel*>::iterator it;
-        m_mutex.Lock();
-        it = m_rpc_channel_list.find(server_addr);
-        if (it != m_rpc_channel_list.end()) {
-            m_rpc_channel = it->second;
-        } else {
-            m_rpc_channel = m_rpc_channel_list[server_addr]
-                = new sofa::pbrpc::RpcChannel(&m_rpc_client, server_addr,
-                                              m_channel_options);
-        }
-        m_mutex.Unlock();
+        m_endpoint = m_channel_pool.GetEndpoint(server_addr);
     }
 
 protected:
-    sofa::pbrpc::RpcChannel* m_rpc_channel;
+    RpcEndpoint* m_endpoint;
+    RpcCancelToken* m_cancel_token;
 
-    static sofa::pbrpc::RpcChannelOptions m_channel_options;
-    static std::map<std::string, sofa::pbrpc::RpcChannel*> m_rpc_channel_list;
     static sofa::pbrpc::RpcClientOptions m_rpc_client_options;
-    static sofa::pbrpc::RpcClient m_rpc_client;
-    static Mutex m_mutex;
+    static RpcChannelPool m_channel_pool;
 };
 
 template<class ServerType>
@@ -100,6 +194,10 @@ public:
     RpcClientAsync(const std::string& addr) {
         ResetClient(addr);
     }
+    RpcClientAsync(RpcEndpoint* endpoint) {
+        m_endpoint = endpoint;
+        m_server_addr = endpoint->GetAddr();
+    }
     virtual ~RpcClientAsync() {}
 
     std::string GetConnectAddr() const {
@@ -120,7 +218,6 @@ protected:
         }
         */
         RpcClientAsyncBase::ResetClient(server_addr);
-        m_server_client.reset(new ServerType(m_rpc_channel));
         m_server_addr = server_addr;
         //VLOG(5) << "reset connected address to: " << server_addr;
 
@@ -133,54 +230,33 @@ protected:
                               const Request* request, Response* response,
                               Callback* closure, const std::string& tips,
                               int32_t rpc_timeout, ThreadPool* thread_pool) {
-        if (NULL == m_server_client.get()) {
-            Closure<void>* done = NewClosure(
-                &RpcClientAsync::template UserCallback<Request, Response, Callback>,
-                request, response, closure, true,
-                (int)sofa::pbrpc::RPC_ERROR_RESOLVE_ADDRESS);
-            thread_pool->AddTask(done);
+        typedef RpcCallbackParam<Request, Response, Callback> Param;
+        // done once the user callback returns, whatever the path
+        AddRpcInflight(1);
+        if (NULL == m_endpoint) {
+            Param::Dispatch(thread_pool, request, response, closure, true,
+                            (int)sofa::pbrpc::RPC_ERROR_RESOLVE_ADDRESS);
             return true;
         }
-        sofa::pbrpc::RpcController* rpc_controller =
-            new sofa::pbrpc::RpcController;
-        rpc_controller->SetTimeout(rpc_timeout);
-        RpcCallbackParam<Request, Response, Callback>* param =
-            new RpcCallbackParam<Request, Response, Callback>(rpc_controller,
-                    request, response, closure, tips, thread_pool);
-        google::protobuf::Closure* done = google::protobuf::NewCallback(
-            &RpcClientAsync::template RpcCallback<Request, Response, Callback>,
-            param);
-        (m_server_client.get()->*func)(rpc_controller, request, response, done);
-        return true;
-    }
-
-    template <class Request, class Response, class Callback>
-    static void RpcCallback(RpcCallbackParam<Request, Response, Callback>* param) {
-        sofa::pbrpc::RpcController* rpc_controller = param->rpc_controller;
-        const Request* request = param->request;
-        Response* response = param->response;
-        Callback* closure = param->closure;
-        ThreadPool* thread_pool = param->thread_pool;
-
-        bool failed = rpc_controller->Failed();
-        int error = rpc_controller->ErrorCode();
-        if (failed) {
-            //LOG(ERROR) << "RpcRequest failed: " << param->tips
-            //    << ". Reason: " << rpc_controller->ErrorText();
+        if (m_cancel_token != NULL && m_cancel_token->IsCancelled()) {
+            Param::Dispatch(thread_pool, request, response, closure, true,
+                            (int)sofa::pbrpc::RPC_ERROR_REQUEST_CANCELED);
+            return true;
         }
-        delete rpc_controller;
-        delete param;
-
-        Closure<void>* done = NewClosure(
-            &RpcClientAsync::template UserCallback<Request, Response, Callback>,
-            request, response, closure, failed, error);
-        thread_pool->AddTask(done);
-    }
-
-    template <class Request, class Response, class Callback>
-    static void UserCallback(const Request* request, Response* response,
-                             Callback* closure, bool failed, int error) {
-        closure->Run((Request*)request, response, failed, error);
+        Param* param = Param::New();
+        param->rpc_controller.SetTimeout(rpc_timeout);
+        param->request = request;
+        param->response = response;
+        param->closure = closure;
+        param->tips = tips;
+        param->thread_pool = thread_pool;
+        // spread calls over the connections of endpoint, the stub is
+        // a thin wrapper of channel and need not outlive the call
+        param->endpoint = m_endpoint;
+        param->conn_no = m_endpoint->Acquire();
+        ServerType server_client(m_endpoint->GetChannel(param->conn_no));
+        (server_client.*func)(&param->rpc_controller, request, response, param);
+        return true;
     }
 
     virtual bool PollAndResetServerAddr() {
@@ -192,7 +268,6 @@ protected:
     }
 
 private:
-    scoped_ptr<ServerType> m_server_client;
     std::string m_server_addr;
 };
 
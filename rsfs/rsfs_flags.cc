@@ -19,11 +19,13 @@ DEFINE_int64(rsfs_heartbeat_retry_period_factor, 1, "the heartbeat period factor
 DEFINE_int32(rsfs_heartbeat_retry_times, 5, "the max retry times when fail to send report request");
 
 DEFINE_string(rsfs_working_dir, "./", "the base dir for system data");
+DEFINE_int32(rsfs_rpc_connection_num, 4, "the number of connections to each server address for async rpc");
 
 /////////  master /////////
 
 DEFINE_string(rsfs_master_addr, "127.0.0.1", "the master address of rsfs system");
 DEFINE_string(rsfs_master_port, "10000", "the master port of rsfs system");
+DEFINE_int64(rsfs_heartbeat_suspect_period_factor, 3, "the period factor when lose heartbeat to mark node suspect, no new chunk is placed on it");
 DEFINE_int64(rsfs_heartbeat_timeout_period_factor, 120, "the timeout period factor when lose heartbeat");
 DEFINE_int32(rsfs_master_connect_retry_times, 5, "the max retry times when connect to master");
 DEFINE_int32(rsfs_master_connect_retry_period, 1000, "the retry period (in ms) between two master connection");
@@ -39,20 +41,39 @@ DEFINE_int32(rsfs_master_rpc_work_thread_num, 8, "thread num of master rpc clien
 
 DEFINE_int32(rsfs_master_thread_min_num, 1, "the min thread number for master impl operations");
 DEFINE_int32(rsfs_master_thread_max_num, 10, "the max thread number for master impl operations");
+DEFINE_int32(rsfs_master_path_lock_stripe_num, 1024, "the number of lock stripes hashed by path to serialize meta mutations on a path");
+DEFINE_int32(rsfs_master_placement_max_level, 2, "the weakest failure domain a file may be placed on: 0 for distinct racks, 1 for distinct nodes, 2 for any node");
+DEFINE_double(rsfs_master_load_ewma_alpha, 0.3, "the smoothing factor of ewma on snode load reported by heartbeat");
 
 DEFINE_bool(rsfs_delete_obsolete_tabledir_enabled, false, "delete table dir or not when deleting table");
 
 DEFINE_string(rsfs_master_db_path, "./master_meta", "the path of master meta info");
 DEFINE_string(rsfs_master_dirmeta_path, "dir_meta", "the path of dir meta store");
 DEFINE_string(rsfs_master_filemeta_path, "file_meta", "the path of file meta");
+DEFINE_int32(rsfs_master_filemeta_shard_num, 1, "the number of file meta shards partitioned by path hash, fixed once meta exists");
+DEFINE_int64(rsfs_master_read_lease_period, 30000, "the period (in ms) of read lease granted on closed file meta, 0 to disable");
+DEFINE_int32(rsfs_master_meta_cache_size, 256, "the memory budget (in MB) of decoded meta cache, 0 to disable");
+DEFINE_bool(rsfs_master_meta_sync_enabled, true, "enable sync (fsync) durability for master meta commits");
+DEFINE_int32(rsfs_master_fid_lease_range, 10000, "the number of file ids leased from storage at a time");
+DEFINE_int64(rsfs_master_gc_period, 10000, "the period (in ms) of block garbage collection rounds, 0 to disable");
+DEFINE_int32(rsfs_master_gc_file_num, 1000, "the max number of removed files scanned in one gc round");
+DEFINE_int32(rsfs_master_gc_node_block_num, 1000, "the max number of blocks deleted on one snode in one gc round");
+DEFINE_int32(rsfs_master_gc_thread_num, 4, "the thread number to send block deletes to snodes in parallel");
+DEFINE_int32(rsfs_master_gc_rpc_timeout_period, 10000, "the timeout period (in ms) for each block delete rpc");
+DEFINE_int64(rsfs_master_gc_dead_node_expire_period, 604800000, "the period (in ms) after removal the blocks on a dead snode are given up by gc, 0 to never give up");
+DEFINE_int64(rsfs_master_write_lease_period, 600000, "the period (in ms) without any write after which a file open for write is sealed or removed");
+DEFINE_int32(rsfs_master_recovery_file_num, 100, "the max number of expired write-open files recovered in one round");
 
 ///////// rsfs node  /////////
 
 DEFINE_string(rsfs_snode_addr, "127.0.0.1", "the rsfs node address of rsfs system");
 DEFINE_string(rsfs_snode_port, "20000", "the rsfs node port of rsfs system");
+DEFINE_string(rsfs_snode_rack, "", "the rack (failure domain) label of rsfs node, empty means node itself");
 DEFINE_int32(rsfs_snode_write_thread_num, 10, "the write thread number of rsfs node server");
 DEFINE_int32(rsfs_snode_read_thread_num, 40, "the read thread number of rsfs node server");
 DEFINE_int32(rsfs_snode_scan_thread_num, 5, "the scan thread number of rsfs node server");
+DEFINE_int32(rsfs_snode_scan_idle_timeout, 60000, "the period (in ms) a scan not accessed is dropped");
+DEFINE_int32(rsfs_snode_scan_max_buffer_size, 64, "the max size (in MB) read ahead for one scan");
 DEFINE_int32(rsfs_snode_manual_compact_thread_num, 2, "the manual compact thread number of rsfs node server");
 DEFINE_int32(rsfs_snode_thread_min_num, 1, "the min thread number for rsfs node impl operations");
 DEFINE_int32(rsfs_snode_thread_max_num, 10, "the max thread number for rsfs node impl operations");
@@ -84,11 +105,28 @@ DEFINE_int32(rsfs_sdk_rscode_tail_backup_num, 3, "the backup number for tail dat
 
 DEFINE_int32(rsfs_sdk_write_retry_times, 3, "the max retry time of write operation");
 DEFINE_int32(rsfs_sdk_read_retry_times, 3, "the max retry time of read operation");
-DEFINE_int32(rsfs_sdk_thread_min_num, 1, "the min thread number for sdk");
-DEFINE_int32(rsfs_sdk_thread_max_num, 20, "the max thread number for sdk");
+DEFINE_int32(rsfs_sdk_retry_tick_period, 10, "the tick period (ms) of the wheel holding rpc retries");
+DEFINE_int32(rsfs_sdk_retry_max_period, 5000, "the max backoff period (ms) before a rpc retry");
+DEFINE_int32(rsfs_sdk_retry_thread_num, 2, "the thread number re-issuing rpc retries");
+DEFINE_int32(rsfs_sdk_message_pool_size, 256, "the max number of idle rpc messages of each type kept for reuse in sdk");
+DEFINE_int32(rsfs_sdk_message_local_num, 16, "the max number of idle rpc messages of each type kept by each thread without lock, 0 to disable");
+DEFINE_int32(rsfs_sdk_read_context_num, 16, "the max number of idle read contexts (slice buffer and decoder) kept per sdk handle");
+DEFINE_bool(rsfs_sdk_scan_enabled, true, "enable to stream the sequential reads through snode scans");
+DEFINE_int32(rsfs_sdk_scan_window_num, 16, "the blocks each snode scan reads ahead for sdk");
+DEFINE_int32(rsfs_sdk_io_timeout, 0, "the deadline (ms) of each sdk operation, including its retries, 0 to bound each rpc only");
+DEFINE_int32(rsfs_sdk_thread_min_num, 1, "the min thread number of the rpc callbacks shared by sdk handles");
+DEFINE_int32(rsfs_sdk_thread_max_num, 20, "the max thread number of the rpc callbacks shared by sdk handles");
 DEFINE_bool(rsfs_sdk_rpc_limit_enabled, false, "enable the rpc traffic limit in sdk");
 DEFINE_int32(rsfs_sdk_rpc_limit_max_inflow, 10, "the max bandwidth (in MB/s) for sdk rpc traffic limitation on input flow");
 DEFINE_int32(rsfs_sdk_rpc_limit_max_outflow, 10, "the max bandwidth (in MB/s) for sdk rpc traffic limitation on output flow");
 DEFINE_int32(rsfs_sdk_rpc_max_pending_buffer_size, 200, "max pending buffer size (in MB) for sdk rpc");
 DEFINE_int32(rsfs_sdk_rpc_work_thread_num, 8, "thread num of sdk rpc client");
 DEFINE_int32(rsfs_sdk_rpc_list_size_limit, 1024, "the size limit (KB) of each meta list operation");
+DEFINE_int32(rsfs_sdk_meta_cache_num, 10000, "the max number of leased file meta cached in sdk, 0 to disable");
+DEFINE_int32(rsfs_sdk_stat_batch_num, 1000, "the max number of files stated in one meta request");
+DEFINE_int64(rsfs_sdk_write_lease_renew_period, 60000, "the period (in ms) the writers renew the write lease of open files, 0 to disable");
+DEFINE_int32(rsfs_sdk_async_thread_num, 8, "the thread number running the async io of sdk handles");
+DEFINE_int32(rsfs_sdk_list_thread_num, 8, "the thread number helping the parallel list of meta ranges");
+DEFINE_int32(rsfs_sdk_shutdown_timeout, 60000, "the max time (in ms) the sdk shutdown waits the rpcs in flight");
+DEFINE_int32(rsfs_sdk_async_max_depth, 256, "the max number of outstanding async io per sdk handle");
+DEFINE_int32(rsfs_sdk_list_parallel_num, 8, "the number of ranges listed concurrently by parallel list");
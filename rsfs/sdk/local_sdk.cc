@@ -6,6 +6,11 @@
 
 #include "rsfs/sdk/local_sdk.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "common/base/string_ext.h"
 #include "common/file/file_path.h"
 #include "common/file/file_types.h"
@@ -19,7 +24,10 @@ REGISTER_RSFS_SDK(LOCAL_SDK_PREFIX, LocalSDK);
 LocalSDK::LocalSDK()
     : m_file_stream(new FileStream()) {}
 
-LocalSDK::~LocalSDK() {}
+LocalSDK::~LocalSDK() {
+    // the async io run on this handle
+    WaitAsyncIo();
+}
 
 std::string LocalSDK::GetImplName() {
     return LOCAL_SDK_PREFIX;
@@ -98,7 +106,7 @@ int64_t LocalSDK::GetSize(ErrorCode* err) {
 
 bool LocalSDK::ListImpl(const std::string& start, const std::string& end,
                         std::string* last_one, std::vector<TreeNode>* list,
-                        ErrorCode* err) {
+                        ErrorCode* err, ListMode mode) {
     std::string path;
     SplitStringEnd(start, &path, NULL, "/");
     std::vector<std::string> file_names;
@@ -122,6 +130,77 @@ bool LocalSDK::ListImpl(const std::string& start, const std::string& end,
     return true;
 }
 
+bool LocalSDK::StatImpl(const std::vector<std::string>& paths,
+                        std::vector<FileStat>* stats, ErrorCode* err) {
+    for (uint32_t i = 0; i < paths.size(); ++i) {
+        stats->push_back(FileStat());
+        FileStat& file_stat = stats->back();
+        file_stat.set_file_name(paths[i]);
+        struct stat st;
+        if (0 != stat(paths[i].c_str(), &st)) {
+            file_stat.set_status(kKeyNotExist);
+            continue;
+        }
+        file_stat.set_status(kMasterOk);
+        file_stat.set_fid(st.st_ino);
+        file_stat.set_file_size(st.st_size);
+    }
+    return true;
+}
+
+bool LocalSDK::RemoveImpl(const std::string& file_path, ErrorCode* err) {
+    if (0 == remove(file_path.c_str())) {
+        return true;
+    }
+    if (errno == ENOENT) {
+        err->SetFailed(ErrorCode::kNotFound, "file not exist");
+    } else {
+        LOG(ERROR) << "fail to remove file: " << file_path
+            << ", err: " << strerror(errno);
+        err->SetFailed(ErrorCode::kSystem, "fail to remove file");
+    }
+    return false;
+}
+
+bool LocalSDK::ListTreeImpl(const std::string& dir_path,
+                            std::vector<TreeNode>* list, ErrorCode* err) {
+    struct stat dir_stat;
+    if (0 != lstat(dir_path.c_str(), &dir_stat) || !S_ISDIR(dir_stat.st_mode)) {
+        // a file or nothing, no child to remove
+        return true;
+    }
+    DIR* dir = opendir(dir_path.c_str());
+    if (dir == NULL) {
+        LOG(ERROR) << "fail to open dir: " << dir_path
+            << ", err: " << strerror(errno);
+        err->SetFailed(ErrorCode::kSystem, "fail to open dir");
+        return false;
+    }
+    bool is_ok = true;
+    struct dirent* entry = NULL;
+    while (is_ok && (entry = readdir(dir)) != NULL) {
+        if (0 == strcmp(entry->d_name, ".") || 0 == strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        std::string abs_path = dir_path + "/" + entry->d_name;
+        struct stat filestat;
+        if (0 != lstat(abs_path.c_str(), &filestat)) {
+            LOG(ERROR) << "invalid file path: " << abs_path;
+            continue;
+        }
+        // the links are removed, not followed
+        if (S_ISDIR(filestat.st_mode)) {
+            is_ok = ListTreeImpl(abs_path, list, err);
+        }
+        TreeNode node;
+        node.set_name(abs_path);
+        StatToTreeNode(filestat, &node);
+        list->push_back(node);
+    }
+    closedir(dir);
+    return is_ok;
+}
+
 void LocalSDK::StatToTreeNode(const struct stat& st, TreeNode* tn) {
     tn->set_fid(st.st_ino);
     tn->set_status(kMetaReady);
@@ -46,7 +46,13 @@ protected:
                   ErrorCode* err);
     bool ListImpl(const std::string& start, const std::string& end,
                   std::string* last_one, std::vector<TreeNode>* list,
-                  ErrorCode* err);
+                  ErrorCode* err, ListMode mode);
+    bool StatImpl(const std::vector<std::string>& paths,
+                  std::vector<FileStat>* stats, ErrorCode* err);
+    bool RemoveImpl(const std::string& file_path, ErrorCode* err);
+    // walk the real directory, the children come before their parent
+    bool ListTreeImpl(const std::string& dir_path,
+                      std::vector<TreeNode>* list, ErrorCode* err);
 
 protected:
     void StatToTreeNode(const struct stat& st, TreeNode* tn);
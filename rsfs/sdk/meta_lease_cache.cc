@@ -0,0 +1,73 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/sdk/meta_lease_cache.h"
+
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace sdk {
+
+MetaLeaseCache::MetaLeaseCache(uint32_t capacity)
+    : m_capacity(capacity) {}
+
+MetaLeaseCache::~MetaLeaseCache() {}
+
+bool MetaLeaseCache::Lookup(const std::string& path,
+                            OpenFileResponse* response) {
+    MutexLocker lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return false;
+    }
+    if (it->second.expire_time <= utils::GetMillis()) {
+        VLOG(5) << "meta lease expired (path: " << path << ")";
+        EraseEntry(it);
+        return false;
+    }
+    m_lru_list.splice(m_lru_list.begin(), m_lru_list, it->second.lru_it);
+    response->CopyFrom(it->second.response);
+    return true;
+}
+
+void MetaLeaseCache::Insert(const std::string& path,
+                            const OpenFileResponse& response,
+                            int64_t expire_time) {
+    if (m_capacity == 0) {
+        return;
+    }
+    MutexLocker lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(path);
+    if (it != m_entries.end()) {
+        EraseEntry(it);
+    }
+    while (m_entries.size() >= m_capacity) {
+        EraseEntry(m_entries.find(m_lru_list.back()));
+    }
+    m_lru_list.push_front(path);
+    Entry& entry = m_entries[path];
+    entry.response.CopyFrom(response);
+    entry.expire_time = expire_time;
+    entry.lru_it = m_lru_list.begin();
+}
+
+void MetaLeaseCache::Invalidate(const std::string& path) {
+    MutexLocker lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(path);
+    if (it != m_entries.end()) {
+        EraseEntry(it);
+    }
+}
+
+void MetaLeaseCache::EraseEntry(EntryMap::iterator it) {
+    m_lru_list.erase(it->second.lru_it);
+    m_entries.erase(it);
+}
+
+} // namespace sdk
+} // namespace rsfs
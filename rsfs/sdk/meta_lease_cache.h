@@ -0,0 +1,59 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SDK_META_LEASE_CACHE_H
+#define RSFS_SDK_META_LEASE_CACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "common/lock/mutex.h"
+
+#include "rsfs/proto/master_rpc.pb.h"
+
+namespace rsfs {
+namespace sdk {
+
+// caches the OpenFile results of read opens within their lease.
+// entries are evicted by lru order once capacity is reached.
+class MetaLeaseCache {
+public:
+    MetaLeaseCache(uint32_t capacity);
+    ~MetaLeaseCache();
+
+    bool Lookup(const std::string& path, OpenFileResponse* response);
+
+    // expire_time (in ms) is counted from before the request is sent,
+    // so it never outlives the lease on master
+    void Insert(const std::string& path, const OpenFileResponse& response,
+                int64_t expire_time);
+
+    void Invalidate(const std::string& path);
+
+private:
+    struct Entry {
+        OpenFileResponse response;
+        int64_t expire_time;
+        std::list<std::string>::iterator lru_it;
+    };
+    typedef std::map<std::string, Entry> EntryMap;
+
+    void EraseEntry(EntryMap::iterator it);
+
+private:
+    const uint32_t m_capacity;
+
+    mutable Mutex m_mutex;
+    EntryMap m_entries;
+    // most recently used at front
+    std::list<std::string> m_lru_list;
+};
+
+} // namespace sdk
+} // namespace rsfs
+
+#endif // RSFS_SDK_META_LEASE_CACHE_H
@@ -5,15 +5,21 @@
 
 #include "rsfs/sdk/rsfs_sdk.h"
 
+#include <algorithm>
+
 #include "sofa/pbrpc/pbrpc.h"
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 
 #include "rsfs/master/master_client.h"
 #include "rsfs/proto/proto_helper.h"
-#include "rsfs/sdk/sdk_utils.h"
+#include "rsfs/sdk/scan_stream.h"
+#include "rsfs/sdk/sdk_runtime.h"
 #include "rsfs/snode/snode_client.h"
 #include "rsfs/types.h"
+#include "rsfs/utils/block_id.h"
+#include "rsfs/utils/object_pool.h"
+#include "rsfs/utils/timer_wheel.h"
 #include "rsfs/utils/utils_cmd.h"
 
 DECLARE_int32(rsfs_sdk_rscode_mm);
@@ -24,20 +30,140 @@ DECLARE_int32(rsfs_sdk_write_retry_times);
 DECLARE_int32(rsfs_sdk_read_retry_times);
 DECLARE_int32(rsfs_snode_connect_retry_period);
 
-DECLARE_int32(rsfs_sdk_thread_min_num);
-DECLARE_int32(rsfs_sdk_thread_max_num);
-DECLARE_bool(rsfs_sdk_rpc_limit_enabled);
-DECLARE_int32(rsfs_sdk_rpc_limit_max_inflow);
-DECLARE_int32(rsfs_sdk_rpc_limit_max_outflow);
-DECLARE_int32(rsfs_sdk_rpc_max_pending_buffer_size);
-DECLARE_int32(rsfs_sdk_rpc_work_thread_num);
 DECLARE_int32(rsfs_sdk_rpc_list_size_limit);
+DECLARE_int32(rsfs_sdk_stat_batch_num);
+DECLARE_int32(rsfs_sdk_retry_max_period);
+DECLARE_int32(rsfs_sdk_message_pool_size);
+DECLARE_int32(rsfs_sdk_message_local_num);
+DECLARE_int32(rsfs_sdk_io_timeout);
+DECLARE_int32(rsfs_sdk_read_context_num);
+DECLARE_bool(rsfs_sdk_scan_enabled);
+DECLARE_int32(rsfs_sdk_scan_window_num);
 
 namespace rsfs {
 namespace sdk {
 
 REGISTER_RSFS_SDK(RSFS_SDK_PREFIX, RsfsSDK);
 
+static MetaLeaseCache* GetMetaLeaseCache() {
+    return SdkRuntime::Get()->GetMetaLeaseCache();
+}
+
+static WriteLeaseKeeper* GetWriteLeaseKeeper() {
+    return SdkRuntime::Get()->GetWriteLeaseKeeper();
+}
+
+// the block rpc messages are recycled, the payload kept by a message
+// is reused by the next block read or written through it. they are
+// taken on the caller threads and put back on the callback threads,
+// which move them in batches through the shared list
+template <class T>
+static utils::ObjectPool<T>* GetMessagePool() {
+    static utils::ObjectPool<T> message_pool(FLAGS_rsfs_sdk_message_pool_size,
+                                             FLAGS_rsfs_sdk_message_local_num);
+    return &message_pool;
+}
+
+template <class T>
+static T* NewMessage() {
+    return GetMessagePool<T>()->Get();
+}
+
+template <class T>
+static void RecycleMessage(T* message) {
+    GetMessagePool<T>()->Put(message);
+}
+
+// the failed block rpcs wait their backoff here instead of sleeping
+// on the rpc callback threads
+static utils::TimerWheel* GetRetryWheel() {
+    return SdkRuntime::Get()->GetRetryWheel();
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     OpenDataRequest* request, OpenDataResponse* response,
+                     Closure<void, OpenDataRequest*, OpenDataResponse*, bool, int>* done) {
+    node_client->OpenData(request, response, done);
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     CloseDataRequest* request, CloseDataResponse* response,
+                     Closure<void, CloseDataRequest*, CloseDataResponse*, bool, int>* done) {
+    node_client->CloseData(request, response, done);
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     WriteDataRequest* request, WriteDataResponse* response,
+                     Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done) {
+    node_client->WriteData(request, response, done);
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     ReadDataRequest* request, ReadDataResponse* response,
+                     Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done) {
+    node_client->ReadData(request, response, done);
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     WriteDataBatchRequest* request, WriteDataBatchResponse* response,
+                     Closure<void, WriteDataBatchRequest*, WriteDataBatchResponse*, bool, int>* done) {
+    node_client->WriteDataBatch(request, response, done);
+}
+
+static void SendData(snode::SNodeClientAsync* node_client,
+                     ReadDataBatchRequest* request, ReadDataBatchResponse* response,
+                     Closure<void, ReadDataBatchRequest*, ReadDataBatchResponse*, bool, int>* done) {
+    node_client->ReadDataBatch(request, response, done);
+}
+
+// the retry is failed without sending if its operation is over, the
+// request left to be sent carries the remaining time of operation
+template <class Request, class Response>
+static void ResendData(RpcEndpoint* endpoint,
+                       Request* request, Response* response,
+                       Closure<void, Request*, Response*, bool, int>* done,
+                       int64_t deadline, RpcCancelToken* cancel_token) {
+    if (cancel_token != NULL && cancel_token->IsCancelled()) {
+        done->Run(request, response, true, sofa::pbrpc::RPC_ERROR_REQUEST_CANCELED);
+        return;
+    }
+    if (deadline > 0) {
+        int64_t remain_time = deadline - utils::GetMillis();
+        if (remain_time <= 0) {
+            done->Run(request, response, true, sofa::pbrpc::RPC_ERROR_REQUEST_TIMEOUT);
+            return;
+        }
+        request->set_timeout_ms(remain_time);
+    }
+    snode::SNodeClientAsync node_client(endpoint);
+    node_client.SetCancelToken(cancel_token);
+    SendData(&node_client, request, response, done);
+}
+
+// re-issue the rpc to endpoint after the backoff of retry_no-th retry
+template <class Request, class Response>
+static void ScheduleResend(RpcEndpoint* endpoint, int32_t retry_no,
+                           Request* request, Response* response,
+                           Closure<void, Request*, Response*, bool, int>* done,
+                           int64_t deadline, RpcCancelToken* cancel_token = NULL) {
+    int64_t wait_time = utils::GetBackoffTime(retry_no,
+                                              FLAGS_rsfs_snode_connect_retry_period,
+                                              FLAGS_rsfs_sdk_retry_max_period);
+    Closure<void>* task = NewClosure(&ResendData<Request, Response>,
+                                     endpoint, request, response, done,
+                                     deadline, cancel_token);
+    GetRetryWheel()->AddTask(wait_time, task);
+}
+
+ReadContext::ReadContext()
+    : rscode(new rscode::RSCode("rsfs_rscode",
+                                FLAGS_rsfs_sdk_rscode_mm,
+                                FLAGS_rsfs_sdk_rscode_kk,
+                                FLAGS_rsfs_sdk_rscode_block_size)),
+      slice_buffer(new char[FLAGS_rsfs_sdk_rscode_block_size *
+                            (FLAGS_rsfs_sdk_rscode_mm + FLAGS_rsfs_sdk_rscode_kk)]),
+      slice_no(-1), deadline(0) {}
+
 RsfsSDK::RsfsSDK()
     : m_master_client(new master::MasterClient()),
       m_rscode(new rscode::RSCode("rsfs_rscode",
@@ -48,84 +174,142 @@ RsfsSDK::RsfsSDK()
       m_cur_node_no(0), m_cur_rsblock_no(0),
       m_remain_block_size(0), m_cur_slice_no(-1),
       m_max_crash_slice_no(-1), m_max_crash_block_num(0),
+      m_open_crash_slice_no(-1), m_open_crash_block_num(0),
       m_last_block_buffer(NULL), m_file_mode("r"),
       m_file_size(0), m_file_id(0), m_seq_read_offset(0),
-      m_tail_slice_no(-1), m_tail_num(0),
-      m_thread_pool(FLAGS_rsfs_sdk_thread_min_num,
-                    FLAGS_rsfs_sdk_thread_max_num) {
-    snode::SNodeClientAsync::SetThreadPool(&m_thread_pool);
-    snode::SNodeClientAsync::SetRpcOption(
-        FLAGS_rsfs_sdk_rpc_limit_enabled ? FLAGS_rsfs_sdk_rpc_limit_max_inflow : -1,
-        FLAGS_rsfs_sdk_rpc_limit_enabled ? FLAGS_rsfs_sdk_rpc_limit_max_outflow : -1,
-        FLAGS_rsfs_sdk_rpc_max_pending_buffer_size, FLAGS_rsfs_sdk_rpc_work_thread_num);
+      m_tail_slice_no(-1), m_tail_num(0), m_tail_copy_num(0),
+      m_read_contexts(new utils::ObjectPool<ReadContext>(
+              FLAGS_rsfs_sdk_read_context_num)),
+      m_scan_slice_no(-1),
+      m_is_scan_disabled(false) {}
+
+RsfsSDK::~RsfsSDK() {
+    // the async io run on this handle
+    WaitAsyncIo();
+    CloseScans();
+    if (m_file_mode == "w") {
+        GetWriteLeaseKeeper()->Remove(m_file_id);
+    }
 }
 
-RsfsSDK::~RsfsSDK() {}
-
 std::string RsfsSDK::GetImplName() {
     return RSFS_SDK_PREFIX;
 }
 
+bool RsfsSDK::IsPreadConcurrent() {
+    // each pread of a read handle loads slices into its own context
+    return m_file_mode != "w";
+}
+
 bool RsfsSDK::OpenImpl(const std::string& file_path,
                        const std::string& mode,
                        ErrorCode* err) {
+    int64_t deadline = GetOperationDeadline();
     OpenFileRequest request;
     OpenFileResponse response;
 
-    request.set_sequence_id(++m_last_sequence_id);
+    request.set_sequence_id(NextSequenceId());
     request.set_file_name(file_path);
     request.set_node_num(m_rscode->GetMK());
     if (mode == "w") {
         request.set_type(OpenFileRequest::WRITE);
+        request.set_rscode_m(m_rscode->GetM());
+        request.set_rscode_k(m_rscode->GetMK() - m_rscode->GetM());
+        request.set_block_size(FLAGS_rsfs_sdk_rscode_block_size);
         m_remain_block_size = FLAGS_rsfs_sdk_rscode_block_size;
         m_last_block_buffer.reset(new char[FLAGS_rsfs_sdk_rscode_block_size]);
         m_cur_slice_no = 0;
     } else {
+        // the reads load slices into their own contexts
         request.set_type(OpenFileRequest::RANDOM_READ);
         m_remain_block_size = 0;
-        m_last_block_buffer.reset(new char[FLAGS_rsfs_sdk_rscode_block_size *
-                                  m_rscode->GetMK()]);
     }
 
-    if (!m_master_client->OpenFile(&request, &response)
+    int64_t request_time = utils::GetMillis();
+    bool is_cached = false;
+    if (request.type() != OpenFileRequest::WRITE
+        && GetMetaLeaseCache()->Lookup(file_path, &response)) {
+        VLOG(5) << "open file by leased meta: " << file_path;
+        is_cached = true;
+    } else if (!m_master_client->OpenFile(&request, &response)
         || response.status() != kMasterOk) {
         LOG(ERROR) << "rpc fail to open file: " << file_path
             << ", err: " << StatusCodeToString(response.status());
         err->SetFailed(ErrorCode::kSystem, "rpc fail to open file");
         return false;
+    } else if (response.lease_period() > 0) {
+        GetMetaLeaseCache()->Insert(file_path, response,
+                                    request_time + response.lease_period());
     }
 
+    CloseScans();
+    m_is_scan_disabled = false;
     m_file_name = file_path;
     m_file_id = response.fid();
     m_file_mode = mode;
     m_file_size = response.file_size();
     m_tail_slice_no = response.tail_slice();
     m_tail_num = response.tail_num();
+    m_tail_copy_num = response.tail_copy_num();
+    if (m_tail_copy_num == 0) {
+        m_tail_copy_num = FLAGS_rsfs_sdk_rscode_kk + 1;
+    }
     m_node_list.CopyFrom(response.nodes());
+    m_node_endpoints.resize(m_node_list.size());
+    for (int32_t i = 0; i < m_node_list.size(); ++i) {
+        m_node_endpoints[i] =
+            snode::SNodeClientAsync::GetEndpoint(m_node_list.Get(i).addr());
+    }
     m_max_crash_slice_no = response.crash_slice();
     m_max_crash_block_num = response.crash_num();
+    m_open_crash_slice_no = m_max_crash_slice_no;
+    m_open_crash_block_num = m_max_crash_block_num;
     CHECK(m_node_list.size() > 0);
-    PallelOpenDataFile();
+    if (mode == "w") {
+        GetWriteLeaseKeeper()->Add(m_file_id);
+    }
+    if (!PallelOpenDataFile(deadline)) {
+        // node list may be stale, ask master next time
+        LOG(WARNING) << "fail to open all data file of: " << file_path;
+        GetMetaLeaseCache()->Invalidate(file_path);
+    }
     return true;
 }
 
 bool RsfsSDK::Close(ErrorCode* err) {
+    int64_t deadline = GetOperationDeadline();
     CloseFileRequest request;
     CloseFileResponse response;
     request.set_file_size(m_file_size);
 
-    HandleTailBlocks();
-    PallelCloseDataFile();
+    CloseScans();
+    HandleTailBlocks(deadline);
+    PallelCloseDataFile(deadline);
 
-    request.set_sequence_id(++m_last_sequence_id);
+    // a read open leaves no state on master, e.g. the one served by the
+    // meta lease cache never reached it
+    if (m_file_mode != "w"
+        && m_max_crash_slice_no == m_open_crash_slice_no
+        && m_max_crash_block_num == m_open_crash_block_num) {
+        VLOG(5) << "no crash found, skip closing on master: " << m_file_name;
+        return true;
+    }
+    request.set_sequence_id(NextSequenceId());
     request.set_file_name(m_file_name);
     request.set_tail_slice(m_cur_slice_no);
     request.set_tail_num(m_cur_rsblock_no);
     request.set_crash_slice(m_max_crash_slice_no);
     request.set_crash_num(m_max_crash_block_num);
+    if (m_file_mode == "w") {
+        // fails if master sealed or removed the file meanwhile
+        request.set_fid(m_file_id);
+    }
 
-    if (!m_master_client->CloseFile(&request, &response)
-        || response.status() != kMasterOk) {
+    bool is_ok = m_master_client->CloseFile(&request, &response);
+    if (m_file_mode == "w") {
+        GetWriteLeaseKeeper()->Remove(m_file_id);
+    }
+    if (!is_ok || response.status() != kMasterOk) {
         LOG(ERROR) << "rpc fail to close file: " << m_file_name
             << ", err: " << StatusCodeToString(response.status());
         err->SetFailed(ErrorCode::kSystem, "rpc fail to close file");
@@ -136,14 +320,21 @@ bool RsfsSDK::Close(ErrorCode* err) {
 
 bool RsfsSDK::ListImpl(const std::string& start, const std::string& end,
                        std::string* last_one, std::vector<TreeNode>* list,
-                       ErrorCode* err) {
+                       ErrorCode* err, ListMode mode) {
     ListFileRequest request;
     ListFileResponse response;
 
-    request.set_sequence_id(++m_last_sequence_id);
+    request.set_sequence_id(NextSequenceId());
     request.set_path_start(start);
     request.set_path_end(end);
     request.set_limit(FLAGS_rsfs_sdk_rpc_list_size_limit * 1024);
+    if (mode == kListName) {
+        request.set_projection(ListFileRequest::NAME);
+    } else if (mode == kListSummary) {
+        request.set_projection(ListFileRequest::SUMMARY);
+    } else {
+        request.set_projection(ListFileRequest::FULL);
+    }
 
     if (!m_master_client->ListFile(&request, &response)
         || response.status() != kMasterOk) {
@@ -156,6 +347,10 @@ bool RsfsSDK::ListImpl(const std::string& start, const std::string& end,
     for (int32_t i = 0; i < response.metas_size(); ++i) {
         list->push_back(response.metas(i));
     }
+    for (int32_t i = 0; i < response.names_size(); ++i) {
+        list->push_back(TreeNode());
+        list->back().set_name(response.names(i));
+    }
     if (response.last_one() == "" || response.last_one() >= end) {
         *last_one = end;
     } else {
@@ -164,6 +359,103 @@ bool RsfsSDK::ListImpl(const std::string& start, const std::string& end,
     return true;
 }
 
+bool RsfsSDK::StatImpl(const std::vector<std::string>& paths,
+                       std::vector<FileStat>* stats, ErrorCode* err) {
+    uint32_t batch_num = FLAGS_rsfs_sdk_stat_batch_num;
+    for (uint32_t start = 0; start < paths.size(); start += batch_num) {
+        StatFileRequest request;
+        StatFileResponse response;
+        request.set_sequence_id(NextSequenceId());
+        uint32_t end = std::min<uint32_t>(start + batch_num, paths.size());
+        for (uint32_t i = start; i < end; ++i) {
+            request.add_file_names(paths[i]);
+        }
+
+        int64_t request_time = utils::GetMillis();
+        if (!m_master_client->StatFile(&request, &response)
+            || response.status() != kMasterOk
+            || response.stats_size() != request.file_names_size()) {
+            LOG(ERROR) << "rpc fail to stat " << request.file_names_size()
+                << " files, err: " << StatusCodeToString(response.status());
+            err->SetFailed(ErrorCode::kSystem, "rpc fail to stat file");
+            return false;
+        }
+        for (int32_t i = 0; i < response.stats_size(); ++i) {
+            const FileStat& stat = response.stats(i);
+            stats->push_back(stat);
+            if (stat.status() != kMasterOk || stat.lease_period() == 0) {
+                continue;
+            }
+            // let the following open of these files skip master
+            OpenFileResponse open_response;
+            open_response.set_sequence_id(request.sequence_id());
+            open_response.set_status(kMasterOk);
+            open_response.set_fid(stat.fid());
+            open_response.mutable_nodes()->CopyFrom(stat.nodes());
+            open_response.set_file_size(stat.file_size());
+            open_response.set_tail_slice(stat.tail_slice());
+            open_response.set_tail_num(stat.tail_num());
+            open_response.set_tail_copy_num(stat.tail_copy_num());
+            open_response.set_crash_slice(stat.crash_slice());
+            open_response.set_crash_num(stat.crash_num());
+            open_response.set_lease_period(stat.lease_period());
+            GetMetaLeaseCache()->Insert(stat.file_name(), open_response,
+                                        request_time + stat.lease_period());
+        }
+    }
+    return true;
+}
+
+bool RsfsSDK::SplitImpl(const std::string& start, const std::string& end,
+                        uint32_t split_num, std::vector<std::string>* split_keys,
+                        ErrorCode* err) {
+    SplitRangeRequest request;
+    SplitRangeResponse response;
+
+    request.set_sequence_id(NextSequenceId());
+    request.set_path_start(start);
+    request.set_path_end(end);
+    request.set_split_num(split_num);
+
+    if (!m_master_client->SplitRange(&request, &response)
+        || response.status() != kMasterOk) {
+        LOG(ERROR) << "rpc fail to split range: [" << start
+            << ", " << end << "], err: " << StatusCodeToString(response.status());
+        err->SetFailed(ErrorCode::kSystem, "rpc fail to split range");
+        return false;
+    }
+    for (int32_t i = 0; i < response.split_keys_size(); ++i) {
+        split_keys->push_back(response.split_keys(i));
+    }
+    return true;
+}
+
+bool RsfsSDK::RemoveImpl(const std::string& file_path, ErrorCode* err) {
+    RemoveFileRequest request;
+    RemoveFileResponse response;
+
+    request.set_sequence_id(NextSequenceId());
+    request.set_file_name(file_path);
+    // the local lease is useless once meta is gone, even on failure
+    GetMetaLeaseCache()->Invalidate(file_path);
+
+    if (!m_master_client->RemoveFile(&request, &response)) {
+        LOG(ERROR) << "rpc fail to remove file: " << file_path;
+        err->SetFailed(ErrorCode::kSystem, "rpc fail to remove file");
+        return false;
+    }
+    if (response.status() == kKeyNotExist) {
+        err->SetFailed(ErrorCode::kNotFound, "file not exist");
+        return false;
+    } else if (response.status() != kMasterOk) {
+        LOG(ERROR) << "fail to remove file: " << file_path
+            << ", err: " << StatusCodeToString(response.status());
+        err->SetFailed(ErrorCode::kSystem, "fail to remove file");
+        return false;
+    }
+    return true;
+}
+
 int64_t RsfsSDK::GetSize(ErrorCode* err) {
     return m_file_size;
 }
@@ -219,52 +511,91 @@ int64_t RsfsSDK::Read(void* buf, uint32_t buf_size, ErrorCode* err) {
 #endif
 int64_t RsfsSDK::Read(void* buf, uint32_t buf_size, int64_t offset,
                       ErrorCode* err) {
-    uint32_t slice_start_block = 0;
+    return ReadAt(buf, buf_size, offset, false, err);
+}
+
+int64_t RsfsSDK::ReadAt(void* buf, uint32_t buf_size, int64_t offset,
+                        bool is_sequential, ErrorCode* err) {
+    if (offset == m_file_size) {
+        return 0;
+    }
+    uint32_t slice_no = 0;
     uint64_t offset_in_slice = 0;
-    if (!GetSliceLocation(offset, &slice_start_block, &offset_in_slice)) {
+    if (!GetSliceLocation(offset, &slice_no, &offset_in_slice)) {
+        err->SetFailed(ErrorCode::kBadParam, "read out of file range");
         return -1;
     }
     uint32_t slice_length = FLAGS_rsfs_sdk_rscode_block_size * m_rscode->GetM();
-    uint32_t remain_size = m_file_size - offset;
+    int64_t remain_size = m_file_size -
+        (static_cast<int64_t>(slice_no) * slice_length + offset_in_slice);
     if (remain_size > buf_size) {
         remain_size = buf_size;
     }
+
+    ReadContext* context = m_read_contexts->Get();
+    context->deadline = GetOperationDeadline();
+    char* read_buf = static_cast<char*>(buf);
     while (remain_size > 0) {
-//         if (m_cur_slice_no != slice_start_block
-//             && ParallelLoadSlice(0)) {
-//             m_cur_slice_no = slice_start_block;
-//         }
-        if (m_cur_slice_no != slice_start_block) {
-            bool load = false;
-            if (slice_start_block == m_tail_slice_no) {
-                load = ParallelLoadTailBlock(0);
-            } else {
-                load = ParallelLoadSlice(0);
-            }
-            if (!load) {
-                LOG(INFO) << "fail to para-load slice #" << slice_start_block;
+        if (context->slice_no != slice_no) {
+            if (!LoadSlice(context, slice_no, is_sequential)) {
+                LOG(INFO) << "fail to para-load slice #" << slice_no;
+                context->slice_no = -1;
                 break;
             }
-            m_cur_slice_no = slice_start_block;
+            context->slice_no = slice_no;
+        }
+        uint32_t read_count = slice_length - offset_in_slice;
+        if (read_count > remain_size) {
+            read_count = remain_size;
         }
-        uint32_t read_count =
-            (remain_size > (slice_length - offset_in_slice))?
-            (slice_length - offset_in_slice):remain_size;
-        memcpy(buf, m_last_block_buffer.get() + offset_in_slice, read_count);
+        memcpy(read_buf, context->slice_buffer.get() + offset_in_slice, read_count);
+        read_buf += read_count;
         remain_size -= read_count;
+        offset_in_slice = 0;
+        slice_no++;
     }
+    m_read_contexts->Put(context);
 
-    return buf_size - remain_size;
+    int64_t read_size = read_buf - static_cast<char*>(buf);
+    if (read_size == 0 && remain_size > 0) {
+        err->SetFailed(ErrorCode::kSystem, "fail to load slice");
+        return -1;
+    }
+    return read_size;
+}
+
+bool RsfsSDK::LoadSlice(ReadContext* context, uint32_t slice_no,
+                        bool is_sequential) {
+    if (slice_no == m_tail_slice_no) {
+        return ParallelLoadTail(context, slice_no);
+    }
+    if (is_sequential && FLAGS_rsfs_sdk_scan_enabled && !m_is_scan_disabled) {
+        // stream the sequential read, read the blocks if it fails
+        if (ScanLoadSlice(context, slice_no)) {
+            return true;
+        }
+    }
+    return ParallelLoadSlice(context, slice_no);
 }
 
 int64_t RsfsSDK::Write(void* buf, uint32_t buf_size, ErrorCode* err) {
-    AutoResetEvent done_event;
-    int64_t write_count = 0;
+    return WriteWithDeadline(buf, buf_size, GetOperationDeadline(), err);
+}
 
-    WriteDataRequest* request = new WriteDataRequest;
-    WriteDataResponse* response = new WriteDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, m_cur_node_no));
+int64_t RsfsSDK::WriteWithDeadline(void* buf, uint32_t buf_size, int64_t deadline,
+                                   ErrorCode* err) {
+    if (GetWriteLeaseKeeper()->IsLost(m_file_id)) {
+        LOG(ERROR) << "write lease lost, file: " << m_file_name;
+        err->SetFailed(ErrorCode::kSystem, "write lease lost");
+        return -1;
+    }
+    BlockIoContext context(err, deadline);
+
+    WriteDataRequest* request = NewMessage<WriteDataRequest>();
+    WriteDataResponse* response = NewMessage<WriteDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, m_cur_node_no));
 
     uint32_t send_size = m_remain_block_size;
     if (send_size > buf_size) {
@@ -275,94 +606,82 @@ int64_t RsfsSDK::Write(void* buf, uint32_t buf_size, ErrorCode* err) {
 
     Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::WriteCallback,
-                   buf + send_size, buf_size - send_size, &done_event,
-                   &write_count, err, FLAGS_rsfs_sdk_write_retry_times);
+                   buf + send_size, buf_size - send_size, &context,
+                   FLAGS_rsfs_sdk_write_retry_times);
 
-    snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
+    snode::SNodeClientAsync node_client(m_node_endpoints[m_cur_node_no]);
     node_client.WriteData(request, response, done);
-    done_event.Wait();
+    context.done_event.Wait();
 
-    return write_count;
+    return context.count;
 }
 
 void RsfsSDK::ReadCallback(void* buf, uint32_t buf_size,
-                           AutoResetEvent* done_event, int64_t* read_count,
-                           ErrorCode* err, int32_t retry,
+                           BlockIoContext* context, int32_t retry,
                            ReadDataRequest* request, ReadDataResponse* response,
                            bool failed, int error_code) {
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to read data, rpc status: "
             << StatusCodeToString(response->status());
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, context->deadline)) {
             LOG(ERROR) << "fail to read data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
-            err->SetFailed(ErrorCode::kSystem, "rpc fail to read data");
-            done_event->Set();
-            *read_count = -1;
+            RecycleMessage(request);
+            RecycleMessage(response);
+            context->err->SetFailed(ErrorCode::kSystem, "rpc fail to read data");
+            context->count = -1;
+            context->done_event.Set();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_read_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::ReadCallback,
-                           buf, buf_size, done_event, read_count, err,
-                           retry - 1);
-
-            snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
-            node_client.ReadData(request, response, done);
+                           buf, buf_size, context, retry - 1);
+            ScheduleResend(m_node_endpoints[m_cur_node_no],
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, context->deadline);
         }
         return;
     }
 }
 
 void RsfsSDK::WriteCallback(void* buf, uint32_t buf_size,
-                            AutoResetEvent* done_event, int64_t* write_count,
-                            ErrorCode* err, int32_t retry,
+                            BlockIoContext* context, int32_t retry,
                             WriteDataRequest* request, WriteDataResponse* response,
                             bool failed, int error_code) {
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to write data, rpc status: "
             << StatusCodeToString(response->status());
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, context->deadline)) {
             LOG(ERROR) << "fail to write data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
-            err->SetFailed(ErrorCode::kSystem, "rpc fail to write data");
-            done_event->Set();
-            *write_count = -1;
+            RecycleMessage(request);
+            RecycleMessage(response);
+            context->err->SetFailed(ErrorCode::kSystem, "rpc fail to write data");
+            context->count = -1;
+            context->done_event.Set();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_write_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::WriteCallback,
-                           buf, buf_size, done_event, write_count, err,
-                           retry - 1);
-
-            snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
-            node_client.WriteData(request, response, done);
+                           buf, buf_size, context, retry - 1);
+            ScheduleResend(m_node_endpoints[m_cur_node_no],
+                           FLAGS_rsfs_sdk_write_retry_times - retry,
+                           request, response, done, context->deadline);
         }
         return;
     }
-    LOG(INFO) << "rs block #" << m_cur_rsblock_no
+    VLOG(10) << "rs block #" << m_cur_rsblock_no
         << ", md5: " << utils::GetMd5(request->payload().data(), request->payload().size());
     int64_t payload_size = request->payload().size();
     if (m_cur_rsblock_no < m_rscode->GetM()) {
         // only for data block
-        *write_count += payload_size;
+        context->count += payload_size;
         m_file_size += payload_size;
     }
     m_remain_block_size -= payload_size;
 
     if (m_remain_block_size > 0) {
-        done_event->Set();
-        delete request;
-        delete response;
+        RecycleMessage(request);
+        RecycleMessage(response);
+        context->done_event.Set();
         return;
     }
 
@@ -395,24 +714,50 @@ void RsfsSDK::WriteCallback(void* buf, uint32_t buf_size,
         request->set_payload(buf, send_size);
     } else {
         VLOG(5) << "send data success";
-        delete request;
-        delete response;
-        done_event->Set();
+        RecycleMessage(request);
+        RecycleMessage(response);
+        context->done_event.Set();
         return;
     }
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, m_cur_node_no));
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(context->deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, m_cur_node_no));
 
     Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::WriteCallback,
-                   buf + send_size, buf_size - send_size, done_event,
-                   write_count, err, FLAGS_rsfs_sdk_write_retry_times);
+                   buf + send_size, buf_size - send_size, context,
+                   FLAGS_rsfs_sdk_write_retry_times);
 
-    snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
+    snode::SNodeClientAsync node_client(m_node_endpoints[m_cur_node_no]);
     node_client.WriteData(request, response, done);
 }
 
-bool RsfsSDK::RpcChannelHealth(int32_t err_code) {
+uint64_t RsfsSDK::NextSequenceId() {
+    return atomic_inc_ret_old64(&m_last_sequence_id) + 1;
+}
+
+int64_t RsfsSDK::GetOperationDeadline() {
+    if (FLAGS_rsfs_sdk_io_timeout > 0) {
+        return utils::GetMillis() + FLAGS_rsfs_sdk_io_timeout;
+    }
+    return 0;
+}
+
+int64_t RsfsSDK::GetRpcTimeout(int64_t deadline) {
+    if (deadline <= 0) {
+        return FLAGS_rsfs_snode_rpc_timeout_period;
+    }
+    int64_t remain_time = deadline - utils::GetMillis();
+    return std::max<int64_t>(1, std::min<int64_t>(remain_time,
+                             FLAGS_rsfs_snode_rpc_timeout_period));
+}
+
+bool RsfsSDK::RpcChannelHealth(int32_t err_code, int64_t deadline) {
+    // no retry for the operation given up, nobody waits for it
+    if (err_code == sofa::pbrpc::RPC_ERROR_REQUEST_CANCELED
+        || (deadline > 0 && utils::GetMillis() >= deadline)) {
+        return false;
+    }
     return err_code != sofa::pbrpc::RPC_ERROR_CONNECTION_CLOSED
         && err_code != sofa::pbrpc::RPC_ERROR_SERVER_SHUTDOWN
         && err_code != sofa::pbrpc::RPC_ERROR_SERVER_UNREACHABLE
@@ -421,30 +766,119 @@ bool RsfsSDK::RpcChannelHealth(int32_t err_code) {
 
 bool RsfsSDK::GetSliceLocation(int64_t offset, uint32_t* slice_start_block,
                                uint64_t* offset_in_slice) {
-    if (offset >= m_file_size) {
+    if (offset >= m_file_size || offset < -m_file_size) {
         LOG(ERROR) << "invalid file offset: " << offset
             << "[file size: " << m_file_size << "]";
         return false;
     }
     uint32_t slice_length = FLAGS_rsfs_sdk_rscode_block_size * m_rscode->GetM();
+    // a negative offset counts from the end of file
     int64_t file_offset = offset;
     if (offset < 0) {
-        file_offset = m_file_size - offset;
+        file_offset = m_file_size + offset;
     }
     *slice_start_block = file_offset / slice_length;
     *offset_in_slice = file_offset % slice_length;
     return true;
 }
 
-bool RsfsSDK::PallelOpenDataFile() {
+uint64_t RsfsSDK::GetBlockSeqNo(uint32_t slice_no, uint32_t block_no) {
+    return static_cast<uint64_t>(slice_no) * m_rscode->GetMK() + block_no;
+}
+
+uint32_t RsfsSDK::GetBlockNode(uint64_t seq_no) {
+    return seq_no % m_node_list.size();
+}
+
+uint64_t RsfsSDK::GetBlockOffset(uint64_t seq_no) {
+    return seq_no / m_node_list.size() * FLAGS_rsfs_sdk_rscode_block_size;
+}
+
+bool RsfsSDK::ScanLoadSlice(ReadContext* context, uint32_t slice_no) {
+    if (m_scan_streams.empty() || m_scan_slice_no != slice_no) {
+        CloseScans();
+        OpenScans(slice_no, context->deadline);
+    }
+    // a scan delivers the blocks of its node in write order, the parity
+    // ones are taken as well to keep it at the next slice
+    std::string chunk;
+    for (int32_t i = 0; i < m_rscode->GetMK(); ++i) {
+        ScanStream* stream = m_scan_streams[GetBlockNode(GetBlockSeqNo(slice_no, i))];
+        if (stream == NULL && i >= m_rscode->GetM()) {
+            continue;
+        }
+        if (stream == NULL
+            || !stream->Next(&chunk, GetRpcTimeout(context->deadline))
+            || chunk.size() != static_cast<uint32_t>(FLAGS_rsfs_sdk_rscode_block_size)) {
+            // a lost block needs the parity ones, leave it to block read
+            LOG(WARNING) << "fail to scan block #" << i << " of slice #"
+                << slice_no << ", turn to block read";
+            CloseScans();
+            m_is_scan_disabled = true;
+            return false;
+        }
+        if (i < m_rscode->GetM()) {
+            memcpy(context->slice_buffer.get() + FLAGS_rsfs_sdk_rscode_block_size * i,
+                   chunk.data(), chunk.size());
+        }
+    }
+    m_scan_slice_no = slice_no + 1;
+    return true;
+}
+
+void RsfsSDK::OpenScans(uint32_t slice_no, int64_t deadline) {
+    uint32_t node_num = m_node_list.size();
+    // the node pattern of blocks repeats within node_num slices, the
+    // nodes holding parity blocks only are not scanned
+    std::vector<bool> has_data(node_num, false);
+    for (uint32_t i = 0; i < node_num; ++i) {
+        for (int32_t j = 0; j < m_rscode->GetM(); ++j) {
+            has_data[GetBlockNode(GetBlockSeqNo(slice_no + i, j))] = true;
+        }
+    }
+    // the tail slice is not in the scans
+    uint64_t start_seq_no = GetBlockSeqNo(slice_no, 0);
+    uint64_t end_seq_no = start_seq_no;
+    if (m_tail_slice_no > slice_no) {
+        end_seq_no = GetBlockSeqNo(m_tail_slice_no, 0);
+    }
+    m_scan_streams.assign(node_num, NULL);
+    uint32_t scan_num = 0;
+    for (uint32_t node_no = 0; node_no < node_num; ++node_no) {
+        // the blocks of node in [start_seq_no, end_seq_no)
+        uint64_t start_no = (start_seq_no + node_num - 1 - node_no) / node_num;
+        uint64_t end_no = (end_seq_no + node_num - 1 - node_no) / node_num;
+        if (!has_data[node_no] || end_no <= start_no) {
+            continue;
+        }
+        ScanStream* stream = new ScanStream(m_node_endpoints[node_no],
+                                            utils::BlockFileName(m_file_id, node_no),
+                                            FLAGS_rsfs_sdk_rscode_block_size,
+                                            FLAGS_rsfs_sdk_scan_window_num);
+        stream->Open(start_no * FLAGS_rsfs_sdk_rscode_block_size,
+                     (end_no - start_no) * FLAGS_rsfs_sdk_rscode_block_size,
+                     GetRpcTimeout(deadline));
+        m_scan_streams[node_no] = stream;
+        scan_num++;
+    }
+    m_scan_slice_no = slice_no;
+    LOG(INFO) << "open " << scan_num << " scans from slice #" << slice_no;
+}
+
+void RsfsSDK::CloseScans() {
+    for (uint32_t i = 0; i < m_scan_streams.size(); ++i) {
+        delete m_scan_streams[i];
+    }
+    m_scan_streams.clear();
+    m_scan_slice_no = -1;
+}
+
+bool RsfsSDK::PallelOpenDataFile(int64_t deadline) {
     AutoResetEvent done_event;
     scoped_ptr<utils::IntMap> open_status(new utils::IntMap(m_node_list.size(), -1));
     for (uint32_t i = 0; i < m_node_list.size(); ++i) {
-        Closure<void>* callback =
-            NewClosure(this, &RsfsSDK::OpenDataFile,
-                       m_node_list.Get(i).addr(), i, open_status.get(),
-                       &done_event);
-        m_thread_pool.AddTask(callback);
+        OpenDataFile(m_node_endpoints[i], i, open_status.get(),
+                     &done_event, deadline);
     }
     uint32_t wait_retry = 0;
     while (open_status->GetSetNum() < m_node_list.size()
@@ -460,13 +894,16 @@ bool RsfsSDK::PallelOpenDataFile() {
     return open_status->GetSetNum() == m_node_list.size();
 }
 
-void RsfsSDK::OpenDataFile(std::string addr, uint32_t block_no,
-                           utils::IntMap* open_status, AutoResetEvent* done_event) {
-    LOG(INFO) << "open block #" << block_no << " on node (" << addr << ")";
-    OpenDataRequest* request = new OpenDataRequest;
-    OpenDataResponse* response = new OpenDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, block_no));
+void RsfsSDK::OpenDataFile(RpcEndpoint* endpoint, uint32_t block_no,
+                           utils::IntMap* open_status, AutoResetEvent* done_event,
+                           int64_t deadline) {
+    LOG(INFO) << "open block #" << block_no
+        << " on node (" << endpoint->GetAddr() << ")";
+    OpenDataRequest* request = NewMessage<OpenDataRequest>();
+    OpenDataResponse* response = NewMessage<OpenDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, block_no));
 
     if (m_file_mode == "w") {
         request->set_mode(OpenDataRequest::APPEND);
@@ -475,60 +912,54 @@ void RsfsSDK::OpenDataFile(std::string addr, uint32_t block_no,
     }
     Closure<void, OpenDataRequest*, OpenDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::OpenDataFileCallback,
-                   addr, block_no, open_status, done_event,
+                   endpoint, block_no, open_status, done_event, deadline,
                    FLAGS_rsfs_sdk_read_retry_times);
 
-    snode::SNodeClientAsync node_client(addr);
+    snode::SNodeClientAsync node_client(endpoint);
     node_client.OpenData(request, response, done);
 }
 
-void RsfsSDK::OpenDataFileCallback(std::string addr, uint32_t block_no, utils::IntMap* open_status,
-                                   AutoResetEvent* done_event, int32_t retry,
+void RsfsSDK::OpenDataFileCallback(RpcEndpoint* endpoint, uint32_t block_no, utils::IntMap* open_status,
+                                   AutoResetEvent* done_event, int64_t deadline,
+                                   int32_t retry,
                                    OpenDataRequest* request, OpenDataResponse* response,
                                    bool failed, int error_code) {
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to open data, rpc status: "
             << StatusCodeToString(response->status());
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, deadline)) {
             LOG(ERROR) << "fail to open data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
+            RecycleMessage(request);
+            RecycleMessage(response);
             open_status->Set(block_no, 0);
             done_event->Set();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_read_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, OpenDataRequest*, OpenDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::OpenDataFileCallback,
-                           addr, block_no, open_status, done_event,
+                           endpoint, block_no, open_status, done_event, deadline,
                            retry - 1);
-
-            snode::SNodeClientAsync node_client(addr);
-            node_client.OpenData(request, response, done);
+            ScheduleResend(endpoint,
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, deadline);
         }
         return;
     }
 
-    delete request;
-    delete response;
+    RecycleMessage(request);
+    RecycleMessage(response);
 
     open_status->Set(block_no, 1);
     done_event->Set();
     LOG(INFO) << "open success, block #" << block_no;
 }
 
-bool RsfsSDK::PallelCloseDataFile() {
+bool RsfsSDK::PallelCloseDataFile(int64_t deadline) {
     AutoResetEvent done_event;
     scoped_ptr<utils::IntMap> close_status(new utils::IntMap(m_node_list.size(), -1));
     for (uint32_t i = 0; i < m_node_list.size(); ++i) {
-        Closure<void>* callback =
-            NewClosure(this, &RsfsSDK::CloseDataFile,
-                       m_node_list.Get(i).addr(), i, close_status.get(),
-                       &done_event);
-        m_thread_pool.AddTask(callback);
+        CloseDataFile(m_node_endpoints[i], i, close_status.get(),
+                      &done_event, deadline);
     }
     uint32_t wait_retry = 0;
     while (close_status->GetSetNum() < m_node_list.size()
@@ -544,76 +975,92 @@ bool RsfsSDK::PallelCloseDataFile() {
     return close_status->GetSetNum() == m_node_list.size();
 }
 
-void RsfsSDK::CloseDataFile(std::string addr, uint32_t block_no,
-                            utils::IntMap* close_status, AutoResetEvent* done_event) {
-    CloseDataRequest* request = new CloseDataRequest;
-    CloseDataResponse* response = new CloseDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, block_no));
+void RsfsSDK::CloseDataFile(RpcEndpoint* endpoint, uint32_t block_no,
+                            utils::IntMap* close_status, AutoResetEvent* done_event,
+                            int64_t deadline) {
+    CloseDataRequest* request = NewMessage<CloseDataRequest>();
+    CloseDataResponse* response = NewMessage<CloseDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, block_no));
 
     Closure<void, CloseDataRequest*, CloseDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::CloseDataFileCallback,
-                   addr, block_no, close_status, done_event,
+                   endpoint, block_no, close_status, done_event, deadline,
                    FLAGS_rsfs_sdk_read_retry_times);
 
-    snode::SNodeClientAsync node_client(addr);
+    snode::SNodeClientAsync node_client(endpoint);
     node_client.CloseData(request, response, done);
 }
 
-void RsfsSDK::CloseDataFileCallback(std::string addr, uint32_t block_no, utils::IntMap* close_status,
-                                    AutoResetEvent* done_event, int32_t retry,
+void RsfsSDK::CloseDataFileCallback(RpcEndpoint* endpoint, uint32_t block_no, utils::IntMap* close_status,
+                                    AutoResetEvent* done_event, int64_t deadline,
+                                    int32_t retry,
                                     CloseDataRequest* request, CloseDataResponse* response,
                                     bool failed, int error_code) {
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to close data, rpc status: "
             << StatusCodeToString(response->status());
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, deadline)) {
             LOG(ERROR) << "fail to close data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
+            RecycleMessage(request);
+            RecycleMessage(response);
             close_status->Set(block_no, 0);
             done_event->Set();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_read_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, CloseDataRequest*, CloseDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::CloseDataFileCallback,
-                           addr, block_no, close_status, done_event,
+                           endpoint, block_no, close_status, done_event, deadline,
                            retry - 1);
-
-            snode::SNodeClientAsync node_client(addr);
-            node_client.CloseData(request, response, done);
+            ScheduleResend(endpoint,
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, deadline);
         }
         return;
     }
 
-    delete request;
-    delete response;
+    RecycleMessage(request);
+    RecycleMessage(response);
 
     close_status->Set(block_no, 1);
     done_event->Set();
     LOG(INFO) << "close success, block #" << block_no;
 }
 
-bool RsfsSDK::ParallelLoadSlice(uint32_t slice_no) {
-    m_rscode->CleanCache();
-    m_rscode->CleanBlock();
-    AutoResetEvent wait_event;
-    scoped_ptr<utils::IntMap> load_status(new utils::IntMap(m_rscode->GetMK(), -1));
-    for (uint32_t i = 0; i < m_rscode->GetMK(); ++i) {
-        uint32_t load_node_no = i % m_node_list.size();
-        Closure<void>* callback =
-            NewClosure(this, &RsfsSDK::LoadSliceBlock,
-                       load_node_no, i, load_status.get(), &wait_event);
-        m_thread_pool.AddTask(callback);
+bool RsfsSDK::ParallelLoadSlice(ReadContext* read_context, uint32_t slice_no) {
+    rscode::RSCode* rscode = read_context->rscode.get();
+    rscode->CleanCache();
+    rscode->CleanBlock();
+    uint32_t block_num = rscode->GetMK();
+    uint32_t data_block_num = rscode->GetM();
+    // the blocks on one node are read in one batch
+    std::vector<std::vector<uint32_t> > node_blocks(m_node_list.size());
+    uint32_t call_num = 0;
+    for (uint32_t i = 0; i < block_num; ++i) {
+        std::vector<uint32_t>& block_nos =
+            node_blocks[GetBlockNode(GetBlockSeqNo(slice_no, i))];
+        if (block_nos.empty()) {
+            call_num++;
+        }
+        block_nos.push_back(i);
     }
+    SliceLoadContext* context = new SliceLoadContext(block_num, call_num + 1,
+                                                     read_context, slice_no);
+    utils::IntMap* load_status = &context->load_status;
+    for (uint32_t node_no = 0; node_no < node_blocks.size(); ++node_no) {
+        if (node_blocks[node_no].size() == 1) {
+            LoadSliceBlock(node_no, node_blocks[node_no][0], context);
+        } else if (node_blocks[node_no].size() > 1) {
+            LoadSliceBlocks(node_no, node_blocks[node_no], context);
+        }
+    }
+    // any m blocks are enough to decode the slice
     uint32_t wait_retry = 0;
-    while (load_status->GetSetNum() < m_rscode->GetMK()
+    while (load_status->Sum(1) < data_block_num
+           && load_status->GetSetNum() < block_num
            && wait_retry < 100) {
-        if (!wait_event.Wait(500)) {
+        if (!context->done_event.Wait(500)) {
             wait_retry++;
         } else {
             wait_retry = 0;
@@ -621,87 +1068,107 @@ bool RsfsSDK::ParallelLoadSlice(uint32_t slice_no) {
         LOG(INFO) << "retry_count: " << wait_retry;
     }
 
-    if (load_status->Sum(0) > m_max_crash_block_num) {
-        m_max_crash_block_num = load_status->Sum(0);
-        m_max_crash_slice_no = slice_no;
+    // count before cancel, the reads cancelled are not crashed
+    uint32_t crash_num = load_status->Sum(0);
+    // give up the reads left, no block is added after this
+    context->cancel_token.Cancel();
+    std::vector<bool> is_loaded(block_num, false);
+    uint32_t loaded_num = 0;
+    bool is_data_loaded = true;
+    for (uint32_t no = 0; no < block_num; ++no) {
+        is_loaded[no] = load_status->IsSet(no, 1);
+        if (is_loaded[no]) {
+            loaded_num++;
+        } else if (no < data_block_num) {
+            is_data_loaded = false;
+        }
+    }
+    context->DecRef();
+
+    {
+        MutexLocker lock(m_crash_mutex);
+        if (crash_num > m_max_crash_block_num) {
+            m_max_crash_block_num = crash_num;
+            m_max_crash_slice_no = slice_no;
+        }
     }
-    if (load_status->Sum(1) == m_rscode->GetMK()) {
-        // success
+    if (is_data_loaded) {
+        // success, the parity blocks are not read by caller
         return true;
-    } else if (load_status->Sum(0) > m_rscode->GetK()) {
-        LOG(ERROR) << "the number of crashed block: " << load_status->Sum(0)
-            << ", beyond: " << m_rscode->GetK();
+    } else if (loaded_num < data_block_num) {
+        LOG(ERROR) << "the number of loaded block: " << loaded_num
+            << ", below: " << data_block_num;
         return false;
     }
     // recove the crash block in slice
-    CHECK(m_rscode->RecoverLostBlock());
-    CHECK(m_rscode->CreateParityBlock());
+    CHECK(rscode->RecoverLostBlock());
+    CHECK(rscode->CreateParityBlock());
     int32_t success_count = 0;
-    for (int32_t no = 0; no < m_rscode->GetMK(); ++no) {
-        if (load_status->IsSet(no, 1)) {
+    for (int32_t no = 0; no < rscode->GetMK(); ++no) {
+        if (is_loaded[no]) {
             success_count++;
             continue;
         }
-        char* block_addr = m_last_block_buffer.get() +
+        char* block_addr = read_context->slice_buffer.get() +
             FLAGS_rsfs_sdk_rscode_block_size * no;
-        CHECK(m_rscode->GetBlock(no, block_addr))
+        CHECK(rscode->GetBlock(no, block_addr))
             << ", fail to recover missing slice block #" << no;
-        load_status->Set(no, 1);
         success_count++;
-        LOG(INFO) << "recover block #" << no << ", md5: "
+        VLOG(10) << "recover block #" << no << ", md5: "
             << utils::GetMd5(block_addr, FLAGS_rsfs_sdk_rscode_block_size);
     }
-    return success_count == m_rscode->GetMK();
+    return success_count == rscode->GetMK();
 }
 
 void RsfsSDK::LoadSliceBlock(uint32_t node_no, uint32_t block_no,
-                             utils::IntMap* load_status, AutoResetEvent* done_event) {
-    ReadDataRequest* request = new ReadDataRequest;
-    ReadDataResponse* response = new ReadDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, block_no));
+                             SliceLoadContext* context) {
+    ReadDataRequest* request = NewMessage<ReadDataRequest>();
+    ReadDataResponse* response = NewMessage<ReadDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(context->deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, node_no));
     request->set_type(ReadDataRequest::RANDOM_READ);
+    request->set_offset(GetBlockOffset(GetBlockSeqNo(context->slice_no, block_no)));
     request->set_payload_size(FLAGS_rsfs_sdk_rscode_block_size);
 
     Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::LoadBlockCallback,
-                   node_no, block_no, load_status, done_event,
+                   node_no, block_no, context,
                    FLAGS_rsfs_sdk_read_retry_times);
 
-    snode::SNodeClientAsync node_client(m_node_list.Get(node_no).addr());
+    snode::SNodeClientAsync node_client(m_node_endpoints[node_no]);
+    node_client.SetCancelToken(&context->cancel_token);
     node_client.ReadData(request, response, done);
     LOG(INFO) << "try load block #" << block_no
         << " from node #" << node_no << " (" << node_client.GetConnectAddr() << ")";
 }
 
 void RsfsSDK::LoadBlockCallback(uint32_t node_no, uint32_t block_no,
-                                utils::IntMap* load_status,
-                                AutoResetEvent* done_event, int32_t retry,
+                                SliceLoadContext* context, int32_t retry,
                                 ReadDataRequest* request, ReadDataResponse* response,
                                 bool failed, int error_code) {
+    RpcCancelToken* cancel_token = &context->cancel_token;
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to read data, rpc status: "
             << StatusCodeToString(response->status())
             << " [node #" << node_no << ", block #" << block_no << "]";
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, context->deadline)
+            || cancel_token->IsCancelled()) {
             LOG(ERROR) << "fail to read data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
-            load_status->Set(block_no, 0);
-            done_event->Set();
+            RecycleMessage(request);
+            RecycleMessage(response);
+            context->load_status.Set(block_no, 0);
+            context->done_event.Set();
+            context->DecRef();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_read_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::LoadBlockCallback,
-                           node_no, block_no, load_status, done_event,
-                           retry - 1);
-
-            snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
-            node_client.ReadData(request, response, done);
+                           node_no, block_no, context, retry - 1);
+            ScheduleResend(m_node_endpoints[node_no],
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, context->deadline,
+                           cancel_token);
         }
         return;
     }
@@ -709,29 +1176,123 @@ void RsfsSDK::LoadBlockCallback(uint32_t node_no, uint32_t block_no,
     LOG(INFO) << "rpc read success. block #" << block_no << " from node #" << node_no
         << ", payload size: " << response->payload().size();
 
-    uint32_t block_offset = FLAGS_rsfs_sdk_rscode_block_size * block_no;
-    memcpy(m_last_block_buffer.get() + block_offset,
-           response->payload().data(),
-           response->payload().size());
+    {
+        // the loader may have moved to next slice, drop the late one
+        MutexLocker lock(cancel_token->GetMutex());
+        if (!cancel_token->IsCancelled()) {
+            ReadContext* read_context = context->read_context;
+            uint32_t block_offset = FLAGS_rsfs_sdk_rscode_block_size * block_no;
+            memcpy(read_context->slice_buffer.get() + block_offset,
+                   response->payload().data(),
+                   response->payload().size());
+            read_context->rscode->AddBlock(block_no, response->payload().data());
+            context->load_status.Set(block_no, 1);
+        }
+    }
+
+    RecycleMessage(request);
+    RecycleMessage(response);
+    context->done_event.Set();
+    context->DecRef();
 
-    m_rscode->AddBlock(block_no, response->payload().data());
+    LOG(INFO) << "load success. block #" << block_no << " from node #" << node_no;
+}
 
-    delete request;
-    delete response;
+void RsfsSDK::LoadSliceBlocks(uint32_t node_no, std::vector<uint32_t> block_nos,
+                              SliceLoadContext* context) {
+    ReadDataBatchRequest* request = NewMessage<ReadDataBatchRequest>();
+    ReadDataBatchResponse* response = NewMessage<ReadDataBatchResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(context->deadline));
+    for (uint32_t i = 0; i < block_nos.size(); ++i) {
+        ReadDataEntry* entry = request->add_entries();
+        entry->set_block_id(utils::BlockFileName(m_file_id, node_no));
+        entry->set_offset(GetBlockOffset(GetBlockSeqNo(context->slice_no, block_nos[i])));
+        entry->set_length(FLAGS_rsfs_sdk_rscode_block_size);
+    }
 
-    load_status->Set(block_no, 1);
-    done_event->Set();
+    Closure<void, ReadDataBatchRequest*, ReadDataBatchResponse*, bool, int>* done =
+        NewClosure(this, &RsfsSDK::LoadBlocksCallback,
+                   node_no, block_nos, context,
+                   FLAGS_rsfs_sdk_read_retry_times);
 
-    LOG(INFO) << "load success. block #" << block_no << " from node #" << node_no;
+    snode::SNodeClientAsync node_client(m_node_endpoints[node_no]);
+    node_client.SetCancelToken(&context->cancel_token);
+    node_client.ReadDataBatch(request, response, done);
+    LOG(INFO) << "try load " << block_nos.size() << " blocks"
+        << " from node #" << node_no << " (" << node_client.GetConnectAddr() << ")";
 }
 
-void RsfsSDK::HandleTailBlocks() {
+void RsfsSDK::LoadBlocksCallback(uint32_t node_no, std::vector<uint32_t> block_nos,
+                                 SliceLoadContext* context, int32_t retry,
+                                 ReadDataBatchRequest* request,
+                                 ReadDataBatchResponse* response,
+                                 bool failed, int error_code) {
+    RpcCancelToken* cancel_token = &context->cancel_token;
+    if (failed || response->status() != kSNodeOk
+        || response->statuses_size() != static_cast<int32_t>(block_nos.size())
+        || response->payloads_size() != static_cast<int32_t>(block_nos.size())) {
+        LOG(WARNING) << "fail to read data batch, rpc status: "
+            << StatusCodeToString(response->status())
+            << " [node #" << node_no << ", block num: " << block_nos.size() << "]";
+        if (retry <= 0 || !RpcChannelHealth(error_code, context->deadline)
+            || cancel_token->IsCancelled()) {
+            RecycleMessage(request);
+            RecycleMessage(response);
+            for (uint32_t i = 0; i < block_nos.size(); ++i) {
+                context->load_status.Set(block_nos[i], 0);
+            }
+            context->done_event.Set();
+            context->DecRef();
+        } else {
+            Closure<void, ReadDataBatchRequest*, ReadDataBatchResponse*, bool, int>* done =
+                NewClosure(this, &RsfsSDK::LoadBlocksCallback,
+                           node_no, block_nos, context, retry - 1);
+            ScheduleResend(m_node_endpoints[node_no],
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, context->deadline,
+                           cancel_token);
+        }
+        return;
+    }
+
+    {
+        MutexLocker lock(cancel_token->GetMutex());
+        for (uint32_t i = 0; i < block_nos.size(); ++i) {
+            uint32_t block_no = block_nos[i];
+            if (response->statuses(i) != kSNodeOk) {
+                LOG(WARNING) << "fail to read block #" << block_no
+                    << " from node #" << node_no << ", status: "
+                    << StatusCodeToString(response->statuses(i));
+                context->load_status.Set(block_no, 0);
+                continue;
+            }
+            if (cancel_token->IsCancelled()) {
+                continue;
+            }
+            const std::string& payload = response->payloads(i);
+            ReadContext* read_context = context->read_context;
+            uint32_t block_offset = FLAGS_rsfs_sdk_rscode_block_size * block_no;
+            memcpy(read_context->slice_buffer.get() + block_offset,
+                   payload.data(), payload.size());
+            read_context->rscode->AddBlock(block_no, payload.data());
+            context->load_status.Set(block_no, 1);
+        }
+    }
+
+    RecycleMessage(request);
+    RecycleMessage(response);
+    context->done_event.Set();
+    context->DecRef();
+}
+
+void RsfsSDK::HandleTailBlocks(int64_t deadline) {
     if (m_remain_block_size > 0) {
         LOG(INFO) << "deal with the unseal block";
         ErrorCode err;
-        CHECK(m_remain_block_size == Write(
+        CHECK(m_remain_block_size == WriteWithDeadline(
                 m_last_block_buffer.get() + FLAGS_rsfs_sdk_rscode_block_size -
-                m_remain_block_size, m_remain_block_size, &err));
+                m_remain_block_size, m_remain_block_size, deadline, &err));
     }
 
     if (m_file_mode != "w"
@@ -740,19 +1301,27 @@ void RsfsSDK::HandleTailBlocks() {
         return;
     }
     for (int32_t i = 0; i < FLAGS_rsfs_sdk_rscode_kk; ++i) {
-        ParallelDumpTailBlock(m_cur_node_no);
+        ParallelDumpTailBlock(m_cur_node_no, deadline);
     }
 }
 
-bool RsfsSDK::ParallelDumpTailBlock(uint32_t start_node_no) {
+bool RsfsSDK::ParallelDumpTailBlock(uint32_t start_node_no, int64_t deadline) {
     AutoResetEvent wait_event;
-    scoped_ptr<utils::IntMap> dump_status(new utils::IntMap(m_node_list.size(), -1));
+    scoped_ptr<utils::IntMap> dump_status(new utils::IntMap(m_cur_rsblock_no, -1));
+    // the blocks to one node are written in order in one batch
+    std::vector<std::vector<uint32_t> > node_blocks(m_node_list.size());
     for (uint32_t i = 0; i < m_cur_rsblock_no; ++i) {
         uint32_t dump_node_no = (start_node_no + i) % m_node_list.size();
-        Closure<void>* callback =
-            NewClosure(this, &RsfsSDK::DumpTailBlock,
-                       dump_node_no, i, dump_status.get(), &wait_event);
-        m_thread_pool.AddTask(callback);
+        node_blocks[dump_node_no].push_back(i);
+    }
+    for (uint32_t node_no = 0; node_no < node_blocks.size(); ++node_no) {
+        if (node_blocks[node_no].size() == 1) {
+            DumpTailBlock(node_no, node_blocks[node_no][0],
+                          dump_status.get(), &wait_event, deadline);
+        } else if (node_blocks[node_no].size() > 1) {
+            DumpTailBlocks(node_no, node_blocks[node_no],
+                           dump_status.get(), &wait_event, deadline);
+        }
     }
     uint32_t wait_retry = 0;
     while (dump_status->GetSetNum() < m_cur_rsblock_no
@@ -769,57 +1338,56 @@ bool RsfsSDK::ParallelDumpTailBlock(uint32_t start_node_no) {
 }
 
 void RsfsSDK::DumpTailBlock(uint32_t node_no, uint32_t rsblock_no,
-                            utils::IntMap* dump_status, AutoResetEvent* done_event) {
-    WriteDataRequest* request = new WriteDataRequest;
-    WriteDataResponse* response = new WriteDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, node_no));
+                            utils::IntMap* dump_status, AutoResetEvent* done_event,
+                            int64_t deadline) {
+    WriteDataRequest* request = NewMessage<WriteDataRequest>();
+    WriteDataResponse* response = NewMessage<WriteDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, node_no));
 
     CHECK(m_rscode->GetBlockFromCache(rsblock_no, m_last_block_buffer.get()));
     request->set_payload(m_last_block_buffer.get(), FLAGS_rsfs_sdk_rscode_block_size);
 
     Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::DumpTailBlockCallback,
-                   node_no, rsblock_no, dump_status, done_event,
+                   node_no, rsblock_no, dump_status, done_event, deadline,
                    FLAGS_rsfs_sdk_write_retry_times);
 
-    snode::SNodeClientAsync node_client(m_node_list.Get(node_no).addr());
+    snode::SNodeClientAsync node_client(m_node_endpoints[node_no]);
     node_client.WriteData(request, response, done);
 }
 
 void RsfsSDK::DumpTailBlockCallback(uint32_t node_no, uint32_t block_no,
                                     utils::IntMap* dump_status,
-                                    AutoResetEvent* done_event, int32_t retry,
+                                    AutoResetEvent* done_event, int64_t deadline,
+                                    int32_t retry,
                                     WriteDataRequest* request, WriteDataResponse* response,
                                     bool failed, int error_code) {
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to read data, rpc status: "
             << StatusCodeToString(response->status())
             << " [node #" << node_no << ", block #" << block_no << "]";
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, deadline)) {
             LOG(ERROR) << "fail to read data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
+            RecycleMessage(request);
+            RecycleMessage(response);
             dump_status->Set(block_no, 0);
             done_event->Set();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_write_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::DumpTailBlockCallback,
-                           node_no, block_no, dump_status, done_event,
+                           node_no, block_no, dump_status, done_event, deadline,
                            retry - 1);
-
-            snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
-            node_client.WriteData(request, response, done);
+            ScheduleResend(m_node_endpoints[node_no],
+                           FLAGS_rsfs_sdk_write_retry_times - retry,
+                           request, response, done, deadline);
         }
         return;
     }
-    delete request;
-    delete response;
+    RecycleMessage(request);
+    RecycleMessage(response);
 
     dump_status->Set(block_no, 1);
     done_event->Set();
@@ -827,92 +1395,164 @@ void RsfsSDK::DumpTailBlockCallback(uint32_t node_no, uint32_t block_no,
     LOG(INFO) << "para-write success. block #" << block_no << " from node #" << node_no;
 }
 
-bool RsfsSDK::ParallelLoadTail(uint32_t slice_no) {
+void RsfsSDK::DumpTailBlocks(uint32_t node_no, std::vector<uint32_t> rsblock_nos,
+                             utils::IntMap* dump_status, AutoResetEvent* done_event,
+                             int64_t deadline) {
+    WriteDataBatchRequest* request = NewMessage<WriteDataBatchRequest>();
+    WriteDataBatchResponse* response = NewMessage<WriteDataBatchResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(deadline));
+    for (uint32_t i = 0; i < rsblock_nos.size(); ++i) {
+        CHECK(m_rscode->GetBlockFromCache(rsblock_nos[i], m_last_block_buffer.get()));
+        WriteDataEntry* entry = request->add_entries();
+        entry->set_block_id(utils::BlockFileName(m_file_id, node_no));
+        entry->set_payload(m_last_block_buffer.get(), FLAGS_rsfs_sdk_rscode_block_size);
+    }
+
+    Closure<void, WriteDataBatchRequest*, WriteDataBatchResponse*, bool, int>* done =
+        NewClosure(this, &RsfsSDK::DumpTailBlocksCallback,
+                   node_no, rsblock_nos, dump_status, done_event, deadline,
+                   FLAGS_rsfs_sdk_write_retry_times);
+
+    snode::SNodeClientAsync node_client(m_node_endpoints[node_no]);
+    node_client.WriteDataBatch(request, response, done);
+}
+
+void RsfsSDK::DumpTailBlocksCallback(uint32_t node_no, std::vector<uint32_t> rsblock_nos,
+                                     utils::IntMap* dump_status,
+                                     AutoResetEvent* done_event, int64_t deadline,
+                                     int32_t retry,
+                                     WriteDataBatchRequest* request,
+                                     WriteDataBatchResponse* response,
+                                     bool failed, int error_code) {
+    if (failed || response->status() != kSNodeOk
+        || response->statuses_size() != static_cast<int32_t>(rsblock_nos.size())) {
+        LOG(WARNING) << "fail to write data batch, rpc status: "
+            << StatusCodeToString(response->status())
+            << " [node #" << node_no << ", block num: " << rsblock_nos.size() << "]";
+        if (retry <= 0 || !RpcChannelHealth(error_code, deadline)) {
+            RecycleMessage(request);
+            RecycleMessage(response);
+            for (uint32_t i = 0; i < rsblock_nos.size(); ++i) {
+                dump_status->Set(rsblock_nos[i], 0);
+            }
+            done_event->Set();
+        } else {
+            Closure<void, WriteDataBatchRequest*, WriteDataBatchResponse*, bool, int>* done =
+                NewClosure(this, &RsfsSDK::DumpTailBlocksCallback,
+                           node_no, rsblock_nos, dump_status, done_event, deadline,
+                           retry - 1);
+            ScheduleResend(m_node_endpoints[node_no],
+                           FLAGS_rsfs_sdk_write_retry_times - retry,
+                           request, response, done, deadline);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < rsblock_nos.size(); ++i) {
+        dump_status->Set(rsblock_nos[i], response->statuses(i) == kSNodeOk ? 1 : 0);
+    }
+    RecycleMessage(request);
+    RecycleMessage(response);
+    done_event->Set();
+
+    LOG(INFO) << "para-write success. " << rsblock_nos.size()
+        << " blocks to node #" << node_no;
+}
+
+bool RsfsSDK::ParallelLoadTail(ReadContext* context, uint32_t slice_no) {
     uint32_t retry = 0;
-    while (retry < FLAGS_rsfs_sdk_rscode_kk + 1
-           && !ParallelLoadTailBlock(m_tail_num * retry)) {
+    while (retry < m_tail_copy_num
+           && !ParallelLoadTailBlock(context, retry)) {
         retry++;
     }
+    MutexLocker lock(m_crash_mutex);
     if (retry > m_max_crash_block_num) {
         m_max_crash_block_num = retry;
         m_max_crash_slice_no = slice_no;
     }
-    return retry <= FLAGS_rsfs_sdk_rscode_kk;
+    return retry < m_tail_copy_num;
 }
 
-bool RsfsSDK::ParallelLoadTailBlock(uint32_t start_no) {
-    AutoResetEvent wait_event;
-    scoped_ptr<utils::IntMap> load_status(new utils::IntMap(m_rscode->GetMK(), -1));
+bool RsfsSDK::ParallelLoadTailBlock(ReadContext* read_context, uint32_t copy_no) {
+    SliceLoadContext* context = new SliceLoadContext(m_rscode->GetMK(), m_tail_num + 1,
+                                                     read_context, m_tail_slice_no);
+    utils::IntMap* load_status = &context->load_status;
+    // the copies follow each other in write order, see HandleTailBlocks
+    uint64_t first_seq_no = GetBlockSeqNo(m_tail_slice_no, copy_no * m_tail_num);
     for (uint32_t i = 0; i < m_tail_num; ++i) {
-        uint32_t load_node_no = (start_no + i) % m_node_list.size();
-        Closure<void>* callback =
-            NewClosure(this, &RsfsSDK::LoadTailBlock,
-                       load_node_no, i, load_status.get(), &wait_event);
-        m_thread_pool.AddTask(callback);
+        uint64_t seq_no = first_seq_no + i;
+        LoadTailBlock(GetBlockNode(seq_no), i, GetBlockOffset(seq_no), context);
     }
+    // every block of the copy is needed, a failed one moves on to the
+    // next copy
     uint32_t wait_retry = 0;
     while (load_status->GetSetNum() < m_tail_num
+           && load_status->Sum(0) == 0
            && wait_retry < 100) {
-        if (!wait_event.Wait(500)) {
+        if (!context->done_event.Wait(500)) {
             wait_retry++;
         } else {
             wait_retry = 0;
         }
         LOG(INFO) << "retry_count: " << wait_retry;
     }
-    return load_status->Sum(1) == m_tail_num;
+
+    // give up the reads left, no block is copied after this
+    context->cancel_token.Cancel();
+    bool is_loaded = (load_status->Sum(1) == m_tail_num);
+    context->DecRef();
+    return is_loaded;
 }
 
-void RsfsSDK::LoadTailBlock(uint32_t node_no, uint32_t block_no,
-                            utils::IntMap* load_status, AutoResetEvent* done_event) {
-    ReadDataRequest* request = new ReadDataRequest;
-    ReadDataResponse* response = new ReadDataResponse;
-    request->set_sequence_id(++m_last_sequence_id);
-    request->set_block_id(BlockFileName(m_file_id, block_no));
+void RsfsSDK::LoadTailBlock(uint32_t node_no, uint32_t block_no, uint64_t offset,
+                            SliceLoadContext* context) {
+    ReadDataRequest* request = NewMessage<ReadDataRequest>();
+    ReadDataResponse* response = NewMessage<ReadDataResponse>();
+    request->set_sequence_id(NextSequenceId());
+    request->set_timeout_ms(GetRpcTimeout(context->deadline));
+    request->set_block_id(utils::BlockFileName(m_file_id, node_no));
     request->set_type(ReadDataRequest::RANDOM_READ);
+    request->set_offset(offset);
     request->set_payload_size(FLAGS_rsfs_sdk_rscode_block_size);
 
     Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done =
         NewClosure(this, &RsfsSDK::LoadTailCallback,
-                   node_no, block_no, load_status, done_event,
-                   0, FLAGS_rsfs_sdk_read_retry_times);
+                   node_no, block_no, context,
+                   FLAGS_rsfs_sdk_read_retry_times);
 
-    snode::SNodeClientAsync node_client(m_node_list.Get(node_no).addr());
+    snode::SNodeClientAsync node_client(m_node_endpoints[node_no]);
+    node_client.SetCancelToken(&context->cancel_token);
     node_client.ReadData(request, response, done);
     LOG(INFO) << "try load tail block #" << block_no
         << " from node #" << node_no << " (" << node_client.GetConnectAddr() << ")";
 }
 
 void RsfsSDK::LoadTailCallback(uint32_t node_no, uint32_t block_no,
-                               utils::IntMap* load_status, AutoResetEvent* done_event,
-                               int32_t replica_no, int32_t retry,
+                               SliceLoadContext* context, int32_t retry,
                                ReadDataRequest* request, ReadDataResponse* response,
                                bool failed, int error_code) {
+    RpcCancelToken* cancel_token = &context->cancel_token;
     if (failed || response->status() != kSNodeOk) {
         LOG(WARNING) << "fail to read data, rpc status: "
             << StatusCodeToString(response->status())
             << " [node #" << node_no << ", block #" << block_no << "]";
-        if (retry <= 0 || !RpcChannelHealth(error_code)) {
+        if (retry <= 0 || !RpcChannelHealth(error_code, context->deadline)
+            || cancel_token->IsCancelled()) {
             LOG(ERROR) << "fail to read data after " << FLAGS_rsfs_sdk_write_retry_times
                 << ", rpc status: " << StatusCodeToString(response->status());
-            delete request;
-            delete response;
-            if (!load_status->IsSet(block_no, 1)) {
-                load_status->Set(block_no, 0);
-            }
-            done_event->Set();
+            RecycleMessage(request);
+            RecycleMessage(response);
+            context->load_status.Set(block_no, 0);
+            context->done_event.Set();
+            context->DecRef();
         } else {
-            int64_t wait_time = FLAGS_rsfs_snode_connect_retry_period *
-                (FLAGS_rsfs_sdk_read_retry_times - retry);
-            ThisThread::Sleep(wait_time);
-
             Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done =
                 NewClosure(this, &RsfsSDK::LoadTailCallback,
-                           node_no, block_no, load_status, done_event,
-                           replica_no, retry - 1);
-
-            snode::SNodeClientAsync node_client(m_node_list.Get(m_cur_node_no).addr());
-            node_client.ReadData(request, response, done);
+                           node_no, block_no, context, retry - 1);
+            ScheduleResend(m_node_endpoints[node_no],
+                           FLAGS_rsfs_sdk_read_retry_times - retry,
+                           request, response, done, context->deadline,
+                           cancel_token);
         }
         return;
     }
@@ -920,21 +1560,25 @@ void RsfsSDK::LoadTailCallback(uint32_t node_no, uint32_t block_no,
     LOG(INFO) << "rpc read success. block #" << block_no << " from node #" << node_no
         << ", payload size: " << response->payload().size();
 
-    uint32_t block_offset = FLAGS_rsfs_sdk_rscode_block_size * block_no;
-    memcpy(m_last_block_buffer.get() + block_offset,
-           response->payload().data(),
-           response->payload().size());
-
-    delete request;
-    delete response;
-
-    if (!load_status->IsSet(block_no, 1)) {
-        load_status->Set(block_no, 1);
+    {
+        // the loader may have moved to next copy, drop the late one
+        MutexLocker lock(cancel_token->GetMutex());
+        if (!cancel_token->IsCancelled()) {
+            uint32_t block_offset = FLAGS_rsfs_sdk_rscode_block_size * block_no;
+            memcpy(context->read_context->slice_buffer.get() + block_offset,
+                   response->payload().data(),
+                   response->payload().size());
+            context->load_status.Set(block_no, 1);
+        }
     }
-    done_event->Set();
+
+    RecycleMessage(request);
+    RecycleMessage(response);
+    context->done_event.Set();
+    context->DecRef();
 
     LOG(INFO) << "load tail success. block #" << block_no
-        << " from node #" << node_no << " (replica #" << replica_no << ")";
+        << " from node #" << node_no;
 }
 
 } // namespace sdk
@@ -8,6 +8,7 @@
 #define RSFS_SDK_RSFS_SDK_H
 
 #include <string>
+#include <vector>
 
 #include "common/base/closure.h"
 #include "common/base/scoped_ptr.h"
@@ -27,7 +28,9 @@
 #include "rsfs/sdk/sdk.h"
 #include "rsfs/snode/snode_client_async.h"
 #include "rsfs/proto/proto_helper.h"
+#include "rsfs/utils/atomic.h"
 #include "rsfs/utils/int_map.h"
+#include "rsfs/utils/object_pool.h"
 
 namespace rsfs {
 
@@ -41,8 +44,65 @@ class SNodeClientAsync;
 
 namespace sdk {
 
+class ScanStream;
+
 const std::string RSFS_SDK_PREFIX = "/rsfs/";
 
+// the scratch of one positional read, so that the reads sharing a
+// handle do not step on each other. it is pooled by handle and keeps
+// the slice last loaded for the next read to reuse.
+struct ReadContext {
+    scoped_ptr<rscode::RSCode> rscode;
+    scoped_array<char> slice_buffer;
+    // the slice in buffer, -1 for none
+    int64_t slice_no;
+    // the time (ms) the read is given up, 0 for none
+    int64_t deadline;
+
+    ReadContext();
+    void Clear() {
+        deadline = 0;
+    }
+};
+
+// the state shared by the block reads of one slice. the reads left are
+// cancelled once enough blocks are loaded, and the context is released
+// by the last one of the loader and the reads.
+struct SliceLoadContext {
+    utils::IntMap load_status;
+    AutoResetEvent done_event;
+    RpcCancelToken cancel_token;
+    volatile int32_t ref_count;
+    // the loader owns it, not touched once cancelled
+    ReadContext* read_context;
+    uint32_t slice_no;
+    int64_t deadline;
+
+    SliceLoadContext(uint32_t block_num, int32_t ref,
+                     ReadContext* context, uint32_t slice)
+        : load_status(block_num, -1), ref_count(ref), read_context(context),
+          slice_no(slice), deadline(context->deadline) {}
+
+    void DecRef() {
+        if (atomic_dec_ret_old(&ref_count) == 1) {
+            delete this;
+        }
+    }
+};
+
+// the state of one sequential read or write, which goes on block by
+// block in the rpc callbacks until the buffer is done
+struct BlockIoContext {
+    AutoResetEvent done_event;
+    // the bytes done, -1 for failure
+    int64_t count;
+    ErrorCode* err;
+    // the time (ms) the io is given up, 0 for none
+    int64_t deadline;
+
+    BlockIoContext(ErrorCode* error, int64_t io_deadline)
+        : count(0), err(error), deadline(io_deadline) {}
+};
 
 class RsfsSDK : public SDK {
 public:
@@ -55,6 +115,7 @@ public:
 
     int64_t Read(void* buf, uint32_t buf_size, ErrorCode* err);
 
+    // safe to call concurrently on a read handle
     int64_t Read(void* buf, uint32_t buf_size, int64_t offset,
                  ErrorCode* err);
 
@@ -68,66 +129,119 @@ protected:
                   ErrorCode* err);
     bool ListImpl(const std::string& start, const std::string& end,
                   std::string* last_one, std::vector<TreeNode>* list,
-                  ErrorCode* err);
+                  ErrorCode* err, ListMode mode);
+    bool StatImpl(const std::vector<std::string>& paths,
+                  std::vector<FileStat>* stats, ErrorCode* err);
+    bool SplitImpl(const std::string& start, const std::string& end,
+                   uint32_t split_num, std::vector<std::string>* split_keys,
+                   ErrorCode* err);
+    bool RemoveImpl(const std::string& file_path, ErrorCode* err);
+    bool IsPreadConcurrent();
 
 private:
+    // the write of buffer given up at deadline
+    int64_t WriteWithDeadline(void* buf, uint32_t buf_size, int64_t deadline,
+                              ErrorCode* err);
     void WriteCallback(void* buf, uint32_t buf_size,
-                       AutoResetEvent* done, int64_t* write_count,
-                       ErrorCode* err, int32_t retry,
+                       BlockIoContext* context, int32_t retry,
                        WriteDataRequest* request, WriteDataResponse* response,
                        bool failed, int error_code);
 
     void ReadCallback(void* buf, uint32_t buf_size,
-                       AutoResetEvent* done_event, int64_t* read_count,
-                       ErrorCode* err, int32_t retry,
-                       ReadDataRequest* request, ReadDataResponse* response,
-                       bool failed, int error_code);
+                      BlockIoContext* context, int32_t retry,
+                      ReadDataRequest* request, ReadDataResponse* response,
+                      bool failed, int error_code);
 
-    void LoadBlockCallback(uint32_t node_no, uint32_t block_no, utils::IntMap* load_status,
-                           AutoResetEvent* done_event, int32_t retry,
+    void LoadBlockCallback(uint32_t node_no, uint32_t block_no,
+                           SliceLoadContext* context, int32_t retry,
                            ReadDataRequest* request, ReadDataResponse* response,
                            bool failed, int error_code);
 
-    bool RpcChannelHealth(int32_t err_code);
+    uint64_t NextSequenceId();
+    // the deadline of an operation started now, every rpc of the
+    // operation carries it
+    int64_t GetOperationDeadline();
+    // the timeout of rpc sent now in the operation given up at deadline
+    int64_t GetRpcTimeout(int64_t deadline);
+    bool RpcChannelHealth(int32_t err_code, int64_t deadline);
     bool GetSliceLocation(int64_t offset, uint32_t* slice_start_block,
                           uint64_t* offset_in_slice);
-    bool ParallelLoadSlice(uint32_t start_no);
+    // the rs blocks of file are numbered in write order, and each node
+    // appends the blocks sent to it to its only block file. the block
+    // #seq_no is on node #(seq_no % node num), at the offset of the
+    // (seq_no / node num) blocks before it there
+    uint64_t GetBlockSeqNo(uint32_t slice_no, uint32_t block_no);
+    uint32_t GetBlockNode(uint64_t seq_no);
+    uint64_t GetBlockOffset(uint64_t seq_no);
+    // the scans are used only if is_sequential
+    int64_t ReadAt(void* buf, uint32_t buf_size, int64_t offset,
+                   bool is_sequential, ErrorCode* err);
+    bool LoadSlice(ReadContext* context, uint32_t slice_no, bool is_sequential);
+    bool ParallelLoadSlice(ReadContext* context, uint32_t slice_no);
     void LoadSliceBlock(uint32_t node_no, uint32_t block_no,
-                        utils::IntMap* load_status, AutoResetEvent* event);
-
-    bool PallelOpenDataFile();
-    void OpenDataFile(std::string addr, uint32_t block_no,
-                      utils::IntMap* open_status, AutoResetEvent* done_event);
-    void OpenDataFileCallback(std::string addr, uint32_t block_no, utils::IntMap* open_status,
-                              AutoResetEvent* done_event, int32_t retry,
+                        SliceLoadContext* context);
+    // the blocks on one node in a batch
+    void LoadSliceBlocks(uint32_t node_no, std::vector<uint32_t> block_nos,
+                         SliceLoadContext* context);
+    void LoadBlocksCallback(uint32_t node_no, std::vector<uint32_t> block_nos,
+                            SliceLoadContext* context, int32_t retry,
+                            ReadDataBatchRequest* request,
+                            ReadDataBatchResponse* response,
+                            bool failed, int error_code);
+
+    // load the data blocks of slice from the scans, which are reopened
+    // if the slice is not the next one they deliver
+    bool ScanLoadSlice(ReadContext* context, uint32_t slice_no);
+    void OpenScans(uint32_t slice_no, int64_t deadline);
+    void CloseScans();
+
+    bool PallelOpenDataFile(int64_t deadline);
+    void OpenDataFile(RpcEndpoint* endpoint, uint32_t block_no,
+                      utils::IntMap* open_status, AutoResetEvent* done_event,
+                      int64_t deadline);
+    void OpenDataFileCallback(RpcEndpoint* endpoint, uint32_t block_no, utils::IntMap* open_status,
+                              AutoResetEvent* done_event, int64_t deadline, int32_t retry,
                               OpenDataRequest* request, OpenDataResponse* response,
                               bool failed, int error_code);
 
-    bool PallelCloseDataFile();
-    void CloseDataFile(std::string addr, uint32_t block_no,
-                       utils::IntMap* close_status, AutoResetEvent* done_event);
-    void CloseDataFileCallback(std::string addr, uint32_t block_no, utils::IntMap* close_status,
-                              AutoResetEvent* done_event, int32_t retry,
+    bool PallelCloseDataFile(int64_t deadline);
+    void CloseDataFile(RpcEndpoint* endpoint, uint32_t block_no,
+                       utils::IntMap* close_status, AutoResetEvent* done_event,
+                       int64_t deadline);
+    void CloseDataFileCallback(RpcEndpoint* endpoint, uint32_t block_no, utils::IntMap* close_status,
+                              AutoResetEvent* done_event, int64_t deadline, int32_t retry,
                               CloseDataRequest* request, CloseDataResponse* response,
                               bool failed, int error_code);
 
-    void HandleTailBlocks();
-    bool ParallelDumpTailBlock(uint32_t start_node_no);
+    void HandleTailBlocks(int64_t deadline);
+    bool ParallelDumpTailBlock(uint32_t start_node_no, int64_t deadline);
     void DumpTailBlock(uint32_t node_no, uint32_t rsblock_no,
-                       utils::IntMap* dump_status, AutoResetEvent* done_event);
+                       utils::IntMap* dump_status, AutoResetEvent* done_event,
+                       int64_t deadline);
     void DumpTailBlockCallback(uint32_t node_no, uint32_t buf_size,
                                utils::IntMap* dump_status,
-                               AutoResetEvent* done_event, int32_t retry,
+                               AutoResetEvent* done_event, int64_t deadline,
+                               int32_t retry,
                                WriteDataRequest* request, WriteDataResponse* response,
                                bool failed, int error_code);
-
-    bool ParallelLoadTail(uint32_t slice_no);
-    bool ParallelLoadTailBlock(uint32_t start_no);
-    void LoadTailBlock(uint32_t node_no, uint32_t block_no,
-                       utils::IntMap* load_status, AutoResetEvent* done_event);
+    void DumpTailBlocks(uint32_t node_no, std::vector<uint32_t> rsblock_nos,
+                        utils::IntMap* dump_status, AutoResetEvent* done_event,
+                        int64_t deadline);
+    void DumpTailBlocksCallback(uint32_t node_no, std::vector<uint32_t> rsblock_nos,
+                                utils::IntMap* dump_status,
+                                AutoResetEvent* done_event, int64_t deadline,
+                                int32_t retry,
+                                WriteDataBatchRequest* request,
+                                WriteDataBatchResponse* response,
+                                bool failed, int error_code);
+
+    bool ParallelLoadTail(ReadContext* context, uint32_t slice_no);
+    // the tail blocks are dumped kk more times after the first copy
+    bool ParallelLoadTailBlock(ReadContext* context, uint32_t copy_no);
+    void LoadTailBlock(uint32_t node_no, uint32_t block_no, uint64_t offset,
+                       SliceLoadContext* context);
     void LoadTailCallback(uint32_t node_no, uint32_t block_no,
-                          utils::IntMap* load_status, AutoResetEvent* done_event,
-                          int32_t replica_no, int32_t retry,
+                          SliceLoadContext* context, int32_t retry,
                           ReadDataRequest* request, ReadDataResponse* response,
                           bool failed, int error_code);
 
@@ -135,13 +249,19 @@ private:
     scoped_ptr<master::MasterClient> m_master_client;
     scoped_ptr<rscode::RSCode> m_rscode;
 
-    uint64_t m_last_sequence_id;
+    volatile uint64_t m_last_sequence_id;
     uint32_t m_cur_node_no;
     uint32_t m_cur_rsblock_no;
     uint64_t m_remain_block_size;
     int64_t m_cur_slice_no;
+    // the crash stats are updated by concurrent reads
+    Mutex m_crash_mutex;
     int64_t m_max_crash_slice_no;
     uint32_t m_max_crash_block_num;
+    // the crash stats known by master, a read is closed on master
+    // only to report worse ones
+    int64_t m_open_crash_slice_no;
+    uint32_t m_open_crash_block_num;
     scoped_array<char> m_last_block_buffer;
 
     std::string m_file_name;
@@ -151,8 +271,20 @@ private:
     int64_t m_seq_read_offset;
     int64_t m_tail_slice_no;
     uint32_t m_tail_num;
+    uint32_t m_tail_copy_num;
+    // the scratch of positional reads
+    scoped_ptr<utils::ObjectPool<ReadContext> > m_read_contexts;
+    // the sequential position and the scans, one sequential reader
+    // at a time
+    Mutex m_seq_mutex;
+    // the scans of node block files for sequential read, NULL for the
+    // nodes not scanned, and the slice they deliver next
+    std::vector<ScanStream*> m_scan_streams;
+    int64_t m_scan_slice_no;
+    bool m_is_scan_disabled;
     SNodeInfoList m_node_list;
-    ThreadPool m_thread_pool;
+    // resolved endpoint of each node in m_node_list
+    std::vector<RpcEndpoint*> m_node_endpoints;
 };
 
 } // namespace sdk
@@ -20,6 +20,7 @@
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 #include "version.h"
+#include "rsfs/sdk/sdk_runtime.h"
 
 #include "rsfs/utils/utils_cmd.h"
 
@@ -39,6 +40,7 @@ void Usage(const std::string& prg_name) {
     std::cout << "       e.g. " << "nlfs cp /path/to/src_file  /path/to/dest_file" << std::endl;
     std::cout << "       e.g. " << "nlfs rm /path/to/[dir or file]" << std::endl;
     std::cout << "       e.g. " << "nlfs ls /path/to/[dir or file]" << std::endl;
+    std::cout << "       e.g. " << "nlfs lsp /path/to/[dir or file]" << std::endl;
     std::cout << "       e.g. " << "nlfs [help]" << std::endl;
 }
 
@@ -91,7 +93,8 @@ int32_t ListOp(int32_t argc, char** argv) {
     rsfs::ErrorCode err;
     while (path_start != path_end
            && rsfs::sdk::SDK::Listx(rsfs.get(), path_start, path_end, &last_one,
-                               &node_list, &err)) {
+                               &node_list, &err,
+                               rsfs::sdk::SDK::kListSummary)) {
         for (uint32_t i = 0; i < node_list.size(); ++i) {
             std::cout << node_list[i].fid()
                 << "\t" << std::left << std::setw(30) << node_list[i].name()
@@ -99,6 +102,7 @@ int32_t ListOp(int32_t argc, char** argv) {
                 << "\t" << std::setw(10) << "crashed: " << node_list[i].crash_num()
                 << std::endl;
         }
+        node_list.clear();
         path_start = last_one;
         err.Reset();
     }
@@ -109,6 +113,29 @@ int32_t ListOp(int32_t argc, char** argv) {
     return 0;
 }
 
+int32_t ParallelListOp(int32_t argc, char** argv) {
+    if (argc < 3) {
+        Usage(argv[0]);
+        return -1;
+    }
+    std::string file_path = argv[2];
+    std::vector<rsfs::TreeNode> node_list;
+    rsfs::ErrorCode err;
+    if (!rsfs::sdk::SDK::ParallelList(file_path, &node_list, &err,
+                                      rsfs::sdk::SDK::kListSummary)) {
+        LOG(ERROR) << "something wrong happen, err: " << err.GetReason();
+        return -1;
+    }
+    for (uint32_t i = 0; i < node_list.size(); ++i) {
+        std::cout << node_list[i].fid()
+            << "\t" << std::left << std::setw(30) << node_list[i].name()
+            << "\t" << std::setw(10) << node_list[i].file_size()
+            << "\t" << std::setw(10) << "crashed: " << node_list[i].crash_num()
+            << std::endl;
+    }
+    return 0;
+}
+
 int32_t HelpOp(int32_t argc, char** argv) {
     argc = argc;
     Usage(argv[0]);
@@ -171,6 +198,7 @@ int main(int32_t argc, char** argv) {
         Usage(argv[0]);
         return -1;
     }
+    rsfs::sdk::SdkRuntime::Init();
     int ret = 0;
     std::string cmd = argv[1];
     if (cmd == "cp" || cmd == "copy") {
@@ -179,11 +207,14 @@ int main(int32_t argc, char** argv) {
         ret = DeleteOp(argc, argv);
     } else if (cmd == "ls" || cmd == "list") {
         ret = ListOp(argc, argv);
+    } else if (cmd == "lsp" || cmd == "plist") {
+        ret = ParallelListOp(argc, argv);
     } else if (cmd == "help") {
         ret = HelpOp(argc, argv);
     } else {
         ret = HelpOp(argc, argv);
     }
+    rsfs::sdk::SdkRuntime::Shutdown();
 
     return ret;
 }
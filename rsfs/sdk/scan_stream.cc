@@ -0,0 +1,172 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/sdk/scan_stream.h"
+
+#include "common/base/closure.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/proto/proto_helper.h"
+#include "rsfs/snode/snode_client_async.h"
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace sdk {
+
+static void CloseScanCallback(CloseScanRequest* request, CloseScanResponse* response,
+                              bool failed, int error_code) {
+    // an unclosed scan is dropped by snode once idle
+    if (failed || response->status() != kSNodeOk) {
+        LOG(WARNING) << "fail to close scan #" << request->scan_id()
+            << ", rpc status: " << StatusCodeToString(response->status());
+    }
+    delete request;
+    delete response;
+}
+
+ScanStream::ScanStream(RpcEndpoint* endpoint, uint64_t block_id,
+                       uint32_t chunk_size, int32_t window)
+    : m_endpoint(endpoint), m_block_id(block_id), m_chunk_size(chunk_size),
+      m_window(window > 0 ? window : 1), m_scan_id(0), m_sequence_id(0),
+      m_server_credit(0), m_consumed_num(0), m_is_calling(false),
+      m_is_eof(false), m_is_failed(false) {}
+
+ScanStream::~ScanStream() {
+    {
+        MutexLocker lock(m_mutex);
+        // no more fetch, and the one in flight needs this alive
+        m_is_failed = true;
+        while (m_is_calling) {
+            m_mutex.Unlock();
+            m_event.Wait(100);
+            m_mutex.Lock();
+        }
+    }
+    if (m_scan_id == 0) {
+        return;
+    }
+    CloseScanRequest* request = new CloseScanRequest;
+    CloseScanResponse* response = new CloseScanResponse;
+    request->set_sequence_id(++m_sequence_id);
+    request->set_scan_id(m_scan_id);
+    snode::SNodeClientAsync node_client(m_endpoint);
+    node_client.CloseScan(request, response, NewClosure(&CloseScanCallback));
+}
+
+void ScanStream::Open(uint64_t offset, uint64_t length, int64_t timeout_ms) {
+    OpenScanRequest* request = new OpenScanRequest;
+    OpenScanResponse* response = new OpenScanResponse;
+    request->set_sequence_id(++m_sequence_id);
+    request->set_block_id(m_block_id);
+    request->set_offset(offset);
+    request->set_length(length);
+    request->set_chunk_size(m_chunk_size);
+    request->set_credit(m_window);
+    request->set_timeout_ms(timeout_ms);
+    {
+        MutexLocker lock(m_mutex);
+        m_is_calling = true;
+    }
+
+    Closure<void, OpenScanRequest*, OpenScanResponse*, bool, int>* done =
+        NewClosure(this, &ScanStream::OpenCallback);
+    snode::SNodeClientAsync node_client(m_endpoint);
+    node_client.OpenScan(request, response, done);
+}
+
+bool ScanStream::Next(std::string* chunk, int64_t timeout_ms) {
+    int64_t deadline = utils::GetMillis() + timeout_ms;
+    MutexLocker lock(m_mutex);
+    while (m_chunks.empty()) {
+        if (m_is_eof || m_is_failed) {
+            return false;
+        }
+        int64_t wait_time = deadline - utils::GetMillis();
+        if (wait_time <= 0) {
+            LOG(WARNING) << "timeout to scan block [id: " << m_block_id << "]";
+            return false;
+        }
+        m_mutex.Unlock();
+        m_event.Wait(wait_time);
+        m_mutex.Lock();
+    }
+    chunk->swap(m_chunks.front());
+    m_chunks.pop_front();
+    m_consumed_num++;
+    TryFetch();
+    return true;
+}
+
+void ScanStream::TryFetch() {
+    if (m_is_calling || m_is_eof || m_is_failed || m_scan_id == 0) {
+        return;
+    }
+    // nothing will come without credit, do not poll for it
+    if (m_server_credit <= 0 && m_consumed_num == 0) {
+        return;
+    }
+    ScanDataRequest* request = new ScanDataRequest;
+    ScanDataResponse* response = new ScanDataResponse;
+    request->set_sequence_id(++m_sequence_id);
+    request->set_scan_id(m_scan_id);
+    request->set_credit(m_consumed_num);
+    m_server_credit += m_consumed_num;
+    m_consumed_num = 0;
+    m_is_calling = true;
+
+    Closure<void, ScanDataRequest*, ScanDataResponse*, bool, int>* done =
+        NewClosure(this, &ScanStream::FetchCallback);
+    snode::SNodeClientAsync node_client(m_endpoint);
+    node_client.ScanData(request, response, done);
+}
+
+void ScanStream::OpenCallback(OpenScanRequest* request, OpenScanResponse* response,
+                              bool failed, int error_code) {
+    {
+        MutexLocker lock(m_mutex);
+        m_is_calling = false;
+        if (failed || response->status() != kSNodeOk) {
+            LOG(WARNING) << "fail to open scan on block [id: " << m_block_id
+                << "], rpc status: " << StatusCodeToString(response->status());
+            m_is_failed = true;
+        } else {
+            m_scan_id = response->scan_id();
+            m_server_credit = m_window;
+            TryFetch();
+        }
+        delete request;
+        delete response;
+        // the owner may go once the lock is released, touch nothing after
+        m_event.Set();
+    }
+}
+
+void ScanStream::FetchCallback(ScanDataRequest* request, ScanDataResponse* response,
+                               bool failed, int error_code) {
+    {
+        MutexLocker lock(m_mutex);
+        m_is_calling = false;
+        if (failed || response->status() != kSNodeOk) {
+            LOG(WARNING) << "fail to scan block [id: " << m_block_id
+                << "], rpc status: " << StatusCodeToString(response->status());
+            m_is_failed = true;
+        } else {
+            for (int32_t i = 0; i < response->chunks_size(); ++i) {
+                m_chunks.push_back(std::string());
+                m_chunks.back().swap(*response->mutable_chunks(i));
+            }
+            m_server_credit -= response->chunks_size();
+            m_is_eof = response->eof();
+            TryFetch();
+        }
+        delete request;
+        delete response;
+        m_event.Set();
+    }
+}
+
+} // namespace sdk
+} // namespace rsfs
@@ -0,0 +1,73 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SDK_SCAN_STREAM_H
+#define RSFS_SDK_SCAN_STREAM_H
+
+#include <deque>
+#include <string>
+
+#include "common/base/stdint.h"
+#include "common/lock/event.h"
+#include "common/lock/mutex.h"
+
+#include "rsfs/proto/snode_rpc.pb.h"
+#include "rsfs/rpc_channel_pool.h"
+
+namespace rsfs {
+namespace sdk {
+
+// reads a block file in chunks through a scan on snode. snode reads
+// ahead up to window chunks, and one ScanData is kept in flight to take
+// them, so a single reader keeps the link busy instead of paying a
+// round trip per block.
+class ScanStream {
+public:
+    ScanStream(RpcEndpoint* endpoint, uint64_t block_id,
+               uint32_t chunk_size, int32_t window);
+    // waits the call in flight, then closes the scan on snode
+    ~ScanStream();
+
+    // start the scan from offset, length 0 for to the end of block.
+    // it returns at once, the failure is reported by Next
+    void Open(uint64_t offset, uint64_t length, int64_t timeout_ms);
+
+    // take the next chunk, waiting for it at most timeout_ms.
+    // false on failure, timeout or the end of block
+    bool Next(std::string* chunk, int64_t timeout_ms);
+
+private:
+    // keep one ScanData in flight while snode may have chunks, m_mutex held
+    void TryFetch();
+
+    void OpenCallback(OpenScanRequest* request, OpenScanResponse* response,
+                      bool failed, int error_code);
+    void FetchCallback(ScanDataRequest* request, ScanDataResponse* response,
+                       bool failed, int error_code);
+
+private:
+    RpcEndpoint* m_endpoint;
+    uint64_t m_block_id;
+    uint32_t m_chunk_size;
+    int32_t m_window;
+
+    Mutex m_mutex;
+    AutoResetEvent m_event;
+    uint64_t m_scan_id;
+    uint64_t m_sequence_id;
+    std::deque<std::string> m_chunks;
+    // the credits snode holds, and those consumed not granted back yet
+    int32_t m_server_credit;
+    int32_t m_consumed_num;
+    bool m_is_calling;
+    bool m_is_eof;
+    bool m_is_failed;
+};
+
+} // namespace sdk
+} // namespace rsfs
+
+#endif // RSFS_SDK_SCAN_STREAM_H
@@ -9,19 +9,47 @@
 #include "common/base/string_ext.h"
 #include "common/collection/rscode/rscode.h"
 #include "common/file/file_path.h"
+#include "common/thread/thread_pool.h"
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 
 #include "global_config.h"
 #include "rsfs/sdk/local_sdk.h"
 #include "rsfs/sdk/rsfs_sdk.h"
+#include "rsfs/sdk/sdk_runtime.h"
+#include "rsfs/utils/atomic.h"
 #include "rsfs/utils/utils_cmd.h"
 
 DECLARE_int32(rsfs_sdk_rscode_block_size);
+DECLARE_int32(rsfs_sdk_list_parallel_num);
+DECLARE_int32(rsfs_sdk_async_max_depth);
 
 namespace rsfs {
 namespace sdk {
 
+static ThreadPool* GetAsyncThreadPool() {
+    return SdkRuntime::Get()->GetAsyncThreadPool();
+}
+
+static ThreadPool* GetListThreadPool() {
+    return SdkRuntime::Get()->GetListThreadPool();
+}
+
+// the handle whose async callback is running on this thread, which
+// must not wait its own io
+static __thread SDK* s_callback_handle = NULL;
+
+
+SDK::SDK() : m_async_num(0), m_is_async_running(false) {
+    // the threads and rpc options are of the process, not of handle
+    SdkRuntime::Attach();
+}
+
+SDK::~SDK() {
+    // the handle of derived class is gone here, it waits the io first
+    WaitAsyncIo();
+    SdkRuntime::Detach();
+}
 
 SDK* SDK::Open(const std::string& file_path,
                const std::string& mode,
@@ -65,8 +93,30 @@ SDK* SDK::CreateSDKImpl(const std::string& impl_type) {
 
 
 bool SDK::IsExist(const std::string& full_path, ErrorCode* err) {
+    std::vector<std::string> paths(1, full_path);
+    std::vector<FileStat> stats;
+    if (!BatchStat(paths, &stats, err)) {
+        return false;
+    }
+    return stats[0].status() == kMasterOk;
+}
 
-    return false;
+bool SDK::BatchStat(const std::vector<std::string>& paths,
+                    std::vector<FileStat>* stats, ErrorCode* err) {
+    if (paths.empty()) {
+        return true;
+    }
+    std::string prefix = GetPathPrefix(paths[0]);
+    for (uint32_t i = 1; i < paths.size(); ++i) {
+        if (GetPathPrefix(paths[i]) != prefix) {
+            LOG(ERROR) << "batch stat across storages: " << paths[0]
+                << " and " << paths[i];
+            err->SetFailed(ErrorCode::kBadParam, "paths of different storages");
+            return false;
+        }
+    }
+    scoped_ptr<SDK> sdk_impl(CreateSDKImpl(prefix));
+    return sdk_impl->StatImpl(paths, stats, err);
 }
 
 bool SDK::Copy(const std::string& src_path, const std::string& dst_path) {
@@ -77,7 +127,8 @@ bool SDK::Copy(const std::string& src_path, const std::string& dst_path) {
     CHECK(dst_file.get() != NULL);
 
     const uint32_t BUFFER_SIZE = FLAGS_rsfs_sdk_rscode_block_size;
-    char* buffer = new char[BUFFER_SIZE];
+    scoped_array<char> buffer_holder(new char[BUFFER_SIZE]);
+    char* buffer = buffer_holder.get();
     int64_t src_len = src_file->GetSize(&err);
     int64_t remain_len = src_len;
 
@@ -106,7 +157,6 @@ bool SDK::Copy(const std::string& src_path, const std::string& dst_path) {
         LOG(INFO) << "block #" << package_no++
             << ", md5: " << utils::GetMd5(buffer, read_count);
     }
-    delete buffer;
     src_file->Close(&err);
     dst_file->Close(&err);
 
@@ -115,22 +165,280 @@ bool SDK::Copy(const std::string& src_path, const std::string& dst_path) {
 
 bool SDK::Remove(const std::string& full_path, bool is_recusive,
                  ErrorCode* err) {
-    return false;
+    ErrorCode local_err;
+    if (err == NULL) {
+        err = &local_err;
+    }
+    scoped_ptr<SDK> sdk_impl(CreateSDKImpl(GetPathPrefix(full_path)));
+    if (!is_recusive) {
+        return sdk_impl->RemoveImpl(full_path, err);
+    }
+
+    std::string dir_path = full_path;
+    while (dir_path.size() > 1 && dir_path[dir_path.size() - 1] == '/') {
+        dir_path.resize(dir_path.size() - 1);
+    }
+    // only the descendants, not the siblings sharing the name prefix
+    std::vector<TreeNode> list;
+    if (!sdk_impl->ListTreeImpl(dir_path, &list, err)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < list.size(); ++i) {
+        if (!sdk_impl->RemoveImpl(list[i].name(), err)
+            && err->GetType() != ErrorCode::kNotFound) {
+            LOG(ERROR) << "fail to remove: " << list[i].name();
+            return false;
+        }
+        err->Reset();
+    }
+    // dir_path may be a directory only known by its children
+    if (!sdk_impl->RemoveImpl(dir_path, err)) {
+        if (list.empty() || err->GetType() != ErrorCode::kNotFound) {
+            return false;
+        }
+        err->Reset();
+    }
+    return true;
 }
 
 
 bool SDK::List(const std::string& full_path, std::vector<TreeNode>* list,
-               ErrorCode* err) {
+               ErrorCode* err, ListMode mode) {
     scoped_ptr<SDK> sdk_impl(CreateSDKImpl(GetPathPrefix(full_path)));
+    std::string path_start = full_path + "#";
+    std::string path_end = full_path + "~";
+    std::string last_one;
+    while (path_start != path_end) {
+        if (!Listx(sdk_impl.get(), path_start, path_end, &last_one, list,
+                   err, mode)) {
+            return false;
+        }
+        path_start = last_one;
+    }
+    return true;
+}
+
+bool SDK::ParallelList(const std::string& full_path,
+                       std::vector<TreeNode>* list, ErrorCode* err,
+                       ListMode mode, uint32_t parallel_num) {
+    if (parallel_num == 0) {
+        parallel_num = FLAGS_rsfs_sdk_list_parallel_num;
+    }
+    std::string prefix = GetPathPrefix(full_path);
+    std::string path_start = full_path + "#";
+    std::string path_end = full_path + "~";
+    std::vector<std::string> split_keys;
+    // also keeps the runtime up for the list helpers
+    scoped_ptr<SDK> sdk_impl(CreateSDKImpl(prefix));
+    if (!sdk_impl->SplitImpl(path_start, path_end, parallel_num,
+                             &split_keys, err)) {
+        return false;
+    }
+
+    uint32_t range_num = split_keys.size() + 1;
+    // the lister takes ranges too, so the list goes on when the pool
+    // is busy
+    uint32_t helper_num = range_num - 1;
+    ListContext* context = new ListContext(range_num, helper_num + 1);
+    std::vector<ListRangeTask>& tasks = context->tasks;
+    for (uint32_t i = 0; i < range_num; ++i) {
+        tasks[i].prefix = prefix;
+        tasks[i].start = (i == 0) ? path_start : split_keys[i - 1];
+        tasks[i].end = (i == range_num - 1) ? path_end : split_keys[i];
+        tasks[i].mode = mode;
+        tasks[i].is_ok = false;
+    }
+
+    for (uint32_t i = 0; i < helper_num; ++i) {
+        GetListThreadPool()->AddTask(NewClosure(&SDK::ListRanges, context));
+    }
+    while (ListNextRange(context)) {
+    }
+    while (true) {
+        {
+            MutexLocker lock(context->mutex);
+            if (context->finish_num == range_num) {
+                break;
+            }
+        }
+        context->done_event.Wait();
+    }
+
+    bool is_ok = true;
+    for (uint32_t i = 0; i < range_num; ++i) {
+        if (!tasks[i].is_ok) {
+            *err = tasks[i].err;
+            is_ok = false;
+            break;
+        }
+        list->insert(list->end(), tasks[i].list.begin(), tasks[i].list.end());
+    }
+    context->DecRef();
+    return is_ok;
+}
+
+bool SDK::AsyncRead(void* buf, uint32_t buf_size, IoCallback* callback,
+                    ErrorCode* err) {
+    AsyncIo* io = new AsyncIo;
+    io->type = AsyncIo::kRead;
+    io->buf = buf;
+    io->buf_size = buf_size;
+    io->offset = 0;
+    io->callback = callback;
+    return SubmitAsyncIo(io, err);
+}
+
+bool SDK::AsyncPread(void* buf, uint32_t buf_size, int64_t offset,
+                     IoCallback* callback, ErrorCode* err) {
+    AsyncIo* io = new AsyncIo;
+    io->type = AsyncIo::kPread;
+    io->buf = buf;
+    io->buf_size = buf_size;
+    io->offset = offset;
+    io->callback = callback;
+    return SubmitAsyncIo(io, err);
+}
+
+bool SDK::AsyncWrite(void* buf, uint32_t buf_size, IoCallback* callback,
+                     ErrorCode* err) {
+    AsyncIo* io = new AsyncIo;
+    io->type = AsyncIo::kWrite;
+    io->buf = buf;
+    io->buf_size = buf_size;
+    io->offset = 0;
+    io->callback = callback;
+    return SubmitAsyncIo(io, err);
+}
+
+void SDK::WaitAsyncIo() {
+    CHECK(s_callback_handle != this)
+        << "async callback waits or deletes its own handle";
+    while (true) {
+        {
+            MutexLocker lock(m_async_mutex);
+            if (m_async_num == 0) {
+                return;
+            }
+        }
+        m_async_done_event.Wait();
+    }
+}
+
+bool SDK::SubmitAsyncIo(AsyncIo* io, ErrorCode* err) {
+    CHECK(io->callback != NULL);
+    MutexLocker lock(m_async_mutex);
+    if (m_async_num >= static_cast<uint32_t>(FLAGS_rsfs_sdk_async_max_depth)) {
+        delete io;
+        err->SetFailed(ErrorCode::kBusy, "too many outstanding async io");
+        return false;
+    }
+    m_async_num++;
+    if (io->type == AsyncIo::kPread && IsPreadConcurrent()) {
+        GetAsyncThreadPool()->AddTask(NewClosure(this, &SDK::RunAsyncPread, io));
+        return true;
+    }
+    m_async_queue.push_back(io);
+    if (!m_is_async_running) {
+        m_is_async_running = true;
+        GetAsyncThreadPool()->AddTask(NewClosure(this, &SDK::RunAsyncIo));
+    }
+    return true;
+}
+
+void SDK::RunAsyncIo() {
+    AsyncIo* io = NULL;
+    {
+        MutexLocker lock(m_async_mutex);
+        io = m_async_queue.front();
+        m_async_queue.pop_front();
+    }
+    while (io != NULL) {
+        FinishAsyncIo(io);
+        io = NULL;
+
+        // the handle may be closed once the lock is released with no
+        // io left, touch nothing after
+        MutexLocker lock(m_async_mutex);
+        m_async_num--;
+        m_async_done_event.Set();
+        if (m_async_queue.empty()) {
+            m_is_async_running = false;
+        } else {
+            io = m_async_queue.front();
+            m_async_queue.pop_front();
+        }
+    }
+}
+
+void SDK::RunAsyncPread(AsyncIo* io) {
+    FinishAsyncIo(io);
+    // as above, the handle may go once the lock is released
+    MutexLocker lock(m_async_mutex);
+    m_async_num--;
+    m_async_done_event.Set();
+}
+
+void SDK::FinishAsyncIo(AsyncIo* io) {
+    ErrorCode err;
+    int64_t ret = -1;
+    if (io->type == AsyncIo::kRead) {
+        ret = Read(io->buf, io->buf_size, &err);
+    } else if (io->type == AsyncIo::kPread) {
+        ret = Read(io->buf, io->buf_size, io->offset, &err);
+    } else {
+        ret = Write(io->buf, io->buf_size, &err);
+    }
+    s_callback_handle = this;
+    io->callback->Run(ret, &err);
+    s_callback_handle = NULL;
+    delete io;
+}
+
+void SDK::ListContext::DecRef() {
+    if (atomic_dec_ret_old(&ref_count) == 1) {
+        delete this;
+    }
+}
+
+bool SDK::ListNextRange(ListContext* context) {
+    ListRangeTask* task = NULL;
+    {
+        MutexLocker lock(context->mutex);
+        if (context->next_no == context->tasks.size()) {
+            return false;
+        }
+        task = &context->tasks[context->next_no++];
+    }
+    scoped_ptr<SDK> sdk_impl(CreateSDKImpl(task->prefix));
+    std::string path_start = task->start;
     std::string last_one;
-    return Listx(sdk_impl.get(), full_path + "#", full_path + "~", &last_one, list,
-                 err);
+    task->is_ok = true;
+    while (path_start != task->end) {
+        if (!Listx(sdk_impl.get(), path_start, task->end, &last_one,
+                   &task->list, &task->err, task->mode)) {
+            task->is_ok = false;
+            break;
+        }
+        path_start = last_one;
+    }
+    {
+        MutexLocker lock(context->mutex);
+        ++context->finish_num;
+    }
+    context->done_event.Set();
+    return true;
+}
+
+void SDK::ListRanges(ListContext* context) {
+    while (ListNextRange(context)) {
+    }
+    context->DecRef();
 }
 
 bool SDK::Listx(SDK* sdk_impl, const std::string& start, const std::string& end,
                 std::string* last_one, std::vector<TreeNode>* list,
-                ErrorCode* err) {
-    return sdk_impl->ListImpl(start, end, last_one, list, err);
+                ErrorCode* err, ListMode mode) {
+    return sdk_impl->ListImpl(start, end, last_one, list, err, mode);
 }
 
 } // namespace sdk
@@ -7,9 +7,17 @@
 #ifndef RSFS_SDK_SDK_H
 #define RSFS_SDK_SDK_H
 
+#include <deque>
+#include <string>
+#include <vector>
+
 #include "common/base/class_register.h"
+#include "common/base/closure.h"
 #include "common/base/stdint.h"
+#include "common/lock/event.h"
+#include "common/lock/mutex.h"
 
+#include "rsfs/proto/master_rpc.pb.h"
 #include "rsfs/proto/meta_tree.pb.h"
 #include "rsfs/sdk/error_code.h"
 
@@ -18,8 +26,21 @@ namespace sdk {
 
 class SDK {
 public:
-    SDK() {}
-    virtual ~SDK() {}
+    // which part of meta is listed
+    enum ListMode {
+        kListName = 1,      // name only
+        kListSummary = 2,   // all but the chunk locations
+        kListFull = 3
+    };
+
+    // the completion of an async io, with the bytes done (-1 if failed)
+    // and the error, which is valid only during the call
+    typedef Closure<void, int64_t, ErrorCode*> IoCallback;
+
+    // a handle keeps the sdk runtime up during its life
+    SDK();
+    // the async io left are waited, see WaitAsyncIo
+    virtual ~SDK();
 
     static SDK* Open(const std::string& file_path,
                      const std::string& mode,
@@ -36,18 +57,53 @@ public:
 
     virtual int64_t GetSize(ErrorCode* err) = 0;
 
+    // the async io of a handle are run in the order of submit on the
+    // sdk threads, the caller is not blocked. the preads of a handle
+    // supporting concurrent pread are run at once instead, in no
+    // order. at most rsfs_sdk_async_max_depth io are outstanding per
+    // handle, beyond which the submit fails with kBusy and callback is
+    // not run. buf must be kept until callback runs
+    bool AsyncRead(void* buf, uint32_t buf_size, IoCallback* callback,
+                   ErrorCode* err);
+
+    bool AsyncPread(void* buf, uint32_t buf_size, int64_t offset,
+                    IoCallback* callback, ErrorCode* err);
+
+    bool AsyncWrite(void* buf, uint32_t buf_size, IoCallback* callback,
+                    ErrorCode* err);
+
+    // wait the outstanding async io and their callbacks, call it before
+    // Close. a callback must not wait or delete its own handle, as it
+    // is one of those waited
+    void WaitAsyncIo();
+
     static bool IsExist(const std::string& full_path, ErrorCode* err);
 
+    // stat files of the same storage with batched meta requests,
+    // stats[i] is for paths[i] and its status is kMasterOk if exists
+    static bool BatchStat(const std::vector<std::string>& paths,
+                          std::vector<FileStat>* stats, ErrorCode* err);
+
     static bool Copy(const std::string& src_path, const std::string& dst_path);
 
+    // remove returns once meta is dropped, the blocks are reclaimed by
+    // master in background. with is_recusive, files under full_path
+    // are removed as well
     static bool Remove(const std::string& full_path, bool is_recusive = false,
                        ErrorCode* err = NULL);
 
     static bool List(const std::string& full_path, std::vector<TreeNode>* list,
-                     ErrorCode* err);
+                     ErrorCode* err, ListMode mode = kListFull);
     static bool Listx(SDK* sdk_impl, const std::string& start, const std::string& end,
                       std::string* last_one, std::vector<TreeNode>* list,
-                      ErrorCode* err);
+                      ErrorCode* err, ListMode mode = kListFull);
+
+    // list the sub-ranges split by master concurrently,
+    // the result is in path order as List()
+    static bool ParallelList(const std::string& full_path,
+                             std::vector<TreeNode>* list, ErrorCode* err,
+                             ListMode mode = kListFull,
+                             uint32_t parallel_num = 0);
 
     virtual std::string GetImplName() = 0;
 
@@ -59,7 +115,90 @@ protected:
                           ErrorCode* err) = 0;
     virtual bool ListImpl(const std::string& start, const std::string& end,
                           std::string* last_one, std::vector<TreeNode>* list,
-                          ErrorCode* err) = 0;
+                          ErrorCode* err, ListMode mode) = 0;
+    virtual bool StatImpl(const std::vector<std::string>& paths,
+                          std::vector<FileStat>* stats, ErrorCode* err) {
+        err->SetFailed(ErrorCode::kNotImpl, "stat not supported");
+        return false;
+    }
+    virtual bool RemoveImpl(const std::string& file_path, ErrorCode* err) {
+        err->SetFailed(ErrorCode::kNotImpl, "remove not supported");
+        return false;
+    }
+    // the files under dir_path, which are removed before it. the meta
+    // range of dir_path + "/" is listed by default
+    virtual bool ListTreeImpl(const std::string& dir_path,
+                              std::vector<TreeNode>* list, ErrorCode* err);
+    // whether Read with offset may run concurrently on the handle
+    virtual bool IsPreadConcurrent() {
+        return false;
+    }
+    // no split by default, the whole range is listed as one
+    virtual bool SplitImpl(const std::string& start, const std::string& end,
+                           uint32_t split_num,
+                           std::vector<std::string>* split_keys,
+                           ErrorCode* err) {
+        return true;
+    }
+
+private:
+    struct AsyncIo {
+        enum Type {
+            kRead = 1,
+            kPread = 2,
+            kWrite = 3
+        };
+        Type type;
+        void* buf;
+        uint32_t buf_size;
+        int64_t offset;
+        IoCallback* callback;
+    };
+
+    bool SubmitAsyncIo(AsyncIo* io, ErrorCode* err);
+    // drain the queue of handle, one runner per handle at a time
+    void RunAsyncIo();
+    // a pread run apart from the queue
+    void RunAsyncPread(AsyncIo* io);
+    // do io and run its callback, the handle is alive all the time
+    // as io is counted until it returns
+    void FinishAsyncIo(AsyncIo* io);
+
+    Mutex m_async_mutex;
+    AutoResetEvent m_async_done_event;
+    std::deque<AsyncIo*> m_async_queue;
+    uint32_t m_async_num;
+    bool m_is_async_running;
+
+private:
+    struct ListRangeTask {
+        std::string prefix;
+        std::string start;
+        std::string end;
+        ListMode mode;
+        std::vector<TreeNode> list;
+        ErrorCode err;
+        bool is_ok;
+    };
+    // the ranges of one parallel list, claimed one by one by the lister
+    // and the helpers on the shared async pool. it is released by the
+    // last of them, as a helper may start after the list is done
+    struct ListContext {
+        std::vector<ListRangeTask> tasks;
+        Mutex mutex;
+        AutoResetEvent done_event;
+        // the next range to claim, and the ranges listed
+        uint32_t next_no;
+        uint32_t finish_num;
+        volatile int32_t ref_count;
+
+        ListContext(uint32_t range_num, int32_t ref)
+            : tasks(range_num), next_no(0), finish_num(0), ref_count(ref) {}
+        void DecRef();
+    };
+    // list the next range not claimed, false if none is left
+    static bool ListNextRange(ListContext* context);
+    static void ListRanges(ListContext* context);
 };
 
 CLASS_REGISTER_DEFINE_REGISTRY(CommonSDK, rsfs::sdk::SDK);
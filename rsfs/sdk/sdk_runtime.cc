@@ -0,0 +1,169 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/sdk/sdk_runtime.h"
+
+#include "common/lock/mutex.h"
+#include "common/thread/this_thread.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/rpc_client_async.h"
+#include "rsfs/snode/snode_client_async.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int32(rsfs_sdk_thread_min_num);
+DECLARE_int32(rsfs_sdk_thread_max_num);
+DECLARE_bool(rsfs_sdk_rpc_limit_enabled);
+DECLARE_int32(rsfs_sdk_rpc_limit_max_inflow);
+DECLARE_int32(rsfs_sdk_rpc_limit_max_outflow);
+DECLARE_int32(rsfs_sdk_rpc_max_pending_buffer_size);
+DECLARE_int32(rsfs_sdk_rpc_work_thread_num);
+DECLARE_int32(rsfs_sdk_meta_cache_num);
+DECLARE_int32(rsfs_sdk_retry_tick_period);
+DECLARE_int32(rsfs_sdk_retry_thread_num);
+DECLARE_int32(rsfs_sdk_async_thread_num);
+DECLARE_int32(rsfs_sdk_list_thread_num);
+DECLARE_int32(rsfs_sdk_shutdown_timeout);
+DECLARE_int64(rsfs_sdk_write_lease_renew_period);
+
+namespace rsfs {
+namespace sdk {
+
+const uint32_t kRetryWheelSlotNum = 512;
+const int32_t kDrainCheckPeriod = 10;
+
+SdkRuntime* volatile SdkRuntime::m_runtime = NULL;
+
+static Mutex* GetInitMutex() {
+    static Mutex init_mutex;
+    return &init_mutex;
+}
+
+SdkRuntime* SdkRuntime::Init() {
+    MutexLocker lock(*GetInitMutex());
+    return InitLocked();
+}
+
+SdkRuntime* SdkRuntime::InitLocked() {
+    if (m_runtime == NULL) {
+        m_runtime = new SdkRuntime();
+    }
+    return m_runtime;
+}
+
+bool SdkRuntime::Shutdown() {
+    MutexLocker lock(*GetInitMutex());
+    if (m_runtime == NULL) {
+        return true;
+    }
+    if (m_runtime->m_handle_num > 0) {
+        LOG(ERROR) << "fail to shutdown sdk, handles alive: "
+            << m_runtime->m_handle_num;
+        return false;
+    }
+    // the calls left by closed handles, e.g. the CloseScan of scans, the
+    // cancelled slice reads and the retries, still refer the callback
+    // pool and the wheel. they are bounded by the rpc timeout
+    int64_t start_ms = utils::GetMillis();
+    while (GetRpcInflightNum() > 0
+           || m_runtime->m_retry_wheel->GetTaskNum() > 0) {
+        if (utils::GetMillis() - start_ms > FLAGS_rsfs_sdk_shutdown_timeout) {
+            LOG(ERROR) << "fail to shutdown sdk, rpcs in flight: "
+                << GetRpcInflightNum() << ", retries: "
+                << m_runtime->m_retry_wheel->GetTaskNum();
+            return false;
+        }
+        ThisThread::Sleep(kDrainCheckPeriod);
+    }
+    LOG(INFO) << "sdk rpcs drained in " << utils::GetMillis() - start_ms << " ms";
+    SdkRuntime* runtime = m_runtime;
+    m_runtime = NULL;
+    delete runtime;
+    return true;
+}
+
+SdkRuntime* SdkRuntime::Get() {
+    // no lock, the callers keep it from being deleted, see Shutdown
+    SdkRuntime* runtime = m_runtime;
+    CHECK(runtime != NULL) << "sdk runtime is used without a handle";
+    return runtime;
+}
+
+SdkRuntime* SdkRuntime::Attach() {
+    MutexLocker lock(*GetInitMutex());
+    SdkRuntime* runtime = InitLocked();
+    runtime->m_handle_num++;
+    return runtime;
+}
+
+void SdkRuntime::Detach() {
+    MutexLocker lock(*GetInitMutex());
+    CHECK(m_runtime != NULL && m_runtime->m_handle_num > 0);
+    m_runtime->m_handle_num--;
+}
+
+SdkRuntime::SdkRuntime()
+    : m_handle_num(0),
+      m_rpc_thread_pool(new ThreadPool(FLAGS_rsfs_sdk_thread_min_num,
+                                       FLAGS_rsfs_sdk_thread_max_num)),
+      m_async_thread_pool(new ThreadPool(1, FLAGS_rsfs_sdk_async_thread_num)),
+      m_list_thread_pool(new ThreadPool(1, FLAGS_rsfs_sdk_list_thread_num)),
+      m_retry_wheel(new utils::TimerWheel(FLAGS_rsfs_sdk_retry_tick_period,
+                                          kRetryWheelSlotNum,
+                                          FLAGS_rsfs_sdk_retry_thread_num)),
+      m_meta_lease_cache(new MetaLeaseCache(FLAGS_rsfs_sdk_meta_cache_num)),
+      m_write_lease_keeper(new WriteLeaseKeeper(FLAGS_rsfs_sdk_write_lease_renew_period)) {
+    snode::SNodeClientAsync::SetThreadPool(m_rpc_thread_pool.get());
+    snode::SNodeClientAsync::SetRpcOption(
+        FLAGS_rsfs_sdk_rpc_limit_enabled ? FLAGS_rsfs_sdk_rpc_limit_max_inflow : -1,
+        FLAGS_rsfs_sdk_rpc_limit_enabled ? FLAGS_rsfs_sdk_rpc_limit_max_outflow : -1,
+        FLAGS_rsfs_sdk_rpc_max_pending_buffer_size, FLAGS_rsfs_sdk_rpc_work_thread_num);
+    LOG(INFO) << "sdk runtime is up";
+}
+
+SdkRuntime::~SdkRuntime() {
+    // no call is in flight or waiting retry here, see Shutdown
+    m_retry_wheel.reset();
+    m_async_thread_pool.reset();
+    m_list_thread_pool.reset();
+    // the pool is not referred by any call now
+    snode::SNodeClientAsync::SetThreadPool(NULL);
+    m_rpc_thread_pool.reset();
+    LOG(INFO) << "sdk runtime is down";
+}
+
+ThreadPool* SdkRuntime::GetRpcThreadPool() {
+    return m_rpc_thread_pool.get();
+}
+
+ThreadPool* SdkRuntime::GetAsyncThreadPool() {
+    return m_async_thread_pool.get();
+}
+
+ThreadPool* SdkRuntime::GetListThreadPool() {
+    return m_list_thread_pool.get();
+}
+
+utils::TimerWheel* SdkRuntime::GetRetryWheel() {
+    return m_retry_wheel.get();
+}
+
+MetaLeaseCache* SdkRuntime::GetMetaLeaseCache() {
+    return m_meta_lease_cache.get();
+}
+
+WriteLeaseKeeper* SdkRuntime::GetWriteLeaseKeeper() {
+    return m_write_lease_keeper.get();
+}
+
+int32_t SdkRuntime::GetHandleNum() {
+    MutexLocker lock(*GetInitMutex());
+    return m_handle_num;
+}
+
+} // namespace sdk
+} // namespace rsfs
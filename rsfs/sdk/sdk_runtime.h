@@ -0,0 +1,83 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SDK_SDK_RUNTIME_H
+#define RSFS_SDK_SDK_RUNTIME_H
+
+#include "common/base/scoped_ptr.h"
+#include "common/base/stdint.h"
+#include "common/thread/thread_pool.h"
+
+#include "rsfs/sdk/meta_lease_cache.h"
+#include "rsfs/sdk/write_lease_keeper.h"
+#include "rsfs/utils/timer_wheel.h"
+
+namespace rsfs {
+namespace sdk {
+
+// the state shared by all file handles of the process: the threads of
+// rpc callbacks, async io and retries, the rpc client options and the
+// meta cache and the write leases. it is set up once with the flags at that time, so that
+// opening a file costs no thread, and the static rpc options are not
+// rewritten by every handle.
+class SdkRuntime {
+public:
+    // set up the runtime if not yet, it is done by the first handle
+    // otherwise. call it to start the threads at a known time
+    static SdkRuntime* Init();
+
+    // stop the threads and drop the caches once the rpcs in flight are
+    // called back. it fails if any handle is still alive, or the rpcs
+    // are not drained in rsfs_sdk_shutdown_timeout ms. the next Init or
+    // handle sets up a new runtime
+    static bool Shutdown();
+
+    // the runtime, only valid while a handle is alive, or in the rpc
+    // callbacks and retries of handles, which Shutdown drains first
+    static SdkRuntime* Get();
+
+    // a handle keeps the runtime from shutdown during its life
+    static SdkRuntime* Attach();
+    static void Detach();
+
+    ThreadPool* GetRpcThreadPool();
+    ThreadPool* GetAsyncThreadPool();
+    ThreadPool* GetListThreadPool();
+    utils::TimerWheel* GetRetryWheel();
+    MetaLeaseCache* GetMetaLeaseCache();
+    WriteLeaseKeeper* GetWriteLeaseKeeper();
+
+    // the number of handles alive
+    int32_t GetHandleNum();
+
+private:
+    SdkRuntime();
+    ~SdkRuntime();
+
+    // called with the init mutex held
+    static SdkRuntime* InitLocked();
+
+private:
+    static SdkRuntime* volatile m_runtime;
+
+    int32_t m_handle_num;
+    // the rpc callbacks run here, off the network threads of rpc
+    scoped_ptr<ThreadPool> m_rpc_thread_pool;
+    // a handle takes at most one of the async threads at a time
+    scoped_ptr<ThreadPool> m_async_thread_pool;
+    // the parallel lists, apart from the async io which blocks its
+    // threads on the block rpcs
+    scoped_ptr<ThreadPool> m_list_thread_pool;
+    // the failed block rpcs wait their backoff here
+    scoped_ptr<utils::TimerWheel> m_retry_wheel;
+    scoped_ptr<MetaLeaseCache> m_meta_lease_cache;
+    scoped_ptr<WriteLeaseKeeper> m_write_lease_keeper;
+};
+
+} // namespace sdk
+} // namespace rsfs
+
+#endif // RSFS_SDK_SDK_RUNTIME_H
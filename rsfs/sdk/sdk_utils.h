@@ -1,21 +0,0 @@
-// Copyright (C) 2017, for RSFS Authors.
-// Author: An Qin (anqin.qin@gmail.com)
-//
-// Description:
-//
-
-#ifndef RSFS_SDK_SDK_UTILS_H
-#define RSFS_SDK_SDK_UTILS_H
-
-#include <stdint.h>
-
-namespace rsfs {
-namespace sdk {
-
-uint64_t BlockFileName(uint64_t fid, uint32_t block_no);
-
-
-} // namespace sdk
-} // namespace rsfs
-
-#endif // RSFS_SDK_SDK_UTILS_H
@@ -0,0 +1,89 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/sdk/write_lease_keeper.h"
+
+#include <vector>
+
+#include "common/base/closure.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/master/master_client.h"
+#include "rsfs/proto/proto_helper.h"
+#include "rsfs/types.h"
+
+namespace rsfs {
+namespace sdk {
+
+WriteLeaseKeeper::WriteLeaseKeeper(int64_t renew_period_ms)
+    : m_master_client(new master::MasterClient()),
+      m_renew_timer_id(kInvalidTimerId) {
+    if (renew_period_ms > 0) {
+        m_renew_timer_id = m_timer_manager.AddPeriodTimer(
+            renew_period_ms,
+            NewPermanentClosure(this, &WriteLeaseKeeper::Renew));
+    }
+}
+
+WriteLeaseKeeper::~WriteLeaseKeeper() {
+    if (m_renew_timer_id != kInvalidTimerId) {
+        m_timer_manager.RemoveTimer(m_renew_timer_id);
+    }
+}
+
+void WriteLeaseKeeper::Add(uint64_t fid) {
+    MutexLocker lock(m_mutex);
+    m_leases[fid] = false;
+}
+
+void WriteLeaseKeeper::Remove(uint64_t fid) {
+    MutexLocker lock(m_mutex);
+    m_leases.erase(fid);
+}
+
+bool WriteLeaseKeeper::IsLost(uint64_t fid) {
+    MutexLocker lock(m_mutex);
+    std::map<uint64_t, bool>::iterator it = m_leases.find(fid);
+    return it != m_leases.end() && it->second;
+}
+
+void WriteLeaseKeeper::Renew(uint64_t timer_id) {
+    RenewLeaseRequest request;
+    RenewLeaseResponse response;
+    request.set_sequence_id(0);
+    {
+        MutexLocker lock(m_mutex);
+        std::map<uint64_t, bool>::iterator it = m_leases.begin();
+        for (; it != m_leases.end(); ++it) {
+            if (!it->second) {
+                request.add_fids(it->first);
+            }
+        }
+    }
+    if (request.fids_size() == 0) {
+        return;
+    }
+    // a failed round is retried in next period, the lease on master
+    // lasts several periods
+    if (!m_master_client->RenewLease(&request, &response)
+        || response.status() != kMasterOk) {
+        LOG(WARNING) << "fail to renew write lease of " << request.fids_size()
+            << " files, status: " << StatusCodeToString(response.status());
+        return;
+    }
+    MutexLocker lock(m_mutex);
+    for (int32_t i = 0; i < response.lost_fids_size(); ++i) {
+        std::map<uint64_t, bool>::iterator it =
+            m_leases.find(response.lost_fids(i));
+        if (it != m_leases.end()) {
+            LOG(ERROR) << "write lease lost, fid: " << it->first;
+            it->second = true;
+        }
+    }
+}
+
+} // namespace sdk
+} // namespace rsfs
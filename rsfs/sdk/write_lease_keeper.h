@@ -0,0 +1,55 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SDK_WRITE_LEASE_KEEPER_H
+#define RSFS_SDK_WRITE_LEASE_KEEPER_H
+
+#include <map>
+
+#include "common/base/scoped_ptr.h"
+#include "common/base/stdint.h"
+#include "common/lock/mutex.h"
+#include "common/timer/timer_manager.h"
+
+namespace rsfs {
+namespace master {
+class MasterClient;
+} // namespace master
+
+namespace sdk {
+
+// renews the write lease of the files open for write in the process,
+// so that master does not seal or remove a file under an idle writer.
+// a file reported as not open any more is marked lost, its writer is
+// fenced and fails the later writes and close.
+class WriteLeaseKeeper {
+public:
+    // no renewal if renew_period_ms <= 0
+    WriteLeaseKeeper(int64_t renew_period_ms);
+    ~WriteLeaseKeeper();
+
+    void Add(uint64_t fid);
+    void Remove(uint64_t fid);
+    bool IsLost(uint64_t fid);
+
+private:
+    void Renew(uint64_t timer_id);
+
+private:
+    mutable Mutex m_mutex;
+    // fid -> whether the lease is lost
+    std::map<uint64_t, bool> m_leases;
+
+    // only used by the renew timer
+    scoped_ptr<master::MasterClient> m_master_client;
+    TimerManager m_timer_manager;
+    uint64_t m_renew_timer_id;
+};
+
+} // namespace sdk
+} // namespace rsfs
+
+#endif // RSFS_SDK_WRITE_LEASE_KEEPER_H
@@ -6,17 +6,25 @@
 
 #include "rsfs/snode/block_manager.h"
 
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "common/base/string_number.h"
 #include "common/file/file_types.h"
 #include "thirdparty/glog/logging.h"
 
+#include "rsfs/utils/utils_cmd.h"
+
 DECLARE_string(rsfs_snode_path_prefix);
 
 namespace rsfs {
 namespace snode {
 
 BlockStream::BlockStream(FileStream* stream, Type type)
-    : m_stream(stream), m_type(type), m_ref_count(1) {}
+    : m_stream(stream), m_type(type), m_ref_count(1),
+      m_last_active_ms(utils::GetMillis()) {}
 
 BlockStream::~BlockStream() {}
 
@@ -28,6 +36,10 @@ BlockStream::Type BlockStream::GetType() const {
     return m_type;
 }
 
+Mutex* BlockStream::GetIoMutex() {
+    return &m_io_mutex;
+}
+
 int32_t BlockStream::AddRef() {
     MutexLocker lock(m_mutex);
     ++m_ref_count;
@@ -50,13 +62,24 @@ int32_t BlockStream::GetRef() const {
     return m_ref_count;
 }
 
+void BlockStream::Touch() {
+    int64_t now = utils::GetMillis();
+    MutexLocker lock(m_mutex);
+    m_last_active_ms = now;
+}
+
+int64_t BlockStream::GetLastActiveTime() const {
+    MutexLocker lock(m_mutex);
+    return m_last_active_ms;
+}
+
 BlockManager::BlockManager() {}
 
 BlockManager::~BlockManager() {}
 
 
 bool BlockManager::NewBlockStream(uint64_t block_id, BlockStream::Type type) {
-    std::string path = FLAGS_rsfs_snode_path_prefix + "/" + NumberToString(block_id);
+    std::string path = GetBlockPath(block_id);
     FileErrorCode err = kFileSuccess;
     FileStream* file = new FileStream;
 
@@ -113,6 +136,91 @@ bool BlockManager::RemoveBlockStream(uint64_t block_id) {
     return true;
 }
 
+bool BlockManager::DeleteBlock(uint64_t block_id) {
+    BlockStream* stream = NULL;
+    {
+        MutexLocker lock(m_mutex_list);
+        std::map<uint64_t, BlockStream*>::iterator it =
+            m_block_io.find(block_id);
+        if (it != m_block_io.end()) {
+            // an append may be in flight on the stream, defer the
+            // delete until the writer closes it, master sends it again
+            if (it->second->GetType() == BlockStream::APPEND) {
+                LOG(WARNING) << "block [id: " << block_id
+                    << "] is open for append, delete deferred";
+                return false;
+            }
+            stream = it->second;
+            m_block_io.erase(it);
+        }
+    }
+    if (stream != NULL) {
+        LOG(WARNING) << "block [id: " << block_id << "] deleted while open";
+        stream->DecRef();
+    }
+
+    std::string path = GetBlockPath(block_id);
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        LOG(ERROR) << "fail to unlink block [id: " << block_id
+            << "], err: " << strerror(errno);
+        return false;
+    }
+    VLOG(5) << "block #" << block_id << " deleted";
+    return true;
+}
+
+FileStream* BlockManager::OpenBlockFile(uint64_t block_id, uint64_t offset) {
+    std::string path = GetBlockPath(block_id);
+    FileErrorCode err = kFileSuccess;
+    FileStream* file = new FileStream;
+    if (!file->Open(path, FILE_READ, &err)) {
+        LOG(ERROR) << "fail to open block [id: " << block_id
+            << "], err: " << err;
+        delete file;
+        return NULL;
+    }
+    if (offset > 0 && file->Seek(offset, SEEK_SET, &err) < 0) {
+        LOG(ERROR) << "fail to seek block [id: " << block_id
+            << "] to " << offset << ", err: " << err;
+        delete file;
+        return NULL;
+    }
+    return file;
+}
+
+bool BlockManager::GetBlockSize(uint64_t block_id, int64_t* size) {
+    std::string path = GetBlockPath(block_id);
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        if (errno == ENOENT) {
+            *size = -1;
+            return true;
+        }
+        LOG(ERROR) << "fail to stat block [id: " << block_id
+            << "], err: " << strerror(errno);
+        return false;
+    }
+    *size = st.st_size;
+    return true;
+}
+
+void BlockManager::GetWritingBlocks(int64_t since_ms,
+                                    std::vector<uint64_t>* block_ids) {
+    MutexLocker lock(m_mutex_list);
+    std::map<uint64_t, BlockStream*>::iterator it = m_block_io.begin();
+    for (; it != m_block_io.end(); ++it) {
+        BlockStream* stream = it->second;
+        if (stream->GetType() == BlockStream::APPEND
+            && stream->GetLastActiveTime() >= since_ms) {
+            block_ids->push_back(it->first);
+        }
+    }
+}
+
+std::string BlockManager::GetBlockPath(uint64_t block_id) const {
+    return FLAGS_rsfs_snode_path_prefix + "/" + NumberToString(block_id);
+}
+
 } // namespace snode
 } // namespace rsfs
 
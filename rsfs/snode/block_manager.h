@@ -9,6 +9,8 @@
 #define RSFS_SNODE_BLOCK_MANAGER_H
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "common/file/file_stream.h"
 #include "common/lock/mutex.h"
@@ -28,17 +30,26 @@ public:
 
     FileStream* GetFileStream();
     Type GetType() const;
+    // held across the seek and read of a positional read, as the
+    // file position is shared by the requests on stream
+    Mutex* GetIoMutex();
 
     int32_t AddRef();
     int32_t DecRef();
     int32_t GetRef() const;
 
+    // record an io on stream, for idle detection
+    void Touch();
+    int64_t GetLastActiveTime() const;
+
 private:
     mutable Mutex m_mutex;
+    Mutex m_io_mutex;
     FileStream* m_stream;
 
     Type m_type;
     int32_t m_ref_count;
+    int64_t m_last_active_ms;
 };
 
 class BlockManager {
@@ -51,6 +62,24 @@ public:
     bool AddBlockStream(uint64_t block_id, BlockStream* stream);
     bool RemoveBlockStream(uint64_t block_id);
 
+    // drop the open read stream if any and unlink the block file,
+    // deleting a missing block is regarded as success, while a block
+    // open for append is not deleted and false is returned
+    bool DeleteBlock(uint64_t block_id);
+
+    // a private read handle of block file, not shared by the streams,
+    // positioned at offset. the caller owns it, NULL if fail
+    FileStream* OpenBlockFile(uint64_t block_id, uint64_t offset);
+
+    // the size (in bytes) of block file, -1 if not exist
+    bool GetBlockSize(uint64_t block_id, int64_t* size);
+
+    // append streams with io since since_ms (in ms)
+    void GetWritingBlocks(int64_t since_ms, std::vector<uint64_t>* block_ids);
+
+private:
+    std::string GetBlockPath(uint64_t block_id) const;
+
 private:
     mutable Mutex m_mutex_list;
     std::map<uint64_t, BlockStream*> m_block_io;
@@ -0,0 +1,328 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/snode/block_scanner.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/base/closure.h"
+#include "common/file/file_types.h"
+#include "thirdparty/gflags/gflags.h"
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/snode/block_manager.h"
+#include "rsfs/snode/load_collector.h"
+#include "rsfs/utils/utils_cmd.h"
+
+DECLARE_int32(rsfs_snode_thread_min_num);
+DECLARE_int32(rsfs_snode_scan_thread_num);
+DECLARE_int32(rsfs_snode_scan_idle_timeout);
+DECLARE_int32(rsfs_snode_scan_max_buffer_size);
+
+namespace rsfs {
+namespace snode {
+
+const uint64_t kMaxScanChunkSize = 64 * 1024 * 1024;
+
+static void DeleteScanData(std::deque<std::string*>* chunks, FileStream* file) {
+    for (uint32_t i = 0; i < chunks->size(); ++i) {
+        delete (*chunks)[i];
+    }
+    chunks->clear();
+    delete file;
+}
+
+BlockScanner::BlockScanner(BlockManager* block_manager,
+                           LoadCollector* load_collector)
+    : m_block_manager(block_manager), m_load_collector(load_collector),
+      m_next_scan_id(0),
+      m_thread_pool(new ThreadPool(FLAGS_rsfs_snode_thread_min_num,
+                                   FLAGS_rsfs_snode_scan_thread_num)) {
+    int64_t period = std::max(1000, FLAGS_rsfs_snode_scan_idle_timeout / 2);
+    m_idle_timer_id = m_timer_manager.AddPeriodTimer(
+        period, NewPermanentClosure(this, &BlockScanner::CheckIdleScans));
+}
+
+BlockScanner::~BlockScanner() {
+    m_timer_manager.RemoveTimer(m_idle_timer_id);
+    // the read ahead in queue still refers the scans
+    m_thread_pool.reset();
+
+    std::vector<google::protobuf::Closure*> waiting_dones;
+    {
+        MutexLocker lock(m_mutex);
+        std::map<uint64_t, Scan*>::iterator it = m_scans.begin();
+        for (; it != m_scans.end(); ++it) {
+            Scan* scan = it->second;
+            if (scan->wait_done != NULL) {
+                scan->wait_response->set_status(kSNodeNotScan);
+                waiting_dones.push_back(scan->wait_done);
+            }
+            DeleteScanData(&scan->chunks, scan->file);
+            delete scan;
+        }
+        m_scans.clear();
+    }
+    for (uint32_t i = 0; i < waiting_dones.size(); ++i) {
+        waiting_dones[i]->Run();
+    }
+}
+
+void BlockScanner::OpenScan(const OpenScanRequest* request,
+                            OpenScanResponse* response,
+                            google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+    if (request->chunk_size() == 0 || request->chunk_size() > kMaxScanChunkSize
+        || request->credit() < 0) {
+        LOG(ERROR) << "bad scan of block [id: " << request->block_id()
+            << "], chunk size: " << request->chunk_size()
+            << ", credit: " << request->credit();
+        response->set_status(kBadParameter);
+        done->Run();
+        return;
+    }
+    FileStream* file = m_block_manager->OpenBlockFile(request->block_id(),
+                                                      request->offset());
+    if (file == NULL) {
+        response->set_status(kIOError);
+        done->Run();
+        return;
+    }
+
+    Scan* scan = new Scan;
+    scan->block_id = request->block_id();
+    scan->file = file;
+    scan->remain_size = request->length() > 0 ?
+        static_cast<int64_t>(request->length()) : -1;
+    scan->chunk_size = request->chunk_size();
+    scan->credit = request->credit();
+    scan->is_reading = false;
+    scan->is_eof = false;
+    scan->is_closed = false;
+    scan->status = kSNodeOk;
+    scan->wait_response = NULL;
+    scan->wait_done = NULL;
+    scan->last_access_ms = utils::GetMillis();
+    {
+        MutexLocker lock(m_mutex);
+        scan->scan_id = ++m_next_scan_id;
+        m_scans[scan->scan_id] = scan;
+        TryReadAhead(scan);
+        response->set_scan_id(scan->scan_id);
+    }
+    LOG(INFO) << "open scan #" << response->scan_id() << " on block [id: "
+        << request->block_id() << "], offset: " << request->offset()
+        << ", chunk size: " << request->chunk_size();
+    response->set_status(kSNodeOk);
+    done->Run();
+}
+
+void BlockScanner::ScanData(const ScanDataRequest* request,
+                            ScanDataResponse* response,
+                            google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+    google::protobuf::Closure* old_done = NULL;
+    google::protobuf::Closure* reply_done = NULL;
+    {
+        MutexLocker lock(m_mutex);
+        std::map<uint64_t, Scan*>::iterator it = m_scans.find(request->scan_id());
+        if (it == m_scans.end()) {
+            response->set_status(kSNodeNotScan);
+            reply_done = done;
+        } else {
+            Scan* scan = it->second;
+            scan->credit += std::max(0, request->credit());
+            scan->last_access_ms = utils::GetMillis();
+            // one waiting call per scan, the former one gets what is ready
+            if (scan->wait_done != NULL) {
+                FillResponse(scan, scan->wait_response);
+                old_done = scan->wait_done;
+                scan->wait_response = NULL;
+                scan->wait_done = NULL;
+            }
+            if (!scan->chunks.empty() || scan->is_eof
+                || scan->status != kSNodeOk
+                || (scan->credit <= 0 && !scan->is_reading)) {
+                FillResponse(scan, response);
+                reply_done = done;
+            } else {
+                scan->wait_response = response;
+                scan->wait_done = done;
+            }
+            TryReadAhead(scan);
+        }
+    }
+    if (old_done != NULL) {
+        old_done->Run();
+    }
+    if (reply_done != NULL) {
+        reply_done->Run();
+    }
+}
+
+void BlockScanner::CloseScan(const CloseScanRequest* request,
+                             CloseScanResponse* response,
+                             google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+    google::protobuf::Closure* wait_done = NULL;
+    {
+        MutexLocker lock(m_mutex);
+        std::map<uint64_t, Scan*>::iterator it = m_scans.find(request->scan_id());
+        if (it == m_scans.end()) {
+            response->set_status(kSNodeNotScan);
+        } else {
+            Scan* scan = it->second;
+            m_scans.erase(it);
+            if (scan->wait_done != NULL) {
+                scan->wait_response->set_status(kSNodeNotScan);
+                wait_done = scan->wait_done;
+            }
+            ReleaseScan(scan);
+            response->set_status(kSNodeOk);
+        }
+    }
+    if (wait_done != NULL) {
+        wait_done->Run();
+    }
+    LOG(INFO) << "close scan #" << request->scan_id();
+    done->Run();
+}
+
+void BlockScanner::TryReadAhead(Scan* scan) {
+    if (scan->is_reading || scan->is_eof || scan->is_closed
+        || scan->status != kSNodeOk || scan->credit <= 0) {
+        return;
+    }
+    // bound the memory of a client not consuming, whatever its credit
+    uint64_t max_buffer_size =
+        static_cast<uint64_t>(FLAGS_rsfs_snode_scan_max_buffer_size) << 20;
+    if (!scan->chunks.empty()
+        && (scan->chunks.size() + 1) * scan->chunk_size > max_buffer_size) {
+        return;
+    }
+    scan->is_reading = true;
+    m_thread_pool->AddTask(NewClosure(this, &BlockScanner::ReadAhead, scan));
+}
+
+void BlockScanner::ReadAhead(Scan* scan) {
+    // only one read ahead per scan at a time, the file is not shared
+    uint64_t size = scan->chunk_size;
+    if (scan->remain_size >= 0
+        && static_cast<uint64_t>(scan->remain_size) < size) {
+        size = scan->remain_size;
+    }
+    std::string* chunk = new std::string(size, '\0');
+    FileErrorCode err = kFileSuccess;
+    int64_t start_us = utils::GetMicros();
+    int64_t read_size = size > 0 ? scan->file->Read(&(*chunk)[0], size, &err) : 0;
+    if (read_size > 0) {
+        m_load_collector->AddRead(read_size, utils::GetMicros() - start_us);
+    }
+
+    google::protobuf::Closure* wait_done = NULL;
+    {
+        MutexLocker lock(m_mutex);
+        scan->is_reading = false;
+        if (scan->is_closed) {
+            delete chunk;
+            DeleteScanData(&scan->chunks, scan->file);
+            delete scan;
+            return;
+        }
+        if (read_size < 0) {
+            LOG(ERROR) << "fail to scan block [id: " << scan->block_id
+                << "], err: " << err;
+            scan->status = kIOError;
+            delete chunk;
+        } else {
+            if (read_size > 0) {
+                chunk->resize(read_size);
+                scan->chunks.push_back(chunk);
+                scan->credit--;
+            } else {
+                delete chunk;
+            }
+            if (scan->remain_size >= 0) {
+                scan->remain_size -= read_size;
+            }
+            // a short read is the end of block
+            if (static_cast<uint64_t>(read_size) < scan->chunk_size
+                || scan->remain_size == 0) {
+                scan->is_eof = true;
+            }
+        }
+        wait_done = TakeWaiting(scan);
+        TryReadAhead(scan);
+    }
+    if (wait_done != NULL) {
+        wait_done->Run();
+    }
+}
+
+void BlockScanner::FillResponse(Scan* scan, ScanDataResponse* response) {
+    // the chunks read before an error are still good to deliver
+    if (scan->chunks.empty() && scan->status != kSNodeOk) {
+        response->set_status(scan->status);
+        return;
+    }
+    while (!scan->chunks.empty()) {
+        std::string* chunk = scan->chunks.front();
+        scan->chunks.pop_front();
+        response->add_chunks()->swap(*chunk);
+        delete chunk;
+    }
+    response->set_eof(scan->is_eof);
+    response->set_status(kSNodeOk);
+}
+
+google::protobuf::Closure* BlockScanner::TakeWaiting(Scan* scan) {
+    if (scan->wait_done == NULL) {
+        return NULL;
+    }
+    if (scan->chunks.empty() && !scan->is_eof && scan->status == kSNodeOk
+        && (scan->credit > 0 || scan->is_reading)) {
+        return NULL;
+    }
+    FillResponse(scan, scan->wait_response);
+    google::protobuf::Closure* done = scan->wait_done;
+    scan->wait_response = NULL;
+    scan->wait_done = NULL;
+    return done;
+}
+
+void BlockScanner::ReleaseScan(Scan* scan) {
+    scan->is_closed = true;
+    scan->wait_response = NULL;
+    scan->wait_done = NULL;
+    // the read ahead running releases it when done
+    if (scan->is_reading) {
+        return;
+    }
+    DeleteScanData(&scan->chunks, scan->file);
+    delete scan;
+}
+
+void BlockScanner::CheckIdleScans(uint64_t timer_id) {
+    int64_t expire_ms = utils::GetMillis() - FLAGS_rsfs_snode_scan_idle_timeout;
+    MutexLocker lock(m_mutex);
+    std::map<uint64_t, Scan*>::iterator it = m_scans.begin();
+    while (it != m_scans.end()) {
+        Scan* scan = it->second;
+        if (scan->wait_done != NULL || scan->last_access_ms > expire_ms) {
+            ++it;
+            continue;
+        }
+        // the client is gone without closing
+        LOG(WARNING) << "drop idle scan #" << scan->scan_id
+            << " on block [id: " << scan->block_id << "]";
+        m_scans.erase(it++);
+        ReleaseScan(scan);
+    }
+}
+
+} // namespace snode
+} // namespace rsfs
@@ -0,0 +1,100 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SNODE_BLOCK_SCANNER_H
+#define RSFS_SNODE_BLOCK_SCANNER_H
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "common/base/scoped_ptr.h"
+#include "common/base/stdint.h"
+#include "common/file/file_stream.h"
+#include "common/lock/mutex.h"
+#include "common/thread/thread_pool.h"
+#include "common/timer/timer_manager.h"
+
+#include "rsfs/proto/snode_rpc.pb.h"
+#include "rsfs/proto/status_code.pb.h"
+
+namespace rsfs {
+namespace snode {
+
+class BlockManager;
+class LoadCollector;
+
+// the sequential scans of block files. each scan reads its block ahead
+// on the scan pool, one chunk per credit granted by client, so that the
+// disk and the link are kept busy while the client is consuming. a
+// ScanData with no chunk ready waits for the next one instead of
+// returning empty, which keeps the client from polling.
+class BlockScanner {
+public:
+    BlockScanner(BlockManager* block_manager, LoadCollector* load_collector);
+    ~BlockScanner();
+
+    void OpenScan(const OpenScanRequest* request,
+                  OpenScanResponse* response,
+                  google::protobuf::Closure* done);
+
+    void ScanData(const ScanDataRequest* request,
+                  ScanDataResponse* response,
+                  google::protobuf::Closure* done);
+
+    void CloseScan(const CloseScanRequest* request,
+                   CloseScanResponse* response,
+                   google::protobuf::Closure* done);
+
+private:
+    struct Scan {
+        uint64_t scan_id;
+        uint64_t block_id;
+        FileStream* file;
+        // the bytes left to read ahead, -1 for to the end of block
+        int64_t remain_size;
+        uint64_t chunk_size;
+        int32_t credit;
+        std::deque<std::string*> chunks;
+        bool is_reading;
+        bool is_eof;
+        bool is_closed;
+        StatusCode status;
+        // the ScanData waiting for a chunk
+        ScanDataResponse* wait_response;
+        google::protobuf::Closure* wait_done;
+        int64_t last_access_ms;
+    };
+
+    // called with m_mutex held
+    void TryReadAhead(Scan* scan);
+    void ReadAhead(Scan* scan);
+    // move the chunks ready into response, m_mutex held
+    void FillResponse(Scan* scan, ScanDataResponse* response);
+    // answer the waiting ScanData if any, m_mutex held
+    google::protobuf::Closure* TakeWaiting(Scan* scan);
+    // drop a scan removed from map, m_mutex held
+    void ReleaseScan(Scan* scan);
+
+    void CheckIdleScans(uint64_t timer_id);
+
+private:
+    BlockManager* m_block_manager;
+    LoadCollector* m_load_collector;
+
+    Mutex m_mutex;
+    std::map<uint64_t, Scan*> m_scans;
+    uint64_t m_next_scan_id;
+
+    scoped_ptr<ThreadPool> m_thread_pool;
+    TimerManager m_timer_manager;
+    uint64_t m_idle_timer_id;
+};
+
+} // namespace snode
+} // namespace rsfs
+
+#endif // RSFS_SNODE_BLOCK_SCANNER_H
@@ -0,0 +1,97 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/snode/load_collector.h"
+
+#include <string.h>
+
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace snode {
+
+LoadCollector::LoadCollector()
+    : m_window_start(utils::GetMicros()),
+      m_read_bytes(0), m_write_bytes(0),
+      m_read_ops(0), m_write_ops(0), m_pending_num(0) {
+    memset(m_latency_buckets, 0, sizeof(m_latency_buckets));
+}
+
+LoadCollector::~LoadCollector() {}
+
+void LoadCollector::AddPending() {
+    MutexLocker lock(m_mutex);
+    ++m_pending_num;
+}
+
+void LoadCollector::RemovePending() {
+    MutexLocker lock(m_mutex);
+    --m_pending_num;
+}
+
+void LoadCollector::AddRead(uint64_t bytes, int64_t latency_us) {
+    MutexLocker lock(m_mutex);
+    m_read_bytes += bytes;
+    ++m_read_ops;
+    AddLatency(latency_us);
+}
+
+void LoadCollector::AddWrite(uint64_t bytes, int64_t latency_us) {
+    MutexLocker lock(m_mutex);
+    m_write_bytes += bytes;
+    ++m_write_ops;
+    AddLatency(latency_us);
+}
+
+void LoadCollector::Dump(SNodeLoad* load) {
+    MutexLocker lock(m_mutex);
+    int64_t now = utils::GetMicros();
+    int64_t elapsed_us = now - m_window_start;
+    if (elapsed_us <= 0) {
+        elapsed_us = 1;
+    }
+    load->set_read_throughput(m_read_bytes * 1000000 / elapsed_us);
+    load->set_write_throughput(m_write_bytes * 1000000 / elapsed_us);
+    load->set_read_iops(m_read_ops * 1000000 / elapsed_us);
+    load->set_write_iops(m_write_ops * 1000000 / elapsed_us);
+    uint64_t total_ops = m_read_ops + m_write_ops;
+    load->set_latency_p50(GetPercentile(total_ops, 0.5));
+    load->set_latency_p99(GetPercentile(total_ops, 0.99));
+    load->set_queue_depth(m_pending_num > 0 ? m_pending_num : 0);
+
+    m_window_start = now;
+    m_read_bytes = m_write_bytes = 0;
+    m_read_ops = m_write_ops = 0;
+    memset(m_latency_buckets, 0, sizeof(m_latency_buckets));
+}
+
+void LoadCollector::AddLatency(int64_t latency_us) {
+    int32_t bucket = 0;
+    while (latency_us > 0 && bucket < kLatencyBucketNum - 1) {
+        latency_us >>= 1;
+        ++bucket;
+    }
+    ++m_latency_buckets[bucket];
+}
+
+int64_t LoadCollector::GetPercentile(uint64_t total, double percent) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t threshold = static_cast<uint64_t>(total * percent);
+    uint64_t count = 0;
+    for (int32_t i = 0; i < kLatencyBucketNum; ++i) {
+        count += m_latency_buckets[i];
+        if (count > threshold) {
+            // report the upper bound of the bucket
+            return 1LL << i;
+        }
+    }
+    return 1LL << (kLatencyBucketNum - 1);
+}
+
+} // namespace snode
+} // namespace rsfs
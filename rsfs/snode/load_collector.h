@@ -0,0 +1,54 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_SNODE_LOAD_COLLECTOR_H
+#define RSFS_SNODE_LOAD_COLLECTOR_H
+
+#include "common/base/stdint.h"
+#include "common/lock/mutex.h"
+
+#include "rsfs/proto/snode_info.pb.h"
+
+namespace rsfs {
+namespace snode {
+
+// accumulates io statistics between two heartbeats
+class LoadCollector {
+public:
+    LoadCollector();
+    ~LoadCollector();
+
+    void AddPending();
+    void RemovePending();
+
+    void AddRead(uint64_t bytes, int64_t latency_us);
+    void AddWrite(uint64_t bytes, int64_t latency_us);
+
+    // fill the rates of the window since last dump, then reset the window
+    void Dump(SNodeLoad* load);
+
+private:
+    void AddLatency(int64_t latency_us);
+    int64_t GetPercentile(uint64_t total, double percent) const;
+
+private:
+    // log2 buckets of latency in us, bucket i covers [2^(i-1), 2^i)
+    static const int32_t kLatencyBucketNum = 32;
+
+    mutable Mutex m_mutex;
+    int64_t m_window_start;
+    uint64_t m_read_bytes;
+    uint64_t m_write_bytes;
+    uint64_t m_read_ops;
+    uint64_t m_write_ops;
+    uint64_t m_latency_buckets[kLatencyBucketNum];
+    int32_t m_pending_num;
+};
+
+} // namespace snode
+} // namespace rsfs
+
+#endif // RSFS_SNODE_LOAD_COLLECTOR_H
@@ -6,69 +6,176 @@
 
 #include "rsfs/snode/remote_snode.h"
 
+#include <map>
+
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 
+#include "rsfs/snode/load_collector.h"
 #include "rsfs/snode/snode_impl.h"
+#include "rsfs/utils/atomic.h"
+#include "rsfs/utils/utils_cmd.h"
 
 DECLARE_int32(rsfs_snode_thread_min_num);
-DECLARE_int32(rsfs_snode_thread_max_num);
+DECLARE_int32(rsfs_snode_read_thread_num);
+DECLARE_int32(rsfs_snode_write_thread_num);
 
 namespace rsfs {
 namespace snode {
 
 RemoteSNode::RemoteSNode(SNodeImpl* snode_impl)
     : m_snode_impl(snode_impl),
-      m_thread_pool(new ThreadPool(FLAGS_rsfs_snode_thread_min_num,
-                                   FLAGS_rsfs_snode_thread_max_num)) {}
+      m_read_thread_pool(new ThreadPool(FLAGS_rsfs_snode_thread_min_num,
+                                        FLAGS_rsfs_snode_read_thread_num)),
+      m_write_thread_pool(new ThreadPool(FLAGS_rsfs_snode_thread_min_num,
+                                         FLAGS_rsfs_snode_write_thread_num)) {}
 
 RemoteSNode::~RemoteSNode() {}
 
+// the client stops waiting for a request queued beyond its timeout,
+// drop it before any disk io
+template <class Request, class Response>
+static bool DropExpiredRequest(const Request* request, Response* response,
+                               google::protobuf::Closure* done,
+                               int64_t accept_ms) {
+    if (request->timeout_ms() <= 0
+        || utils::GetMillis() - accept_ms < request->timeout_ms()) {
+        return false;
+    }
+    VLOG(5) << "drop expired request, sequence id: " << request->sequence_id()
+        << ", timeout: " << request->timeout_ms() << " ms";
+    response->set_sequence_id(request->sequence_id());
+    response->set_status(kDeadlineExceeded);
+    done->Run();
+    return true;
+}
+
 void RemoteSNode::OpenData(google::protobuf::RpcController* controller,
                            const OpenDataRequest* request,
                            OpenDataResponse* response,
                            google::protobuf::Closure* done) {
+    // opening a block touches the disk, route it to the io pool of its mode
     Closure<void>* callback =
         NewClosure(this, &RemoteSNode::DoOpenData, controller,
-                   request, response, done);
-    m_thread_pool->AddTask(callback);
+                   request, response, done, utils::GetMillis());
+    if (request->mode() == OpenDataRequest::APPEND) {
+        m_write_thread_pool->AddTask(callback);
+    } else {
+        m_read_thread_pool->AddTask(callback);
+    }
 }
 
 void RemoteSNode::CloseData(google::protobuf::RpcController* controller,
                            const CloseDataRequest* request,
                            CloseDataResponse* response,
                            google::protobuf::Closure* done) {
-    Closure<void>* callback =
-        NewClosure(this, &RemoteSNode::DoCloseData, controller,
-                   request, response, done);
-    m_thread_pool->AddTask(callback);
+    // closing only drops the stream reference, run it on the rpc worker
+    DoCloseData(controller, request, response, done);
 }
 
 void RemoteSNode::WriteData(google::protobuf::RpcController* controller,
                            const WriteDataRequest* request,
                            WriteDataResponse* response,
                            google::protobuf::Closure* done) {
+    m_snode_impl->GetLoadCollector()->AddPending();
     Closure<void>* callback =
         NewClosure(this, &RemoteSNode::DoWriteData, controller,
-                   request, response, done);
-    m_thread_pool->AddTask(callback);
+                   request, response, done, utils::GetMillis());
+    m_write_thread_pool->AddTask(callback);
 }
 
 void RemoteSNode::ReadData(google::protobuf::RpcController* controller,
                            const ReadDataRequest* request,
                            ReadDataResponse* response,
                            google::protobuf::Closure* done) {
+    m_snode_impl->GetLoadCollector()->AddPending();
     Closure<void>* callback =
         NewClosure(this, &RemoteSNode::DoReadData, controller,
-                   request, response, done);
-    m_thread_pool->AddTask(callback);
+                   request, response, done, utils::GetMillis());
+    m_read_thread_pool->AddTask(callback);
+}
+
+void RemoteSNode::WriteDataBatch(google::protobuf::RpcController* controller,
+                                 const WriteDataBatchRequest* request,
+                                 WriteDataBatchResponse* response,
+                                 google::protobuf::Closure* done) {
+    m_snode_impl->GetLoadCollector()->AddPending();
+    Closure<void>* callback =
+        NewClosure(this, &RemoteSNode::DoWriteDataBatch, controller,
+                   request, response, done, utils::GetMillis());
+    m_write_thread_pool->AddTask(callback);
+}
+
+void RemoteSNode::ReadDataBatch(google::protobuf::RpcController* controller,
+                                const ReadDataBatchRequest* request,
+                                ReadDataBatchResponse* response,
+                                google::protobuf::Closure* done) {
+    m_snode_impl->GetLoadCollector()->AddPending();
+    Closure<void>* callback =
+        NewClosure(this, &RemoteSNode::DoReadDataBatch, controller,
+                   request, response, done, utils::GetMillis());
+    m_read_thread_pool->AddTask(callback);
+}
+
+void RemoteSNode::OpenScan(google::protobuf::RpcController* controller,
+                           const OpenScanRequest* request,
+                           OpenScanResponse* response,
+                           google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteSNode::DoOpenScan, controller,
+                   request, response, done, utils::GetMillis());
+    m_read_thread_pool->AddTask(callback);
+}
+
+void RemoteSNode::ScanData(google::protobuf::RpcController* controller,
+                           const ScanDataRequest* request,
+                           ScanDataResponse* response,
+                           google::protobuf::Closure* done) {
+    // the chunks are read ahead on the scan pool, this only hands them
+    // over or waits for the next one, run it on the rpc worker
+    VLOG(5) << "accept RPC (ScanData), scan #" << request->scan_id()
+        << ", credit: " << request->credit();
+    m_snode_impl->ScanData(request, response, done);
+}
+
+void RemoteSNode::CloseScan(google::protobuf::RpcController* controller,
+                            const CloseScanRequest* request,
+                            CloseScanResponse* response,
+                            google::protobuf::Closure* done) {
+    m_snode_impl->CloseScan(request, response, done);
+}
+
+void RemoteSNode::DeleteData(google::protobuf::RpcController* controller,
+                             const DeleteDataRequest* request,
+                             DeleteDataResponse* response,
+                             google::protobuf::Closure* done) {
+    // unlink is off the rpc worker, and shares the write pool so that
+    // a gc burst is throttled by the foreground writes
+    Closure<void>* callback =
+        NewClosure(this, &RemoteSNode::DoDeleteData, controller,
+                   request, response, done, utils::GetMillis());
+    m_write_thread_pool->AddTask(callback);
+}
+
+void RemoteSNode::StatData(google::protobuf::RpcController* controller,
+                           const StatDataRequest* request,
+                           StatDataResponse* response,
+                           google::protobuf::Closure* done) {
+    Closure<void>* callback =
+        NewClosure(this, &RemoteSNode::DoStatData, controller,
+                   request, response, done, utils::GetMillis());
+    m_read_thread_pool->AddTask(callback);
 }
 
 void RemoteSNode::DoOpenData(google::protobuf::RpcController* controller,
                              const OpenDataRequest* request,
                              OpenDataResponse* response,
-                             google::protobuf::Closure* done) {
+                             google::protobuf::Closure* done,
+                             int64_t accept_ms) {
     LOG(INFO) << "accept RPC (OpenData)";
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
     m_snode_impl->OpenData(request, response, done);
     LOG(INFO) << "finish RPC (OpenData)";
 }
@@ -85,20 +192,246 @@ void RemoteSNode::DoCloseData(google::protobuf::RpcController* controller,
 void RemoteSNode::DoWriteData(google::protobuf::RpcController* controller,
                              const WriteDataRequest* request,
                              WriteDataResponse* response,
-                             google::protobuf::Closure* done) {
+                             google::protobuf::Closure* done,
+                             int64_t accept_ms) {
     LOG(INFO) << "accept RPC (WriteData)";
+    LoadCollector* load_collector = m_snode_impl->GetLoadCollector();
+    load_collector->RemovePending();
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    // request is released once done runs, take the size beforehand
+    uint64_t size = request->payload().size();
+    int64_t start_us = utils::GetMicros();
     m_snode_impl->WriteData(request, response, done);
+    load_collector->AddWrite(size, utils::GetMicros() - start_us);
     LOG(INFO) << "finish RPC (WriteData)";
 }
 
 void RemoteSNode::DoReadData(google::protobuf::RpcController* controller,
                              const ReadDataRequest* request,
                              ReadDataResponse* response,
-                             google::protobuf::Closure* done) {
+                             google::protobuf::Closure* done,
+                             int64_t accept_ms) {
     LOG(INFO) << "accept RPC (ReadData)";
-    m_snode_impl->ReadData(request, response, done);
+    LoadCollector* load_collector = m_snode_impl->GetLoadCollector();
+    load_collector->RemovePending();
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    // the response is released once done runs, it is charged before
+    BatchTask* task = new BatchTask;
+    task->remain_num = 1;
+    task->done = done;
+    task->is_read = true;
+    task->size = 0;
+    task->start_us = utils::GetMicros();
+    m_snode_impl->ReadData(request, response,
+                           google::protobuf::NewCallback(
+                               this, &RemoteSNode::FinishReadData, response, task));
     LOG(INFO) << "finish RPC (ReadData)";
 }
 
+void RemoteSNode::FinishReadData(ReadDataResponse* response, BatchTask* task) {
+    task->size = response->payload().size();
+    FinishEntries(task);
+}
+
+// group the entry numbers by block, keeping the request order in group
+template <class Request>
+static void GroupEntries(const Request* request,
+                         std::vector<std::vector<int32_t> >* groups) {
+    std::map<uint64_t, uint32_t> group_nos;
+    for (int32_t i = 0; i < request->entries_size(); ++i) {
+        uint64_t block_id = request->entries(i).block_id();
+        std::map<uint64_t, uint32_t>::iterator it = group_nos.find(block_id);
+        if (it == group_nos.end()) {
+            it = group_nos.insert(std::make_pair(block_id, groups->size())).first;
+            groups->push_back(std::vector<int32_t>());
+        }
+        (*groups)[it->second].push_back(i);
+    }
+}
+
+void RemoteSNode::DoWriteDataBatch(google::protobuf::RpcController* controller,
+                                   const WriteDataBatchRequest* request,
+                                   WriteDataBatchResponse* response,
+                                   google::protobuf::Closure* done,
+                                   int64_t accept_ms) {
+    LOG(INFO) << "accept RPC (WriteDataBatch), entry num: "
+        << request->entries_size();
+    m_snode_impl->GetLoadCollector()->RemovePending();
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    response->set_sequence_id(request->sequence_id());
+    response->set_status(kSNodeOk);
+    uint64_t size = 0;
+    for (int32_t i = 0; i < request->entries_size(); ++i) {
+        response->add_statuses(kSNodeOk);
+        size += request->entries(i).payload().size();
+    }
+    std::vector<std::vector<int32_t> > groups;
+    GroupEntries(request, &groups);
+    if (groups.empty()) {
+        done->Run();
+        return;
+    }
+
+    BatchTask* task = new BatchTask;
+    task->remain_num = groups.size();
+    task->done = done;
+    task->is_read = false;
+    task->size = size;
+    task->start_us = utils::GetMicros();
+    // the blocks are written concurrently, this thread takes the first
+    for (uint32_t i = 1; i < groups.size(); ++i) {
+        Closure<void>* callback =
+            NewClosure(this, &RemoteSNode::WriteEntries,
+                       request, response, groups[i], task);
+        m_write_thread_pool->AddTask(callback);
+    }
+    WriteEntries(request, response, groups[0], task);
+}
+
+void RemoteSNode::DoReadDataBatch(google::protobuf::RpcController* controller,
+                                  const ReadDataBatchRequest* request,
+                                  ReadDataBatchResponse* response,
+                                  google::protobuf::Closure* done,
+                                  int64_t accept_ms) {
+    LOG(INFO) << "accept RPC (ReadDataBatch), entry num: "
+        << request->entries_size();
+    m_snode_impl->GetLoadCollector()->RemovePending();
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    response->set_sequence_id(request->sequence_id());
+    response->set_status(kSNodeOk);
+    // fill all slots ahead, each is then written by one thread only
+    for (int32_t i = 0; i < request->entries_size(); ++i) {
+        response->add_statuses(kSNodeOk);
+        response->add_payloads();
+    }
+    std::vector<std::vector<int32_t> > groups;
+    GroupEntries(request, &groups);
+    if (groups.empty()) {
+        done->Run();
+        return;
+    }
+
+    BatchTask* task = new BatchTask;
+    task->remain_num = groups.size();
+    task->done = done;
+    task->is_read = true;
+    // the groups add the bytes they read
+    task->size = 0;
+    task->start_us = utils::GetMicros();
+    for (uint32_t i = 1; i < groups.size(); ++i) {
+        Closure<void>* callback =
+            NewClosure(this, &RemoteSNode::ReadEntries,
+                       request, response, groups[i], task);
+        m_read_thread_pool->AddTask(callback);
+    }
+    ReadEntries(request, response, groups[0], task);
+}
+
+void RemoteSNode::WriteEntries(const WriteDataBatchRequest* request,
+                               WriteDataBatchResponse* response,
+                               std::vector<int32_t> entry_nos, BatchTask* task) {
+    // the entries of a group append to one block file, the ones after
+    // a failure would land at shifted offsets, so they are failed
+    bool is_failed = false;
+    for (uint32_t i = 0; i < entry_nos.size(); ++i) {
+        int32_t no = entry_nos[i];
+        if (is_failed) {
+            response->set_statuses(no, kIOError);
+            continue;
+        }
+        const WriteDataEntry& entry = request->entries(no);
+        StatusCode status = m_snode_impl->WriteBlock(entry.block_id(),
+                                                     entry.payload());
+        response->set_statuses(no, status);
+        if (status != kSNodeOk) {
+            LOG(WARNING) << "fail to write block [id: " << entry.block_id()
+                << "], fail the " << entry_nos.size() - i - 1 << " entries after";
+            is_failed = true;
+        }
+    }
+    FinishEntries(task);
+}
+
+void RemoteSNode::ReadEntries(const ReadDataBatchRequest* request,
+                              ReadDataBatchResponse* response,
+                              std::vector<int32_t> entry_nos, BatchTask* task) {
+    uint64_t read_size = 0;
+    for (uint32_t i = 0; i < entry_nos.size(); ++i) {
+        int32_t no = entry_nos[i];
+        const ReadDataEntry& entry = request->entries(no);
+        StatusCode status = m_snode_impl->ReadBlock(entry.block_id(),
+                                                    entry.has_offset(),
+                                                    entry.offset(),
+                                                    entry.length(),
+                                                    response->mutable_payloads(no));
+        response->set_statuses(no, status);
+        read_size += response->payloads(no).size();
+    }
+    atomic_add_ret_old64(&task->size, read_size);
+    FinishEntries(task);
+}
+
+void RemoteSNode::FinishEntries(BatchTask* task) {
+    if (atomic_dec_ret_old(&task->remain_num) != 1) {
+        return;
+    }
+    LoadCollector* load_collector = m_snode_impl->GetLoadCollector();
+    int64_t latency_us = utils::GetMicros() - task->start_us;
+    if (task->is_read) {
+        load_collector->AddRead(task->size, latency_us);
+    } else {
+        load_collector->AddWrite(task->size, latency_us);
+    }
+    task->done->Run();
+    delete task;
+}
+
+void RemoteSNode::DoOpenScan(google::protobuf::RpcController* controller,
+                             const OpenScanRequest* request,
+                             OpenScanResponse* response,
+                             google::protobuf::Closure* done,
+                             int64_t accept_ms) {
+    LOG(INFO) << "accept RPC (OpenScan)";
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    m_snode_impl->OpenScan(request, response, done);
+    LOG(INFO) << "finish RPC (OpenScan)";
+}
+
+void RemoteSNode::DoDeleteData(google::protobuf::RpcController* controller,
+                               const DeleteDataRequest* request,
+                               DeleteDataResponse* response,
+                               google::protobuf::Closure* done,
+                               int64_t accept_ms) {
+    LOG(INFO) << "accept RPC (DeleteData)";
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    m_snode_impl->DeleteData(request, response, done);
+    LOG(INFO) << "finish RPC (DeleteData)";
+}
+
+void RemoteSNode::DoStatData(google::protobuf::RpcController* controller,
+                             const StatDataRequest* request,
+                             StatDataResponse* response,
+                             google::protobuf::Closure* done,
+                             int64_t accept_ms) {
+    LOG(INFO) << "accept RPC (StatData)";
+    if (DropExpiredRequest(request, response, done, accept_ms)) {
+        return;
+    }
+    m_snode_impl->StatData(request, response, done);
+    LOG(INFO) << "finish RPC (StatData)";
+}
+
 } // namespace snode
 } // namespace rsfs
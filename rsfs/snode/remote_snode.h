@@ -7,6 +7,8 @@
 #ifndef RSFS_SNODE_REMOTE_SNODE_H
 #define RSFS_SNODE_REMOTE_SNODE_H
 
+#include <vector>
+
 #include "common/base/scoped_ptr.h"
 #include "common/thread/thread_pool.h"
 
@@ -42,11 +44,46 @@ public:
                   ReadDataResponse* response,
                   google::protobuf::Closure* done);
 
+    void WriteDataBatch(google::protobuf::RpcController* controller,
+                        const WriteDataBatchRequest* request,
+                        WriteDataBatchResponse* response,
+                        google::protobuf::Closure* done);
+
+    void ReadDataBatch(google::protobuf::RpcController* controller,
+                       const ReadDataBatchRequest* request,
+                       ReadDataBatchResponse* response,
+                       google::protobuf::Closure* done);
+
+    void OpenScan(google::protobuf::RpcController* controller,
+                  const OpenScanRequest* request,
+                  OpenScanResponse* response,
+                  google::protobuf::Closure* done);
+
+    void ScanData(google::protobuf::RpcController* controller,
+                  const ScanDataRequest* request,
+                  ScanDataResponse* response,
+                  google::protobuf::Closure* done);
+
+    void CloseScan(google::protobuf::RpcController* controller,
+                   const CloseScanRequest* request,
+                   CloseScanResponse* response,
+                   google::protobuf::Closure* done);
+
+    void DeleteData(google::protobuf::RpcController* controller,
+                    const DeleteDataRequest* request,
+                    DeleteDataResponse* response,
+                    google::protobuf::Closure* done);
+
+    void StatData(google::protobuf::RpcController* controller,
+                  const StatDataRequest* request,
+                  StatDataResponse* response,
+                  google::protobuf::Closure* done);
+
 private:
     void DoOpenData(google::protobuf::RpcController* controller,
                     const OpenDataRequest* request,
                     OpenDataResponse* response,
-                    google::protobuf::Closure* done);
+                    google::protobuf::Closure* done, int64_t accept_ms);
 
     void DoCloseData(google::protobuf::RpcController* controller,
                     const CloseDataRequest* request,
@@ -56,16 +93,65 @@ private:
     void DoWriteData(google::protobuf::RpcController* controller,
                     const WriteDataRequest* request,
                     WriteDataResponse* response,
-                    google::protobuf::Closure* done);
+                    google::protobuf::Closure* done, int64_t accept_ms);
 
     void DoReadData(google::protobuf::RpcController* controller,
                     const ReadDataRequest* request,
                     ReadDataResponse* response,
-                    google::protobuf::Closure* done);
+                    google::protobuf::Closure* done, int64_t accept_ms);
+
+    // the entries of a batch left to run, the last one answers
+    struct BatchTask {
+        volatile int32_t remain_num;
+        google::protobuf::Closure* done;
+        bool is_read;
+        // the bytes written, or read so far
+        volatile uint64_t size;
+        int64_t start_us;
+    };
+
+    // charge the bytes actually read, then answer
+    void FinishReadData(ReadDataResponse* response, BatchTask* task);
+
+    void DoWriteDataBatch(google::protobuf::RpcController* controller,
+                          const WriteDataBatchRequest* request,
+                          WriteDataBatchResponse* response,
+                          google::protobuf::Closure* done, int64_t accept_ms);
+
+    void DoReadDataBatch(google::protobuf::RpcController* controller,
+                         const ReadDataBatchRequest* request,
+                         ReadDataBatchResponse* response,
+                         google::protobuf::Closure* done, int64_t accept_ms);
+
+    void WriteEntries(const WriteDataBatchRequest* request,
+                      WriteDataBatchResponse* response,
+                      std::vector<int32_t> entry_nos, BatchTask* task);
+
+    void ReadEntries(const ReadDataBatchRequest* request,
+                     ReadDataBatchResponse* response,
+                     std::vector<int32_t> entry_nos, BatchTask* task);
+
+    void FinishEntries(BatchTask* task);
+
+    void DoOpenScan(google::protobuf::RpcController* controller,
+                    const OpenScanRequest* request,
+                    OpenScanResponse* response,
+                    google::protobuf::Closure* done, int64_t accept_ms);
+
+    void DoDeleteData(google::protobuf::RpcController* controller,
+                      const DeleteDataRequest* request,
+                      DeleteDataResponse* response,
+                      google::protobuf::Closure* done, int64_t accept_ms);
+
+    void DoStatData(google::protobuf::RpcController* controller,
+                    const StatDataRequest* request,
+                    StatDataResponse* response,
+                    google::protobuf::Closure* done, int64_t accept_ms);
 
 private:
     SNodeImpl* m_snode_impl;
-    scoped_ptr<ThreadPool> m_thread_pool;
+    scoped_ptr<ThreadPool> m_read_thread_pool;
+    scoped_ptr<ThreadPool> m_write_thread_pool;
 };
 
 } // namespace snode
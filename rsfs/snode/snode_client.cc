@@ -68,6 +68,22 @@ bool SNodeClient::ReadData(const ReadDataRequest* request,
                                 "ReadData");
 }
 
+bool SNodeClient::DeleteData(const DeleteDataRequest* request,
+                             DeleteDataResponse* response) {
+    return SendMessageWithRetry(&SNodeServer::Stub::DeleteData,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "DeleteData");
+}
+
+bool SNodeClient::StatData(const StatDataRequest* request,
+                           StatDataResponse* response) {
+    return SendMessageWithRetry(&SNodeServer::Stub::StatData,
+                                request, response,
+                                (google::protobuf::Closure*)NULL,
+                                "StatData");
+}
+
 bool SNodeClient::IsRetryStatus(const StatusCode& status) {
     return (status == kSNodeNotInited
             || status == kSNodeIsBusy
@@ -34,6 +34,12 @@ public:
     bool ReadData(const ReadDataRequest* request,
                    ReadDataResponse* response);
 
+    bool DeleteData(const DeleteDataRequest* request,
+                    DeleteDataResponse* response);
+
+    bool StatData(const StatDataRequest* request,
+                  StatDataResponse* response);
+
 private:
     bool IsRetryStatus(const StatusCode& status);
 };
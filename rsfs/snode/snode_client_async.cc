@@ -26,6 +26,11 @@ SNodeClientAsync::SNodeClientAsync(const std::string& server_addr,
     : RpcClientAsync<SNodeServer::Stub>(server_addr),
       m_rpc_timeout(rpc_timeout) {}
 
+SNodeClientAsync::SNodeClientAsync(RpcEndpoint* endpoint,
+                                   int32_t rpc_timeout)
+    : RpcClientAsync<SNodeServer::Stub>(endpoint),
+      m_rpc_timeout(rpc_timeout) {}
+
 SNodeClientAsync::~SNodeClientAsync() {}
 
 bool SNodeClientAsync::OpenData(const OpenDataRequest* request,
@@ -33,7 +38,8 @@ bool SNodeClientAsync::OpenData(const OpenDataRequest* request,
                                 Closure<void, OpenDataRequest*, OpenDataResponse*, bool, int>* done) {
     return SendMessageWithRetry(&SNodeServer::Stub::OpenData,
                                 request, response, done, "OpenData",
-                                m_rpc_timeout, m_thread_pool);
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
 }
 
 bool SNodeClientAsync::CloseData(const CloseDataRequest* request,
@@ -49,7 +55,8 @@ bool SNodeClientAsync::WriteData(const WriteDataRequest* request,
                                  Closure<void, WriteDataRequest*, WriteDataResponse*, bool, int>* done) {
     return SendMessageWithRetry(&SNodeServer::Stub::WriteData,
                                 request, response, done, "WriteData",
-                                m_rpc_timeout, m_thread_pool);
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
 }
 
 bool SNodeClientAsync::ReadData(const ReadDataRequest* request,
@@ -57,9 +64,61 @@ bool SNodeClientAsync::ReadData(const ReadDataRequest* request,
                                 Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done) {
     return SendMessageWithRetry(&SNodeServer::Stub::ReadData,
                                 request, response, done, "ReadData",
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
+}
+
+bool SNodeClientAsync::WriteDataBatch(const WriteDataBatchRequest* request,
+                                      WriteDataBatchResponse* response,
+                                      Closure<void, WriteDataBatchRequest*, WriteDataBatchResponse*, bool, int>* done) {
+    return SendMessageWithRetry(&SNodeServer::Stub::WriteDataBatch,
+                                request, response, done, "WriteDataBatch",
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
+}
+
+bool SNodeClientAsync::ReadDataBatch(const ReadDataBatchRequest* request,
+                                     ReadDataBatchResponse* response,
+                                     Closure<void, ReadDataBatchRequest*, ReadDataBatchResponse*, bool, int>* done) {
+    return SendMessageWithRetry(&SNodeServer::Stub::ReadDataBatch,
+                                request, response, done, "ReadDataBatch",
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
+}
+
+bool SNodeClientAsync::OpenScan(const OpenScanRequest* request,
+                                OpenScanResponse* response,
+                                Closure<void, OpenScanRequest*, OpenScanResponse*, bool, int>* done) {
+    return SendMessageWithRetry(&SNodeServer::Stub::OpenScan,
+                                request, response, done, "OpenScan",
+                                GetRpcTimeout(request->timeout_ms()),
+                                m_thread_pool);
+}
+
+bool SNodeClientAsync::ScanData(const ScanDataRequest* request,
+                                ScanDataResponse* response,
+                                Closure<void, ScanDataRequest*, ScanDataResponse*, bool, int>* done) {
+    return SendMessageWithRetry(&SNodeServer::Stub::ScanData,
+                                request, response, done, "ScanData",
                                 m_rpc_timeout, m_thread_pool);
 }
 
+bool SNodeClientAsync::CloseScan(const CloseScanRequest* request,
+                                 CloseScanResponse* response,
+                                 Closure<void, CloseScanRequest*, CloseScanResponse*, bool, int>* done) {
+    return SendMessageWithRetry(&SNodeServer::Stub::CloseScan,
+                                request, response, done, "CloseScan",
+                                m_rpc_timeout, m_thread_pool);
+}
+
+int32_t SNodeClientAsync::GetRpcTimeout(int64_t request_timeout) {
+    // wait no longer than the snode keeps the request
+    if (request_timeout > 0 && request_timeout < m_rpc_timeout) {
+        return request_timeout;
+    }
+    return m_rpc_timeout;
+}
+
 bool SNodeClientAsync::IsRetryStatus(const StatusCode& status) {
     return (status == kSNodeNotInited
             || status == kSNodeIsBusy);
@@ -31,6 +31,10 @@ public:
     SNodeClientAsync(const std::string& addr = "",
                      int32_t rpc_timeout = FLAGS_rsfs_snode_rpc_timeout_period);
 
+    // cheap to construct on the hot path: no lookup, no allocation
+    SNodeClientAsync(RpcEndpoint* endpoint,
+                     int32_t rpc_timeout = FLAGS_rsfs_snode_rpc_timeout_period);
+
     ~SNodeClientAsync();
 
     bool OpenData(const OpenDataRequest* request,
@@ -49,8 +53,29 @@ public:
                   ReadDataResponse* response,
                   Closure<void, ReadDataRequest*, ReadDataResponse*, bool, int>* done = NULL);
 
+    bool WriteDataBatch(const WriteDataBatchRequest* request,
+                        WriteDataBatchResponse* response,
+                        Closure<void, WriteDataBatchRequest*, WriteDataBatchResponse*, bool, int>* done = NULL);
+
+    bool ReadDataBatch(const ReadDataBatchRequest* request,
+                       ReadDataBatchResponse* response,
+                       Closure<void, ReadDataBatchRequest*, ReadDataBatchResponse*, bool, int>* done = NULL);
+
+    bool OpenScan(const OpenScanRequest* request,
+                  OpenScanResponse* response,
+                  Closure<void, OpenScanRequest*, OpenScanResponse*, bool, int>* done = NULL);
+
+    bool ScanData(const ScanDataRequest* request,
+                  ScanDataResponse* response,
+                  Closure<void, ScanDataRequest*, ScanDataResponse*, bool, int>* done = NULL);
+
+    bool CloseScan(const CloseScanRequest* request,
+                   CloseScanResponse* response,
+                   Closure<void, CloseScanRequest*, CloseScanResponse*, bool, int>* done = NULL);
+
 private:
     bool IsRetryStatus(const StatusCode& status);
+    int32_t GetRpcTimeout(int64_t request_timeout);
 
     int32_t m_rpc_timeout;
     static ThreadPool* m_thread_pool;
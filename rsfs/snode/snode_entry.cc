@@ -18,6 +18,7 @@
 
 DECLARE_string(rsfs_snode_addr);
 DECLARE_string(rsfs_snode_port);
+DECLARE_string(rsfs_snode_rack);
 DECLARE_int64(rsfs_heartbeat_period);
 
 namespace rsfs {
@@ -39,6 +40,9 @@ bool SNodeEntry::StartServer() {
     SNodeInfo snode_info;
     snode_info.set_addr(snode_addr.ToString());
     snode_info.set_status(kSNodeIsRunning);
+    if (!FLAGS_rsfs_snode_rack.empty()) {
+        snode_info.set_rack(FLAGS_rsfs_snode_rack);
+    }
 
     m_snode_impl.reset(new SNodeImpl(snode_info, m_master_client.get()));
     m_remote_snode.reset(new RemoteSNode(m_snode_impl.get()));
@@ -7,14 +7,19 @@
 
 #include "rsfs/snode/snode_impl.h"
 
+#include <sys/statvfs.h>
+
 #include "common/file/file_stream.h"
 #include "common/file/file_types.h"
 #include "thirdparty/gflags/gflags.h"
 #include "thirdparty/glog/logging.h"
 
 #include "rsfs/snode/block_manager.h"
+#include "rsfs/snode/block_scanner.h"
+#include "rsfs/snode/load_collector.h"
 #include "rsfs/snode/snode_client_async.h"
 #include "rsfs/types.h"
+#include "rsfs/utils/utils_cmd.h"
 
 DECLARE_string(rsfs_snode_port);
 DECLARE_int64(rsfs_heartbeat_period);
@@ -28,6 +33,7 @@ DECLARE_int32(rsfs_snode_rpc_limit_max_inflow);
 DECLARE_int32(rsfs_snode_rpc_limit_max_outflow);
 DECLARE_int32(rsfs_snode_rpc_max_pending_buffer_size);
 DECLARE_int32(rsfs_snode_rpc_work_thread_num);
+DECLARE_string(rsfs_snode_path_prefix);
 
 namespace rsfs {
 namespace snode {
@@ -37,6 +43,9 @@ SNodeImpl::SNodeImpl(const SNodeInfo& snode_info,
                      master::MasterClient* master_client)
     : m_snode_info(snode_info), m_master_client(master_client),
       m_block_manager(new BlockManager()),
+      m_load_collector(new LoadCollector()),
+      m_block_scanner(new BlockScanner(m_block_manager.get(),
+                                       m_load_collector.get())),
       m_thread_pool(new ThreadPool(FLAGS_rsfs_snode_thread_min_num,
                                    FLAGS_rsfs_snode_thread_max_num)) {
 
@@ -64,6 +73,7 @@ bool SNodeImpl::Register() {
     m_this_sequence_id = kSequenceIDStart;
     request.set_sequence_id(m_this_sequence_id);
     request.mutable_snode_info()->CopyFrom(m_snode_info);
+    CollectLoad(request.mutable_snode_info()->mutable_load());
 
     if (!m_master_client->Register(&request, &response)) {
         LOG(ERROR) << "Rpc failed: register, status = "
@@ -85,6 +95,14 @@ bool SNodeImpl::Report() {
     ReportRequest request;
     request.set_sequence_id(m_this_sequence_id);
     request.mutable_snode_info()->CopyFrom(m_snode_info);
+    CollectLoad(request.mutable_snode_info()->mutable_load());
+    // a missed report must not lose the writes, so look back two periods
+    std::vector<uint64_t> writing_blocks;
+    m_block_manager->GetWritingBlocks(
+        utils::GetMillis() - 2 * FLAGS_rsfs_heartbeat_period, &writing_blocks);
+    for (uint32_t i = 0; i < writing_blocks.size(); ++i) {
+        request.add_writing_blocks(writing_blocks[i]);
+    }
 
     int32_t retry = 0;
     while (retry < FLAGS_rsfs_heartbeat_retry_times) {
@@ -117,6 +135,24 @@ bool SNodeImpl::Report() {
     return false;
 }
 
+LoadCollector* SNodeImpl::GetLoadCollector() {
+    return m_load_collector.get();
+}
+
+void SNodeImpl::CollectLoad(SNodeLoad* load) {
+    m_load_collector->Dump(load);
+
+    struct statvfs fs_stat;
+    if (statvfs(FLAGS_rsfs_snode_path_prefix.c_str(), &fs_stat) != 0) {
+        LOG(WARNING) << "fail to stat data path: " << FLAGS_rsfs_snode_path_prefix;
+        return;
+    }
+    uint64_t capacity = fs_stat.f_blocks * fs_stat.f_frsize;
+    uint64_t avail = fs_stat.f_bavail * fs_stat.f_frsize;
+    load->set_capacity(capacity);
+    load->set_used(capacity > avail ? capacity - avail : 0);
+}
+
 void SNodeImpl::OpenData(const OpenDataRequest* request,
                          OpenDataResponse* response,
                          google::protobuf::Closure* done) {
@@ -164,34 +200,74 @@ void SNodeImpl::WriteData(const WriteDataRequest* request,
                          google::protobuf::Closure* done) {
     LOG(INFO) << "WriteData: receive payload size: " << request->payload().size();
     response->set_sequence_id(request->sequence_id());
-    uint64_t block_id = request->block_id();
+    response->set_status(WriteBlock(request->block_id(), request->payload()));
+    done->Run();
+}
+
+StatusCode SNodeImpl::WriteBlock(uint64_t block_id, const std::string& payload) {
     BlockStream* stream = m_block_manager->GetBlockStream(block_id);
     if (!stream) {
         LOG(INFO) << "stream of block [id: " << block_id << "] not exist";
-        response->set_status(kSNodeNotStream);
-        done->Run();
-        return;
+        return kSNodeNotStream;
     }
     if (stream->GetType() != BlockStream::APPEND) {
         LOG(ERROR) << "wrong stream type [stream type: "
             << stream->GetType() << "]";
-        response->set_status(kSNodeErrStream);
-        done->Run();
-        return;
+        stream->DecRef();
+        return kSNodeErrStream;
     }
 
     FileStream* file = stream->GetFileStream();
     CHECK(file);
+    stream->Touch();
+    StatusCode status = kSNodeOk;
     FileErrorCode err = kFileSuccess;
-    if (!file->Write(request->payload().data(), request->payload().size(), &err)) {
+    if (!file->Write(payload.data(), payload.size(), &err)) {
         LOG(ERROR) << "fail to write data in block [id: " << block_id
             << "], err_code: " << err;
-        response->set_status(kIOError);
-    } else {
-        response->set_status(kSNodeOk);
+        status = kIOError;
     }
     stream->DecRef();
-    done->Run();
+    return status;
+}
+
+StatusCode SNodeImpl::ReadBlock(uint64_t block_id, bool has_offset,
+                                uint64_t offset, uint64_t length,
+                                std::string* payload) {
+    BlockStream* stream = m_block_manager->GetBlockStream(block_id);
+    if (!stream) {
+        LOG(INFO) << "stream of block [id: " << block_id << "] not exist";
+        return kSNodeNotStream;
+    }
+    if (stream->GetType() == BlockStream::APPEND) {
+        LOG(ERROR) << "wrong stream type [stream type: "
+            << stream->GetType() << "]";
+        stream->DecRef();
+        return kSNodeErrStream;
+    }
+    FileStream* file = stream->GetFileStream();
+    FileErrorCode err = kFileSuccess;
+    StatusCode status = kSNodeOk;
+    {
+        // the stream may go with the last ref, unlock before DecRef
+        MutexLocker lock(*stream->GetIoMutex());
+        if (has_offset && file->Seek(offset, SEEK_SET, &err) < 0) {
+            LOG(ERROR) << "fail to seek block [id: " << block_id
+                << "] to " << offset << ", err: " << err;
+            status = kIOError;
+        } else {
+            payload->resize(length);
+            if (length > 0 && static_cast<int64_t>(length)
+                != file->Read(&(*payload)[0], length, &err)) {
+                LOG(ERROR) << "fail to read block [id: " << block_id
+                    << "], err: " << err << " (expected: " << length << ")";
+                payload->clear();
+                status = kIOError;
+            }
+        }
+    }
+    stream->DecRef();
+    return status;
 }
 
 void SNodeImpl::ReadData(const ReadDataRequest* request,
@@ -209,12 +285,71 @@ void SNodeImpl::ReadData(const ReadDataRequest* request,
     if (request->type() == ReadDataRequest::SEQ_READ) {
         ReadDataSequencial(stream, request->payload_size(), response);
     } else {
-        ReadDataRandom(stream, request->payload_size(), request->offset(), response);
+        ReadDataRandom(stream, request->payload_size(), request->has_offset(),
+                       request->offset(), response);
     }
     stream->DecRef();
     done->Run();
 }
 
+void SNodeImpl::OpenScan(const OpenScanRequest* request,
+                         OpenScanResponse* response,
+                         google::protobuf::Closure* done) {
+    m_block_scanner->OpenScan(request, response, done);
+}
+
+void SNodeImpl::ScanData(const ScanDataRequest* request,
+                         ScanDataResponse* response,
+                         google::protobuf::Closure* done) {
+    m_block_scanner->ScanData(request, response, done);
+}
+
+void SNodeImpl::CloseScan(const CloseScanRequest* request,
+                          CloseScanResponse* response,
+                          google::protobuf::Closure* done) {
+    m_block_scanner->CloseScan(request, response, done);
+}
+
+void SNodeImpl::DeleteData(const DeleteDataRequest* request,
+                           DeleteDataResponse* response,
+                           google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+    // blocks are deleted one by one, a failed one fails the whole
+    // request and master will send it again
+    int32_t fail_num = 0;
+    for (int32_t i = 0; i < request->block_ids_size(); ++i) {
+        if (!m_block_manager->DeleteBlock(request->block_ids(i))) {
+            ++fail_num;
+        }
+    }
+    if (fail_num > 0) {
+        LOG(ERROR) << "fail to delete " << fail_num << " of "
+            << request->block_ids_size() << " blocks";
+        response->set_status(kIOError);
+    } else {
+        response->set_status(kSNodeOk);
+    }
+    done->Run();
+}
+
+void SNodeImpl::StatData(const StatDataRequest* request,
+                         StatDataResponse* response,
+                         google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+    for (int32_t i = 0; i < request->block_ids_size(); ++i) {
+        int64_t size = -1;
+        if (!m_block_manager->GetBlockSize(request->block_ids(i), &size)) {
+            response->clear_block_sizes();
+            response->set_status(kIOError);
+            done->Run();
+            return;
+        }
+        response->add_block_sizes(size);
+    }
+    response->set_status(kSNodeOk);
+    done->Run();
+}
+
 bool SNodeImpl::ReadDataSequencial(BlockStream* stream, uint64_t size,
                                    ReadDataResponse* response) {
     if (stream->GetType() != BlockStream::SEQ_READ) {
@@ -224,20 +359,26 @@ bool SNodeImpl::ReadDataSequencial(BlockStream* stream, uint64_t size,
         return false;
     }
     FileStream* file = stream->GetFileStream();
-    char* buf = new char[size];
+    // read into the payload directly, no bounce buffer
+    std::string* payload = response->mutable_payload();
+    payload->resize(size);
     FileErrorCode err = kFileSuccess;
-    if (size != file->Read(buf, size, &err)) {
+    if (size == 0) {
+        response->set_status(kSNodeOk);
+        return true;
+    }
+    if (size != file->Read(&(*payload)[0], size, &err)) {
         LOG(ERROR) << "fail to seq-read data, err: " << err;
+        response->clear_payload();
         response->set_status(kIOError);
         return false;
     }
-    response->set_payload(buf, size);
     response->set_status(kSNodeOk);
-    delete buf;
     return true;
 }
 
-bool SNodeImpl::ReadDataRandom(BlockStream* stream, uint64_t size, uint64_t offset,
+bool SNodeImpl::ReadDataRandom(BlockStream* stream, uint64_t size,
+                               bool has_offset, uint64_t offset,
                                ReadDataResponse* response) {
     if (stream->GetType() != BlockStream::RANDOM_READ) {
         LOG(ERROR) << "wrong stream type [stream type: "
@@ -246,19 +387,31 @@ bool SNodeImpl::ReadDataRandom(BlockStream* stream, uint64_t size, uint64_t offs
         return false;
     }
     FileStream* file = stream->GetFileStream();
-    char* buf = new char[size];
+    std::string* payload = response->mutable_payload();
+    payload->resize(size);
     FileErrorCode err = kFileSuccess;
-    int64_t read_count = file->Read(buf, size, &err);
+    if (size == 0) {
+        response->set_status(kSNodeOk);
+        return true;
+    }
+    // concurrent reads of a shared handle come to one stream
+    MutexLocker lock(*stream->GetIoMutex());
+    if (has_offset && file->Seek(offset, SEEK_SET, &err) < 0) {
+        LOG(ERROR) << "fail to seek data to " << offset << ", err: " << err;
+        response->clear_payload();
+        response->set_status(kIOError);
+        return false;
+    }
+    int64_t read_count = file->Read(&(*payload)[0], size, &err);
     if (size != read_count) {
         LOG(ERROR) << "fail to random-read data, err: " << err
             << " (expected: " << size << ", actual: " << read_count
             << ", offset: " << offset << ")";
+        response->clear_payload();
         response->set_status(kIOError);
         return false;
     }
-    response->set_payload(buf, read_count);
     response->set_status(kSNodeOk);
-    delete buf;
     return true;
 }
 
@@ -18,7 +18,9 @@ namespace rsfs {
 namespace snode {
 
 class BlockManager;
+class BlockScanner;
 class BlockStream;
+class LoadCollector;
 
 class SNodeImpl {
 public:
@@ -40,6 +42,8 @@ public:
 
     bool Report();
 
+    LoadCollector* GetLoadCollector();
+
     void OpenData(const OpenDataRequest* request,
                   OpenDataResponse* response,
                   google::protobuf::Closure* done);
@@ -56,10 +60,39 @@ public:
                    ReadDataResponse* response,
                    google::protobuf::Closure* done);
 
+    void OpenScan(const OpenScanRequest* request,
+                  OpenScanResponse* response,
+                  google::protobuf::Closure* done);
+
+    void ScanData(const ScanDataRequest* request,
+                  ScanDataResponse* response,
+                  google::protobuf::Closure* done);
+
+    void CloseScan(const CloseScanRequest* request,
+                   CloseScanResponse* response,
+                   google::protobuf::Closure* done);
+
+    void DeleteData(const DeleteDataRequest* request,
+                    DeleteDataResponse* response,
+                    google::protobuf::Closure* done);
+
+    void StatData(const StatDataRequest* request,
+                  StatDataResponse* response,
+                  google::protobuf::Closure* done);
+
+    // the io of one batch entry, positioned at offset if has_offset
+    StatusCode ReadBlock(uint64_t block_id, bool has_offset, uint64_t offset,
+                         uint64_t length, std::string* payload);
+    StatusCode WriteBlock(uint64_t block_id, const std::string& payload);
+
 private:
+    void CollectLoad(SNodeLoad* load);
+
     bool ReadDataSequencial(BlockStream* stream, uint64_t size,
                             ReadDataResponse* response);
-    bool ReadDataRandom(BlockStream* stream, uint64_t size, uint64_t offset,
+    // read at the current position of stream if no offset
+    bool ReadDataRandom(BlockStream* stream, uint64_t size,
+                        bool has_offset, uint64_t offset,
                         ReadDataResponse* response);
 
 private:
@@ -69,6 +102,8 @@ private:
 
     master::MasterClient* m_master_client;
     scoped_ptr<BlockManager> m_block_manager;
+    scoped_ptr<LoadCollector> m_load_collector;
+    scoped_ptr<BlockScanner> m_block_scanner;
     scoped_ptr<ThreadPool> m_thread_pool;
 };
 
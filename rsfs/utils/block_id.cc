@@ -4,16 +4,18 @@
 // Description:
 //
 
-#include "rsfs/sdk/sdk_utils.h"
+#include "rsfs/utils/block_id.h"
 
 namespace rsfs {
-namespace sdk {
-
+namespace utils {
 
 uint64_t BlockFileName(uint64_t fid, uint32_t block_no) {
-//     return block_no;
     return (fid << 32) + block_no;
 }
 
-} // namespace sdk
+uint64_t BlockFileId(uint64_t block_id) {
+    return block_id >> 32;
+}
+
+} // namespace utils
 } // namespace rsfs
@@ -0,0 +1,24 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_UTILS_BLOCK_ID_H
+#define RSFS_UTILS_BLOCK_ID_H
+
+#include "common/base/stdint.h"
+
+namespace rsfs {
+namespace utils {
+
+// the id of the block file of a file on its block_no-th chunk node,
+// shared by sdk, snode reports and master
+uint64_t BlockFileName(uint64_t fid, uint32_t block_no);
+
+uint64_t BlockFileId(uint64_t block_id);
+
+} // namespace utils
+} // namespace rsfs
+
+#endif // RSFS_UTILS_BLOCK_ID_H
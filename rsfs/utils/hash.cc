@@ -0,0 +1,29 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/utils/hash.h"
+
+namespace rsfs {
+namespace utils {
+
+const uint64_t kFnv64OffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnv64Prime = 1099511628211ULL;
+
+uint64_t Fnv64Hash(const char* data, uint32_t size) {
+    uint64_t hash = kFnv64OffsetBasis;
+    for (uint32_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= kFnv64Prime;
+    }
+    return hash;
+}
+
+uint64_t Fnv64Hash(const std::string& str) {
+    return Fnv64Hash(str.data(), str.size());
+}
+
+} // namespace utils
+} // namespace rsfs
@@ -0,0 +1,25 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_UTILS_HASH_H
+#define RSFS_UTILS_HASH_H
+
+#include <string>
+
+#include "common/base/stdint.h"
+
+namespace rsfs {
+namespace utils {
+
+// 64-bit FNV-1a, stable across builds and hosts
+uint64_t Fnv64Hash(const char* data, uint32_t size);
+
+uint64_t Fnv64Hash(const std::string& str);
+
+} // namespace utils
+} // namespace rsfs
+
+#endif // RSFS_UTILS_HASH_H
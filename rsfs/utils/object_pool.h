@@ -0,0 +1,150 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_UTILS_OBJECT_POOL_H
+#define RSFS_UTILS_OBJECT_POOL_H
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "common/base/stdint.h"
+#include "common/lock/mutex.h"
+
+namespace rsfs {
+namespace utils {
+
+// a free list of objects to recycle the hot ones, e.g. rpc messages.
+// an object put back is cleared by T::Clear(), which keeps the memory
+// it has grown (such as the capacity of a payload string), so the
+// object taken next time mostly need no allocation at all.
+// at most max_num idle objects are kept, the rest are deleted.
+//
+// with local_num > 0, each thread also keeps up to local_num idle
+// objects of T without lock, shared by the pools of T on the thread.
+// a full local list spills half of it to the pool, and an empty one
+// takes a batch back, so the pool mutex is taken once per batch. the
+// objects left on a thread are deleted when it exits.
+template <class T>
+class ObjectPool {
+public:
+    explicit ObjectPool(uint32_t max_num, uint32_t local_num = 0)
+        : m_max_num(max_num), m_local_num(local_num) {}
+    ~ObjectPool() {
+        for (uint32_t i = 0; i < m_objects.size(); ++i) {
+            delete m_objects[i];
+        }
+    }
+
+    T* Get() {
+        if (m_local_num == 0) {
+            MutexLocker lock(m_mutex);
+            if (!m_objects.empty()) {
+                T* obj = m_objects.back();
+                m_objects.pop_back();
+                return obj;
+            }
+            return new T;
+        }
+        std::vector<T*>* local = GetLocalList();
+        if (local->empty()) {
+            uint32_t batch_num = (m_local_num + 1) / 2;
+            MutexLocker lock(m_mutex);
+            while (!m_objects.empty() && local->size() < batch_num) {
+                local->push_back(m_objects.back());
+                m_objects.pop_back();
+            }
+        }
+        if (local->empty()) {
+            return new T;
+        }
+        T* obj = local->back();
+        local->pop_back();
+        return obj;
+    }
+
+    void Put(T* obj) {
+        if (obj == NULL) {
+            return;
+        }
+        obj->Clear();
+        if (m_local_num == 0) {
+            {
+                MutexLocker lock(m_mutex);
+                if (m_objects.size() < m_max_num) {
+                    m_objects.push_back(obj);
+                    return;
+                }
+            }
+            delete obj;
+            return;
+        }
+        std::vector<T*>* local = GetLocalList();
+        if (local->size() >= m_local_num) {
+            SpillLocalList(local, (m_local_num + 1) / 2);
+        }
+        local->push_back(obj);
+    }
+
+private:
+    // move spill_num objects of the local list to the pool, the ones
+    // over max_num are deleted
+    void SpillLocalList(std::vector<T*>* local, uint32_t spill_num) {
+        std::vector<T*> deleted;
+        {
+            MutexLocker lock(m_mutex);
+            for (uint32_t i = 0; i < spill_num && !local->empty(); ++i) {
+                if (m_objects.size() < m_max_num) {
+                    m_objects.push_back(local->back());
+                } else {
+                    deleted.push_back(local->back());
+                }
+                local->pop_back();
+            }
+        }
+        for (uint32_t i = 0; i < deleted.size(); ++i) {
+            delete deleted[i];
+        }
+    }
+
+    static void DeleteLocalList(void* arg) {
+        std::vector<T*>* local = static_cast<std::vector<T*>*>(arg);
+        for (uint32_t i = 0; i < local->size(); ++i) {
+            delete (*local)[i];
+        }
+        delete local;
+    }
+
+    struct LocalKey {
+        pthread_key_t key;
+        LocalKey() {
+            pthread_key_create(&key, &ObjectPool::DeleteLocalList);
+        }
+    };
+
+    static std::vector<T*>* GetLocalList() {
+        // one key per type, not per pool, as the keys are limited
+        static LocalKey local_key;
+        std::vector<T*>* local =
+            static_cast<std::vector<T*>*>(pthread_getspecific(local_key.key));
+        if (local == NULL) {
+            local = new std::vector<T*>;
+            pthread_setspecific(local_key.key, local);
+        }
+        return local;
+    }
+
+private:
+    Mutex m_mutex;
+    std::vector<T*> m_objects;
+    uint32_t m_max_num;
+    uint32_t m_local_num;
+};
+
+} // namespace utils
+} // namespace rsfs
+
+#endif // RSFS_UTILS_OBJECT_POOL_H
@@ -0,0 +1,122 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#include "rsfs/utils/timer_wheel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "thirdparty/glog/logging.h"
+
+#include "rsfs/utils/atomic.h"
+#include "rsfs/utils/utils_cmd.h"
+
+namespace rsfs {
+namespace utils {
+
+TimerWheel::TimerWheel(int64_t tick_ms, uint32_t slot_num, int32_t thread_num)
+    : m_tick_ms(std::max<int64_t>(1, tick_ms)),
+      m_slots(std::max<uint32_t>(1, slot_num)),
+      m_cur_slot(0), m_task_num(0), m_is_stopped(false),
+      m_thread_pool(new ThreadPool(thread_num, thread_num)) {
+    m_tick_timer_id = m_timer_manager.AddPeriodTimer(
+        m_tick_ms, NewPermanentClosure(this, &TimerWheel::Tick));
+}
+
+TimerWheel::~TimerWheel() {
+    m_timer_manager.RemoveTimer(m_tick_timer_id);
+    std::vector<Closure<void>*> tasks;
+    {
+        MutexLocker lock(m_mutex);
+        m_is_stopped = true;
+        for (uint32_t i = 0; i < m_slots.size(); ++i) {
+            for (uint32_t j = 0; j < m_slots[i].size(); ++j) {
+                tasks.push_back(m_slots[i][j].task);
+            }
+            m_slots[i].clear();
+        }
+    }
+    // not run, a pending task may add itself again or refer its owner
+    if (!tasks.empty()) {
+        LOG(WARNING) << "drop " << tasks.size() << " pending tasks of timer wheel";
+    }
+    for (uint32_t i = 0; i < tasks.size(); ++i) {
+        delete tasks[i];
+        atomic_dec(&m_task_num);
+    }
+    m_thread_pool.reset();
+}
+
+void TimerWheel::AddTask(int64_t delay_ms, Closure<void>* task) {
+    int64_t ticks = std::max<int64_t>(1, (delay_ms + m_tick_ms - 1) / m_tick_ms);
+    MutexLocker lock(m_mutex);
+    if (m_is_stopped) {
+        // added by a running task while the wheel is destroyed
+        delete task;
+        return;
+    }
+    atomic_inc(&m_task_num);
+    Entry entry;
+    entry.rounds = (ticks - 1) / m_slots.size();
+    entry.task = task;
+    m_slots[(m_cur_slot + ticks) % m_slots.size()].push_back(entry);
+}
+
+void TimerWheel::Tick(uint64_t timer_id) {
+    std::vector<Closure<void>*> due_tasks;
+    {
+        MutexLocker lock(m_mutex);
+        m_cur_slot = (m_cur_slot + 1) % m_slots.size();
+        std::vector<Entry>& slot = m_slots[m_cur_slot];
+        uint32_t remain_num = 0;
+        for (uint32_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].rounds == 0) {
+                due_tasks.push_back(slot[i].task);
+            } else {
+                slot[i].rounds--;
+                slot[remain_num++] = slot[i];
+            }
+        }
+        slot.resize(remain_num);
+    }
+    for (uint32_t i = 0; i < due_tasks.size(); ++i) {
+        m_thread_pool->AddTask(NewClosure(this, &TimerWheel::RunTask, due_tasks[i]));
+    }
+}
+
+int32_t TimerWheel::GetTaskNum() {
+    return m_task_num;
+}
+
+void TimerWheel::RunTask(Closure<void>* task) {
+    task->Run();
+    atomic_dec(&m_task_num);
+}
+
+int64_t GetBackoffTime(int32_t retry_no, int64_t base_ms, int64_t max_ms) {
+    int64_t delay = max_ms;
+    if (retry_no < 30 && (base_ms << retry_no) < max_ms) {
+        delay = base_ms << retry_no;
+    }
+    if (delay <= 1) {
+        return delay;
+    }
+    // seeded per thread, the processes started together must not
+    // share the sequence, or their retries are not spread
+    static __thread uint32_t seed = 0;
+    if (seed == 0) {
+        seed = (static_cast<uint32_t>(GetMicros())
+                ^ static_cast<uint32_t>(pthread_self())
+                ^ static_cast<uint32_t>(getpid())) | 1;
+    }
+    return delay / 2 + rand_r(&seed) % (delay - delay / 2 + 1);
+}
+
+} // namespace utils
+} // namespace rsfs
@@ -0,0 +1,69 @@
+// Copyright (C) 2017, for RSFS Authors.
+// Author: An Qin (anqin.qin@gmail.com)
+//
+// Description:
+//
+
+#ifndef RSFS_UTILS_TIMER_WHEEL_H
+#define RSFS_UTILS_TIMER_WHEEL_H
+
+#include <vector>
+
+#include "common/base/closure.h"
+#include "common/base/scoped_ptr.h"
+#include "common/base/stdint.h"
+#include "common/lock/mutex.h"
+#include "common/thread/thread_pool.h"
+#include "common/timer/timer_manager.h"
+
+namespace rsfs {
+namespace utils {
+
+// a hashed timer wheel for many short delayed tasks, e.g. rpc retries.
+// adding a task is O(1) and no thread is held while the task waits.
+// the due tasks are run on the own thread pool of wheel, so a slow
+// task does not delay the ticks.
+class TimerWheel {
+public:
+    TimerWheel(int64_t tick_ms, uint32_t slot_num, int32_t thread_num);
+    // the pending tasks are dropped without running, the owner waits
+    // GetTaskNum to be 0 before if the tasks must finish
+    ~TimerWheel();
+
+    // run task after delay_ms, rounded up to the tick
+    void AddTask(int64_t delay_ms, Closure<void>* task);
+
+    // the tasks added and not finished, either waiting or running
+    int32_t GetTaskNum();
+
+private:
+    struct Entry {
+        uint32_t rounds;
+        Closure<void>* task;
+    };
+
+    void Tick(uint64_t timer_id);
+    void RunTask(Closure<void>* task);
+
+private:
+    int64_t m_tick_ms;
+    Mutex m_mutex;
+    std::vector<std::vector<Entry> > m_slots;
+    uint32_t m_cur_slot;
+    volatile int32_t m_task_num;
+    bool m_is_stopped;
+
+    scoped_ptr<ThreadPool> m_thread_pool;
+    TimerManager m_timer_manager;
+    uint64_t m_tick_timer_id;
+};
+
+// exponential backoff of the retry_no-th retry (from 0), capped by
+// max_ms and jittered into [delay / 2, delay] so that the clients
+// failed together do not retry together
+int64_t GetBackoffTime(int32_t retry_no, int64_t base_ms, int64_t max_ms);
+
+} // namespace utils
+} // namespace rsfs
+
+#endif // RSFS_UTILS_TIMER_WHEEL_H
@@ -9,6 +9,8 @@
 #include <openssl/md5.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
 
 #include "common/base/scoped_ptr.h"
 #include "common/base/string_ext.h"
@@ -175,5 +177,21 @@ std::string TruncateString(const std::string& str, uint32_t width) {
     return str;
 }
 
+int64_t GetMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t GetMillis() {
+    return GetMicros() / 1000;
+}
+
+int64_t GetWallMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
 } // namespace utils
 } // namespace rsfs
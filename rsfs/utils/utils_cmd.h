@@ -35,6 +35,16 @@ std::string GetMd5(const char* buf, uint32_t buf_size);
 
 std::string TruncateString(const std::string& str, uint32_t width);
 
+// the monotonic time since an unspecified start, for the intervals and
+// deadlines inside one process
+int64_t GetMicros();
+
+int64_t GetMillis();
+
+// the wall clock time since epoch, for the time persisted or sent to
+// other hosts
+int64_t GetWallMillis();
+
 } // namespace utils
 } // namespace rsfs
 